@@ -0,0 +1,157 @@
+// Times the batched AI update on large enemy counts.
+// Build with -DCMAKE_BUILD_TYPE=Release, the default Debug build runs under the address sanitizer.
+
+#include "ai_system.hpp"
+#include "render_backend.hpp"
+#include "render_system.hpp"
+#include "tinyECS/registry.hpp"
+#include "world_init.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <limits>
+#include <random>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::high_resolution_clock;
+
+static const int DETECTION_ENEMIES = 10000;
+static const int DETECTION_RUNS = 200;
+static const int STEP_RUNS = 50;
+static const int SCALING_ENEMIES = 10000;
+
+// the regular archetypes, in the order they are added for the scaling runs
+static const char* ARCHETYPE_NAMES[] = { "spike", "rbc", "bacteriophage", "denderite" };
+static const int REGULAR_ARCHETYPES = 4;
+
+// enemies go on a ring around the player so none of them is close enough to blow up on it
+static vec2 randomEnemyPosition(vec2 player_position, std::default_random_engine& rng)
+{
+	std::uniform_real_distribution<float> angle(0.f, 2.f * (float)M_PI);
+	std::uniform_real_distribution<float> distance(100.f, 6000.f);
+	float a = angle(rng);
+	return player_position + distance(rng) * vec2(cosf(a), sinf(a));
+}
+
+template <typename Fn>
+static double averageMs(int runs, Fn&& fn)
+{
+	auto start = Clock::now();
+	for (int i = 0; i < runs; i++)
+		fn();
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count() / runs;
+}
+
+// the SoA pass against what the update did before batching: a registry lookup and a distance per enemy
+static void benchDetection(vec2 player_position)
+{
+	auto& ais = registry.spikeEnemyAIs;
+	const size_t n = ais.size();
+	std::vector<float> enemy_x(n), enemy_y(n), offset_x(n), offset_y(n), dist_sq(n), radius_sq(n);
+	std::vector<unsigned char> detected(n);
+	for (size_t i = 0; i < n; i++)
+	{
+		Motion& motion = registry.motions.get(ais.entities[i]);
+		enemy_x[i] = motion.position.x;
+		enemy_y[i] = motion.position.y;
+		radius_sq[i] = ais.components[i].detectionRadius * ais.components[i].detectionRadius;
+	}
+
+	double soa_ms = averageMs(DETECTION_RUNS, [&]() {
+		offset_x = enemy_x;
+		offset_y = enemy_y;
+		detectPlayer(n, player_position.x, player_position.y, radius_sq.data(),
+			offset_x.data(), offset_y.data(), dist_sq.data(), detected.data());
+	});
+
+	size_t lookup_detected = 0;
+	double lookup_ms = averageMs(DETECTION_RUNS, [&]() {
+		lookup_detected = 0;
+		for (size_t i = 0; i < n; i++)
+		{
+			Motion& motion = registry.motions.get(ais.entities[i]);
+			float dist = glm::distance(player_position, motion.position);
+			if (dist < ais.components[i].detectionRadius)
+				lookup_detected++;
+		}
+	});
+
+	size_t soa_detected = 0;
+	for (unsigned char d : detected)
+		soa_detected += d;
+
+	printf("detection, %zu enemies\n", n);
+	printf("  SoA pass (copy in + detectPlayer)  %8.3f ms  %zu detected\n", soa_ms, soa_detected);
+	printf("  per-entity registry lookups        %8.3f ms  %zu detected\n", lookup_ms, lookup_detected);
+}
+
+static void createArchetypeEnemy(RenderSystem& renderer, int archetype, vec2 position, int index)
+{
+	switch (archetype)
+	{
+	case 0: createSpikeEnemy(&renderer, position); break;
+	case 1: createRBCEnemy(&renderer, position); break;
+	case 2: createBacteriophage(&renderer, position, index % (int)MAX_BACTERIOPHAGE_COUNT); break;
+	default: createDenderite(&renderer, position); break;
+	}
+}
+
+static void removeEnemies()
+{
+	while (registry.enemies.entities.size() > 0)
+		registry.remove_all_components_of(registry.enemies.entities.back());
+}
+
+// the same number of enemies split over more archetypes gives the parallel jobs more to share
+static void benchArchetypeScaling(AISystem& ai, RenderSystem& renderer, vec2 player_position)
+{
+	printf("archetype scaling, %d enemies split evenly, %u hardware threads\n",
+		SCALING_ENEMIES, std::thread::hardware_concurrency());
+	for (int archetypes = 1; archetypes <= REGULAR_ARCHETYPES; archetypes++)
+	{
+		removeEnemies();
+		std::default_random_engine rng(11);
+		for (int i = 0; i < SCALING_ENEMIES; i++)
+			createArchetypeEnemy(renderer, i % archetypes, randomEnemyPosition(player_position, rng), i);
+
+		ai.step(16.f); // first step sizes the batches
+		double step_ms = averageMs(STEP_RUNS, [&]() { ai.step(16.f); });
+
+		printf("  AISystem::step over %d archetype%s  %8.3f ms  (%s", archetypes, archetypes == 1 ? " " : "s", step_ms, ARCHETYPE_NAMES[0]);
+		for (int a = 1; a < archetypes; a++)
+			printf(", %s", ARCHETYPE_NAMES[a]);
+		printf(")\n");
+	}
+}
+
+int main()
+{
+	NullRenderBackend backend;
+	RenderSystem renderer;
+	renderer.initHeadless(&backend);
+
+	// stand-ins for the player and camera the AI reads every step
+	const vec2 player_position = {5000.f, 5000.f};
+	Entity player;
+	registry.players.emplace(player);
+	registry.motions.emplace(player).position = player_position;
+	registry.cameras.emplace(Entity()).position = player_position;
+
+	AISystem ai;
+	// everyone updates every frame, this measures the update rather than the LOD scheduler
+	ai.setLodTiers({ { std::numeric_limits<float>::max(), 1 } });
+
+	std::default_random_engine rng(7);
+	for (int i = 0; i < DETECTION_ENEMIES; i++)
+		createSpikeEnemy(&renderer, randomEnemyPosition(player_position, rng));
+
+	benchDetection(player_position);
+
+	double step_ms = averageMs(STEP_RUNS, [&]() { ai.step(16.f); });
+	printf("  AISystem::step                     %8.3f ms\n", step_ms);
+
+	benchArchetypeScaling(ai, renderer, player_position);
+
+	return 0;
+}
@@ -0,0 +1,144 @@
+// Times the particle update kernels on 100k particles, and ParticleSystem holding a sustained
+// load under its spawn and live budgets at 60 fps.
+// Build with -DCMAKE_BUILD_TYPE=Release, the default Debug build runs under the address sanitizer.
+// Configure with -DPARTICLES_AVX2=ON to compare the AVX2 kernels with the scalar ones.
+
+#include "particle_kernels.hpp"
+#include "particle_system.hpp"
+#include "tinyECS/registry.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using Clock = std::chrono::high_resolution_clock;
+
+static const int KERNEL_PARTICLES = 100000;
+static const int KERNEL_RUNS = 100;
+// a bucket holds at most CAPACITY, the 100k are spread over as many full ones as that takes
+static const int BUCKET_PARTICLES = 4000;
+
+static const float FRAME_MS = 1000.f / 60.f;
+static const int SUSTAINED_FRAMES = 600;
+// more than the per frame spawn budget, so the system runs at its limits the whole time
+static const int DEATH_BURSTS_PER_FRAME = 30;
+
+template <typename Fn>
+static double averageMs(int runs, Fn&& fn)
+{
+	auto start = Clock::now();
+	for (int i = 0; i < runs; i++)
+		fn();
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count() / runs;
+}
+
+// particles half way through their lives, a third each bursting, following and fading
+static std::vector<ParticleBucket> fillBuckets(vec2 player_position)
+{
+	std::default_random_engine rng(5);
+	std::uniform_real_distribution<float> unit(0.f, 1.f);
+	std::vector<ParticleBucket> buckets((KERNEL_PARTICLES + BUCKET_PARTICLES - 1) / BUCKET_PARTICLES);
+	for (int n = 0; n < KERNEL_PARTICLES; n++)
+	{
+		ParticleBucket& bucket = buckets[n / BUCKET_PARTICLES];
+		const int p = bucket.spawn(player_position + vec2(unit(rng) - 0.5f, unit(rng) - 0.5f) * 1000.f);
+		bucket.velocity_x[p] = (unit(rng) - 0.5f) * 400.f;
+		bucket.velocity_y[p] = (unit(rng) - 0.5f) * 400.f;
+		bucket.max_lifetime_ms[p] = 100000.f;
+		bucket.lifetime_ms[p] = 50000.f;
+		bucket.state[p] = (PARTICLE_STATE)(n % 3);
+		bucket.state_timer_ms[p] = 100000.f;
+	}
+	return buckets;
+}
+
+static void benchKernels(ParticleSystem& particles)
+{
+	const vec2 player_position = {0.f, 0.f};
+	const ParticleEmitter& death = particles.emitter(PARTICLE_TYPE::DEATH_PARTICLE);
+	const ParticleEmitter& ripple = particles.emitter(PARTICLE_TYPE::RIPPLE_PARTICLE);
+	std::vector<ParticleBucket> buckets = fillBuckets(player_position);
+
+	// 1 ms steps keep every particle alive and in its state for all the runs
+	double death_ms = averageMs(KERNEL_RUNS, [&]() {
+		for (ParticleBucket& bucket : buckets)
+			stepDeathParticles(bucket, death, 0, bucket.size(), 1.f, true, player_position);
+	});
+	double death_scalar_ms = averageMs(KERNEL_RUNS, [&]() {
+		for (ParticleBucket& bucket : buckets)
+			stepDeathParticlesScalar(bucket, death, 0, bucket.size(), 1.f, true, player_position);
+	});
+	double ripple_ms = averageMs(KERNEL_RUNS, [&]() {
+		for (ParticleBucket& bucket : buckets)
+			stepRippleParticles(bucket, ripple, 0, bucket.size(), 1.f);
+	});
+	double ripple_scalar_ms = averageMs(KERNEL_RUNS, [&]() {
+		for (ParticleBucket& bucket : buckets)
+			stepRippleParticlesScalar(bucket, ripple, 0, bucket.size(), 1.f);
+	});
+
+	printf("kernels, %d particles, one thread, %s path\n", KERNEL_PARTICLES, particleKernelPath());
+	printf("  death   %s %8.3f ms   scalar %8.3f ms\n", particleKernelPath(), death_ms, death_scalar_ms);
+	printf("  ripple  %s %8.3f ms   scalar %8.3f ms\n", particleKernelPath(), ripple_ms, ripple_scalar_ms);
+}
+
+// death bursts all around a moving player that leaves ripples, every frame, for ten seconds
+static void benchSustained(ParticleSystem& particles)
+{
+	Entity player;
+	registry.players.emplace(player);
+	Motion& motion = registry.motions.emplace(player);
+	motion.scale = {60.f, 60.f};
+	motion.velocity = {200.f, 0.f};
+
+	particles.clear();
+	particles.setSeed(1);
+	std::default_random_engine rng(9);
+	std::uniform_real_distribution<float> offset(-600.f, 600.f);
+
+	double spawn_ms = 0.0;
+	double step_ms = 0.0;
+	double worst_ms = 0.0;
+	long long live = 0, spawned = 0, dropped = 0, evicted = 0;
+	for (int frame = 0; frame < SUSTAINED_FRAMES; frame++)
+	{
+		motion.position += motion.velocity * (FRAME_MS / 1000.f);
+
+		auto start = Clock::now();
+		for (int i = 0; i < DEATH_BURSTS_PER_FRAME; i++)
+			particles.createParticles(PARTICLE_TYPE::DEATH_PARTICLE, motion.position + vec2(offset(rng), offset(rng)));
+		particles.createPlayerRipples(player);
+		auto spawned_at = Clock::now();
+		particles.step(FRAME_MS);
+		auto end = Clock::now();
+
+		spawn_ms += std::chrono::duration<double, std::milli>(spawned_at - start).count();
+		step_ms += std::chrono::duration<double, std::milli>(end - spawned_at).count();
+		worst_ms = std::max(worst_ms, std::chrono::duration<double, std::milli>(end - start).count());
+		const ParticleStats& stats = particles.stats();
+		live += stats.live;
+		spawned += stats.spawned;
+		dropped += stats.dropped;
+		evicted += stats.evicted;
+	}
+
+	const double average_ms = (spawn_ms + step_ms) / SUSTAINED_FRAMES;
+	printf("sustained, %d frames of %.2f ms, budget %d spawns per frame and %d live\n",
+		SUSTAINED_FRAMES, FRAME_MS, PARTICLE_MAX_SPAWNS_PER_FRAME, PARTICLE_MAX_LIVE);
+	printf("  per frame: %lld live, %lld spawned, %lld dropped, %lld evicted\n",
+		live / SUSTAINED_FRAMES, spawned / SUSTAINED_FRAMES, dropped / SUSTAINED_FRAMES, evicted / SUSTAINED_FRAMES);
+	printf("  spawn %8.3f ms + step %8.3f ms average, %8.3f ms worst frame, %5.2f%% of the frame\n",
+		spawn_ms / SUSTAINED_FRAMES, step_ms / SUSTAINED_FRAMES, worst_ms, 100.0 * average_ms / FRAME_MS);
+
+	registry.remove_all_components_of(player);
+}
+
+int main()
+{
+	ParticleSystem particles;
+	benchKernels(particles);
+	benchSustained(particles);
+	return 0;
+}
@@ -1,13 +1,13 @@
 #version 330 core
 /* simpleGL freetype font fragment shader */
 in vec2 TexCoords;
+in vec3 vcolor;
 out vec4 color;
 
 uniform sampler2D text;
-uniform vec3 textColor;
 
 void main()
 {
 	vec4 sampled = vec4(1.0, 1.0, 1.0, texture(text, TexCoords).r);
-	color = vec4(textColor, 1.0) * sampled;
+	color = vec4(vcolor, 1.0) * sampled;
 }
\ No newline at end of file
@@ -18,24 +18,25 @@ uniform int map_height;
 uniform vec2 player_grid_position;
 // if theres multiple frames you need to merge all three frames into one
 
-uniform int map_array[400];
-uniform int map_visited_array[400];
+// one texel per cell, the tile type in the low bits and the top bit set once the cell was visited
+uniform usampler2D map_texture;
 
 vec4 procColor() {
     vec4 fcolor = vec4(0.5, 0.0, 0.0, 0.25);
     
     int iX = int(texcoord.y * float(map_width));
     int iY = int(texcoord.x * float(map_height));
-    int index = iX + iY * map_width;
+    uint cell = texelFetch(map_texture, ivec2(iX, iY), 0).r;
+    int tile = int(cell & 127u);
 
     if (iX == 0 || iX == map_width - 1 || iY == 0 || iY == map_height - 1) {
         fcolor = vec4(0.75, 0.75, 0.75, 1.0);
-    } else if (map_visited_array[index] == 0) {
+    } else if ((cell & 128u) == 0u) {
         fcolor = vec4(0.0, 0.0, 0.0, 1.0);
     } else {
-        if (map_array[index] == 1) {
+        if (tile == 1) {
             fcolor = vec4(0.75, 0.75, 0.75, 1.0);
-        } else if (map_array[index] == 2) {
+        } else if (tile == 2) {
             fcolor = vec4(1.0, 1.0, 0.0, 1.0);
         }
     }
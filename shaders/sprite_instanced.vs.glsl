@@ -0,0 +1,29 @@
+#version 330
+
+// Input attributes
+layout(location = 0) in vec3 in_position;
+layout(location = 1) in vec2 in_texcoord;
+// Per instance, see SpriteInstance in render_system.hpp
+layout(location = 2) in mat3 instance_transform; // occupies locations 2, 3, 4
+layout(location = 5) in vec2 instance_frame;     // x: total_frames, y: current_frame
+layout(location = 6) in vec3 instance_tint;
+layout(location = 7) in vec4 instance_uv_rect;   // (u0, v0, u1, v1) inside the bound texture or atlas page
+
+// Passed to fragment shader
+out vec2 texcoord;
+out vec3 tint;
+
+// Application data
+uniform mat3 projection;
+
+void main()
+{
+	// plain textured sprites are sent as a sheet with a single frame
+	float sprite_width = 1.0 / instance_frame.x;
+	vec2 local = vec2((instance_frame.y + in_texcoord.x) * sprite_width, in_texcoord.y);
+	texcoord = mix(instance_uv_rect.xy, instance_uv_rect.zw, local);
+	tint = instance_tint;
+
+	vec3 pos = projection * instance_transform * vec3(in_position.xy, 1.0);
+	gl_Position = vec4(pos.xy, in_position.z, 1.0);
+}
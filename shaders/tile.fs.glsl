@@ -38,6 +38,12 @@ void main()
         return;
     }
 
+    // animated tiles (portals) only show their current frame
+    if (instanceTileParams.w == 0.0) {
+        color = texture(sampler0, get_offset_texcoord(texcoord, int(instanceTileParams.y)));
+        return;
+    }
+
     vec4 fcolor_accum = vec4(0.0);
 
     // Use instanceTileParams.y as current frame
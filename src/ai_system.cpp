@@ -1,24 +1,106 @@
 #include <random>
 #include <iostream>
+#include <chrono>
+#include <limits>
+#include <cstdlib>
 #include "ai_system.hpp"
 #include "world_init.hpp"
 #include "animation_system.hpp"
+#include "bullet_patterns.hpp"
 // include lerp
 #include <glm/gtx/compatibility.hpp>
 
-bool AISystem::isPlayerInRadius(vec2 player, vec2 enemy, float& distance, vec2& direction, float detectionRadius)
+void AIBatch::resize(size_t n)
 {
-	/* Measure distance to player and check if within detection radius */
-	vec2 diff = player - enemy;
-	distance = glm::length(diff);
-	direction = glm::normalize(diff);
-	return distance < detectionRadius * registry.players.get(registry.players.entities[0]).detection_range;
+	motion_index.resize(n);
+	offset_x.resize(n);
+	offset_y.resize(n);
+	dist_sq.resize(n);
+	radius_sq.resize(n);
+	detected.resize(n);
+	scheduled.resize(n);
+	step_ms.resize(n);
 }
 
-SpikeEnemyState AISystem::handleSpikeEnemyBehavior(Entity &enemyEntity, SpikeEnemyAI &enemyBehavior, float dist, vec2 direction, bool playerDetected, float elapsed_ms)
+void AICommandQueue::apply()
 {
-	Motion &enemyMotion = registry.motions.get(enemyEntity);
+	for (std::function<void()>& command : commands)
+		command();
+	commands.clear();
+}
+
+AISystem::AISystem() :
+	rbc_rng(std::random_device()()),
+	boss_rng(std::random_device()()),
+	final_boss_rng(std::random_device()()),
+	denderite_rng(std::random_device()()),
+	workers(AI_ARCHETYPE_COUNT - 1)
+{
+	// the tags have to line up with the state enums in components.hpp
+	std::string table_path = data_path() + "/ai/behaviours.json";
+	bool tables_ok = loadBehaviourTable(table_path, "boss", { "INITIAL", "IDLE", "SHOOT_PARADE", "RUMBLE", "FLEE" }, boss_table);
+	tables_ok &= loadBehaviourTable(table_path, "denderite", { "HUNT", "PIERCE", "SHOOT" }, denderite_table);
+	tables_ok &= loadBehaviourTable(table_path, "rbc", { "FLOATING", "RUNAWAY" }, rbc_table);
+	// every AI step indexes into the tables, there is nothing sensible to run without them
+	if (!tables_ok)
+	{
+		std::cerr << "ERROR: failed to load enemy behaviour tables from " << table_path << std::endl;
+		exit(EXIT_FAILURE);
+	}
+
+	setLodTiers({
+		{ AI_LOD_NEAR_DISTANCE, 1 },	// on screen and just past the edge
+		{ AI_LOD_MID_DISTANCE, 2 },
+		{ AI_LOD_FAR_DISTANCE, 4 },
+		{ std::numeric_limits<float>::max(), 8 }
+	});
+}
+
+void AISystem::setLodTiers(const std::vector<AILodTier>& tiers)
+{
+	assert(!tiers.empty() && "AI LOD needs at least one tier");
+	lod_tiers = tiers;
+}
+
+// plain loop over flat arrays so it vectorizes
+void detectPlayer(size_t n, float player_x, float player_y, const float* radius_sq,
+	float* offset_x, float* offset_y, float* dist_sq, unsigned char* detected)
+{
+	for (size_t i = 0; i < n; i++)
+	{
+		float dx = player_x - offset_x[i];
+		float dy = player_y - offset_y[i];
+		offset_x[i] = dx;
+		offset_y[i] = dy;
+		dist_sq[i] = dx * dx + dy * dy;
+		detected[i] = dist_sq[i] < radius_sq[i];
+	}
+}
 
+template <typename AI>
+void AISystem::gatherBatch(ComponentContainer<AI>& ais, AIBatch& batch, float elapsed_ms)
+{
+	size_t n = ais.size();
+	batch.resize(n);
+	for (size_t i = 0; i < n; i++)
+	{
+		Motion& motion = registry.motions.get(ais.entities[i]);
+		batch.motion_index[i] = (unsigned int)(&motion - registry.motions.components.data());
+		// offsets hold the enemy position until the distance pass turns them into offsets
+		batch.offset_x[i] = motion.position.x;
+		batch.offset_y[i] = motion.position.y;
+		float radius = ais.components[i].detectionRadius * player_detection_range;
+		batch.radius_sq[i] = radius * radius;
+		// everyone runs every frame unless the LOD scheduler says otherwise
+		batch.scheduled[i] = 1;
+		batch.step_ms[i] = elapsed_ms;
+	}
+	detectPlayer(n, player_position.x, player_position.y, batch.radius_sq.data(),
+		batch.offset_x.data(), batch.offset_y.data(), batch.dist_sq.data(), batch.detected.data());
+}
+
+SpikeEnemyState AISystem::handleSpikeEnemyBehavior(Entity enemyEntity, Motion &enemyMotion, SpikeEnemyAI &enemyBehavior, float dist, vec2 direction, bool playerDetected, float elapsed_ms, AICommandQueue& commands)
+{
 	switch (enemyBehavior.state)
 	{
 	case SpikeEnemyState::CHASING:
@@ -77,7 +159,7 @@ SpikeEnemyState AISystem::handleSpikeEnemyBehavior(Entity &enemyEntity, SpikeEne
 		
 		// Switch to dashing if player detected
 		if (playerDetected) {
-			changeAnimationFrames(enemyEntity, 7, 12);
+			commands.push([enemyEntity]() { changeAnimationFrames(enemyEntity, 7, 12); });
 			return SpikeEnemyState::DASHING;
 		}
 		break;
@@ -94,18 +176,21 @@ SpikeEnemyState AISystem::handleSpikeEnemyBehavior(Entity &enemyEntity, SpikeEne
                 enemyBehavior.bombTimer -= elapsed_ms;
                 if (enemyBehavior.bombTimer <= 0)
                 {
-                    Enemy& enemy = registry.enemies.get(enemyEntity);
-                    enemy.health = 0;
-                    Player &player = registry.players.get(registry.players.entities[0]);
-					damagePlayer(SPIKE_ENEMY_BOMB_DAMAGE);
-					createEffect(TEXTURE_ASSET_ID::SPIKE_ENEMY_EXPLOSION_EFFECT, enemyMotion.position, enemyMotion.scale * 1.6f, 4);
+					vec2 position = enemyMotion.position;
+					vec2 scale = enemyMotion.scale * 1.6f;
+					commands.push([enemyEntity, position, scale]() {
+						if (registry.enemies.has(enemyEntity))
+							registry.enemies.get(enemyEntity).health = 0;
+						damagePlayer(SPIKE_ENEMY_BOMB_DAMAGE);
+						createEffect(TEXTURE_ASSET_ID::SPIKE_ENEMY_EXPLOSION_EFFECT, position, scale, 4);
+					});
 				}
 			}
 		}
 		else
 		{
 			// change animation frames and reset patrol state
-			changeAnimationFrames(enemyEntity, 0, 6);
+			commands.push([enemyEntity]() { changeAnimationFrames(enemyEntity, 0, 6); });
 			enemyBehavior.patrolOrigin = enemyMotion.position;
 			enemyMotion.velocity = {0, 0};
 			enemyBehavior.bombTimer = SPIKE_ENEMY_BOMB_TIMER;
@@ -117,10 +202,9 @@ SpikeEnemyState AISystem::handleSpikeEnemyBehavior(Entity &enemyEntity, SpikeEne
 	case SpikeEnemyState::KNOCKBACK:
 	{
 		// apply knockback velocity
-		enemyBehavior.knockbackTimer -= elapsed_ms;
-		if (enemyBehavior.knockbackTimer <= 0)
+		if (enemyBehavior.knockback.due())
 		{
-			changeAnimationFrames(enemyEntity, 0, 6);
+			commands.push([enemyEntity]() { changeAnimationFrames(enemyEntity, 0, 6); });
 			enemyBehavior.patrolOrigin = enemyMotion.position;
 			enemyMotion.velocity = {0, 0};
 			return SpikeEnemyState::DASHING;
@@ -137,67 +221,7 @@ SpikeEnemyState AISystem::handleSpikeEnemyBehavior(Entity &enemyEntity, SpikeEne
 	return enemyBehavior.state;
 }
 
-RBCEnemyState AISystem::handleRBCBehavior(Entity& enemyEntity, RBCEnemyAI& enemyBehavior, float dist, vec2 direction, bool playerDetected, float elapsed_ms)
-{
-	Motion& enemyMotion = registry.motions.get(enemyEntity);
-
-	switch(enemyBehavior.state) 
-	{
-		case RBCEnemyState::FLOATING: {
-	
-			// while patrolling randomly flip direction
-			enemyBehavior.patrolTime += elapsed_ms;
-			if (enemyBehavior.patrolTime >= 3000.f) {
-				std::random_device rd;
-				std::default_random_engine rng(rd());
-				std::uniform_real_distribution<float> uniform_dist(0.0f, 360 * 1.0f);
-				enemyMotion.angle = uniform_dist(rng);
-				enemyBehavior.patrolTime = 0.f;
-
-
-				enemyMotion.velocity.x = ENEMY_SPEED * cos(enemyMotion.angle) / 4;
-				enemyMotion.velocity.y = ENEMY_SPEED * sin(enemyMotion.angle) / 4;
-			}
-
-			// if player is detected, transition to chasing state
-			if (playerDetected) {
-				enemyBehavior.state = RBCEnemyState::RUNAWAY;
-			}
-
-			break;
-		}
-
-		case RBCEnemyState::RUNAWAY: {
-			if (dist > 0.001f && playerDetected) {
-				// run away from character by adjusting direction directly opposite from player
-				float new_angle = atan2(direction.y, direction.x);
-				new_angle *= (360.f / (2 * M_PI)) + 90.f;
-				if (new_angle < 0) {
-					new_angle += 360;
-				}
-				enemyMotion.angle = new_angle;
-				enemyMotion.velocity = -direction * ENEMY_SPEED;
-			}
-			else {
-				// if player is no longer detected, transition back to floating state
-				enemyBehavior.patrolOrigin = enemyMotion.position;
-				enemyBehavior.state = RBCEnemyState::FLOATING;
-				enemyBehavior.patrolTime = ENEMY_PATROL_TIME_MS / 2;
-			}
-			break;
-		}
-
-		default :
-			enemyBehavior.state = RBCEnemyState::FLOATING;
-			break;
-	}
-	
-	return enemyBehavior.state;
-}
-
-BacteriophageState AISystem::handleBacteriophageBehavior(Entity& enemyEntity, BacteriophageAI& enemyBehavior, vec2 direction, bool playerDetected, float elapsed_ms, vec2 positionToReach, vec2 directionToPlayer)  {
-	
-	Motion& enemyMotion = registry.motions.get(enemyEntity);
+BacteriophageState AISystem::handleBacteriophageBehavior(Motion& enemyMotion, BacteriophageAI& enemyBehavior, bool playerDetected, float elapsed_ms, vec2 positionToReach, vec2 directionToPlayer)  {
 
 	switch (enemyBehavior.state)
 	{
@@ -215,7 +239,7 @@ BacteriophageState AISystem::handleBacteriophageBehavior(Entity& enemyEntity, Ba
 		else
 		{
 			// add slight floating motion even when idleto make it more alive and avoid jitter
-			float time = static_cast<float>(glfwGetTime() * 0.5f);
+			float time = static_cast<float>(glfw_time * 0.5f);
 			enemyMotion.velocity.x = sin(time + enemyBehavior.placement_index) * 10.0f;
 			enemyMotion.velocity.y = cos(time * 1.3f + enemyBehavior.placement_index) * 10.0f;
 		}
@@ -275,182 +299,9 @@ BacteriophageState AISystem::handleBacteriophageBehavior(Entity& enemyEntity, Ba
 	return enemyBehavior.state;
 }
 
-BossState AISystem::handleBossBehaviour(Entity& enemyEntity, BossAI& enemyBehavior, float dist, vec2 direction, bool playerDetected, float elapsed_ms)
+FinalBossState AISystem::handleFinalBossBehaviour(Entity enemyEntity, Motion& enemyMotion, Enemy* enemyPtr, FinalBossAI& enemyBehavior, float dist, vec2 direction, bool playerDetected, float elapsed_ms, AICommandQueue& commands)
 {
-
-	if (!registry.motions.has(enemyEntity) || !registry.enemies.has(enemyEntity)) {
-		return BossState::INITIAL;
-	}
-
-	Motion &enemyMotion = registry.motions.get(enemyEntity);
-
-	Enemy& enemy = registry.enemies.get(enemyEntity);
-
-	switch (enemyBehavior.state)
-	{
-		// initaially do noting, if player detected go to any random state and set cool_down
-		case BossState::INITIAL:
-		{
-			if(playerDetected)
-			{
-				std::vector<BossState> possibleStates = { BossState::SHOOT_PARADE, BossState::RUMBLE };
-				BossState next_state = possibleStates[std::rand() % possibleStates.size()];
-
-				enemyBehavior.state = next_state;
-				
-				if (enemyBehavior.state == BossState::SHOOT_PARADE)
-				{
-					enemyBehavior.shoot_cool_down = 0.f;
-					enemyBehavior.cool_down = 3000.f;
-				}
-				else if (enemyBehavior.state == BossState::RUMBLE)
-				{
-					enemyBehavior.rumble_charge_time = 1500.f;
-					enemyBehavior.rumble_duration = 1000.f;
-					enemyBehavior.is_charging = true;
-				}
-			}
-			break;
-		}
-		// basically initial, but with the option of running way when health is low and doesn't need to wait for player to be detected
-		case BossState::IDLE: 
-		{
-
-			// reset angle to 0
-			if (enemyMotion.angle != 0.f) {
-				const float smoothing_factor = 0.1f;
-
-				enemyMotion.angle = glm::lerp(enemyMotion.angle, 0.f, smoothing_factor);
-
-				if (std::fabs(enemyMotion.angle) < 0.1f) {
-					enemyMotion.angle = 0.f;
-				}
-			}
-
-			// when cool_down reaches < 0, go to a random state
-			enemyBehavior.cool_down -= elapsed_ms;
-			if(enemyBehavior.cool_down < 0.f)
-			{
-				float health_ratio = enemy.health / enemy.total_health;
-				bool can_flee = (health_ratio < 0.65f);
-
-				std::vector<BossState> possibleStates = { BossState::SHOOT_PARADE, BossState::RUMBLE };
-				if (can_flee)
-					possibleStates.push_back(BossState::FLEE);
-
-				BossState next_state = possibleStates[std::rand() % possibleStates.size()];
-				enemyBehavior.state = next_state;
-				
-				if (enemyBehavior.state == BossState::SHOOT_PARADE)
-				{
-					enemyBehavior.shoot_cool_down = 0.f;
-					enemyBehavior.cool_down = 3000.f;
-				}
-				else if (enemyBehavior.state == BossState::RUMBLE)
-				{
-					enemyBehavior.rumble_charge_time = 1500.f;
-					enemyBehavior.rumble_duration = 1000.f;
-					enemyBehavior.is_charging = true;
-				}
-				else if (enemyBehavior.state == BossState::FLEE)
-				{
-					enemyBehavior.flee_timer = 500.f;
-					enemyBehavior.is_fleeing = true;
-				}
-			}		
-			break;
-		}
-
-		case BossState::SHOOT_PARADE:
-		{
-			// shoot for a small duration and go to cool_down
-			enemyBehavior.cool_down -= elapsed_ms;
-			enemyBehavior.shoot_cool_down -= elapsed_ms;
-			
-			if (enemyBehavior.shoot_cool_down < 0.f) {
-				for (int angleDeg = 0; angleDeg < 360; angleDeg += 30)
-				{
-					float angleRad = glm::radians((float)angleDeg);
-					vec2 dir = { cosf(angleRad), sinf(angleRad) };
-					vec2 velocity = dir * PROJECTILE_SPEED * 3.f;
-					vec2 spawnPos = enemyMotion.position + dir * enemyMotion.scale.x / 3.f;
-
-					createBossProjectile(spawnPos, enemyBehavior.projectile_size, velocity);
-				}
-
-				enemyBehavior.shoot_cool_down = 500.f;	
-			}
-
-			if (enemyBehavior.cool_down < 0.f) {
-				enemyBehavior.state = BossState::IDLE;
-				enemyBehavior.cool_down = 3000.f;
-			}	
-
-			break;
-		}
-
-		case BossState::RUMBLE:
-		{
-			// charge dash and rotate towards player to dash
-			if (enemyBehavior.is_charging) {
-				enemyBehavior.rumble_charge_time -= elapsed_ms;
-				enemyMotion.velocity = { 0.f, 0.f };
-
-				enemyMotion.angle = atan2(direction.y, direction.x) * (180.f / M_PI) + 90.f;
-
-				if (enemyBehavior.rumble_charge_time <= 0.f) {
-					vec2 locked_direction = glm::normalize(direction);
-					enemyMotion.velocity = locked_direction * ENEMY_SPEED * 4.f;
-
-					enemyBehavior.is_charging = false;
-					enemyBehavior.rumble_duration = 1000.f;
-				}
-			}
-			else {
-				enemyBehavior.rumble_duration -= elapsed_ms;
-
-				if (enemyBehavior.rumble_duration <= 0.f) {
-					
-					enemyMotion.velocity = { 0.f, 0.f };
-					enemyBehavior.state = BossState::IDLE;
-					enemyBehavior.cool_down = 3000.f;
-					enemyBehavior.rumble_charge_time = 1500.f;
-					enemyBehavior.is_charging = true;
-				}
-			}
-			break;
-		}
-
-		// run away from player in the opposite direction
-		case BossState::FLEE :
-		{
-			if (enemyBehavior.is_fleeing) {
-				enemyBehavior.flee_timer -= elapsed_ms;
-
-				vec2 flee_dir = -glm::normalize(direction);
-				enemyMotion.velocity = flee_dir * ENEMY_SPEED * 5.f;
-
-				if (enemyBehavior.flee_timer < 0.f) {
-					enemyMotion.velocity = { 0.f, 0.f };
-					enemyBehavior.state = BossState::IDLE;
-					enemyBehavior.cool_down = 3000.f;
-					enemyBehavior.is_fleeing = false;
-				}
-			}
-			break;
-		}
-
-		default:
-			break;
-	}
-	
-	return enemyBehavior.state;
-}
-
-FinalBossState AISystem::handleFinalBossBehaviour(Entity& enemyEntity, FinalBossAI& enemyBehavior, float dist, vec2 direction, bool playerDetected, float elapsed_ms)
-{
-	Motion& enemyMotion = registry.motions.get(enemyEntity);
-	Enemy& enemy = registry.enemies.get(enemyEntity);
+	Enemy& enemy = *enemyPtr;
 
 	switch (enemyBehavior.state)
 	{
@@ -459,7 +310,6 @@ FinalBossState AISystem::handleFinalBossBehaviour(Entity& enemyEntity, FinalBoss
 			if (playerDetected)
 			{
 				enemyBehavior.state = FinalBossState::SPAWN_1;
-				enemyBehavior.cool_down = FINAL_BOSS_BASE_COOLDOWN;
 			}
 			break;
 		}
@@ -468,8 +318,6 @@ FinalBossState AISystem::handleFinalBossBehaviour(Entity& enemyEntity, FinalBoss
 		{
 			if (!enemyBehavior.has_spawned) {
 				// spawn
-				ProceduralMap& map = registry.proceduralMaps.components[0];
-				std::vector<std::vector<tileType>> rawMap = map.map;
 				std::vector<std::vector<int>> spawnmap;
 
 				if (enemyBehavior.phase == 1) {
@@ -546,7 +394,8 @@ FinalBossState AISystem::handleFinalBossBehaviour(Entity& enemyEntity, FinalBoss
 				for (int i = 0; i < spawnmap.size(); i++) {
 					for (int j = 0; j < spawnmap[i].size(); j++) {
 						if (spawnmap[i][j] == 2) {
-							createDenderite(nullptr, gridCellToPosition({j ,i}));
+							vec2 position = gridCellToPosition({j ,i});
+							commands.push([position]() { createDenderite(nullptr, position); });
 						}
 					}
 				}
@@ -555,8 +404,8 @@ FinalBossState AISystem::handleFinalBossBehaviour(Entity& enemyEntity, FinalBoss
 			} else {
 				if (registry.denderiteAIs.size() == 0) {
 					enemyBehavior.state = FinalBossState::SPIRAL_SHOOT_1; // Just shooting
-					enemyBehavior.shoot_cool_down = FINAL_BOSS_BASE_SHOOT_COOLDOWN;
-					enemyBehavior.cool_down = FINAL_BOSS_BASE_COOLDOWN;
+					enemyBehavior.shoot_cool_down.start(FINAL_BOSS_BASE_SHOOT_COOLDOWN);
+					enemyBehavior.spiral_duration.start(FINAL_BOSS_SHOOT_DURATION);
 					enemyBehavior.has_spawned = false;
 				}
 			}
@@ -564,51 +413,44 @@ FinalBossState AISystem::handleFinalBossBehaviour(Entity& enemyEntity, FinalBoss
 		}
 
 		case FinalBossState::SPIRAL_SHOOT_1: {
-			enemyBehavior.spiral_duration -= elapsed_ms;
-			enemyBehavior.shoot_cool_down -= elapsed_ms;
-
-			if (enemyBehavior.shoot_cool_down <= 0.f) {
+			if (enemyBehavior.shoot_cool_down.due()) {
+				// copy these out, creating projectiles can reallocate the motion array under enemyMotion
+				vec2 bossPosition = enemyMotion.position;
+				float spawnRadius = enemyMotion.scale.x / 3.f;
 
-				if (enemyBehavior.phase == 1 || enemyBehavior.phase == 2) {				
+				if (enemyBehavior.phase == 1 || enemyBehavior.phase == 2) {
 					int angleStep = 30;
 					int totalBullets = 360 / angleStep;
-					float baseAngle = static_cast<float>(rand() % 360) + static_cast<float>(rand() % 45); // randomized patterns
-					
-					for (int i = 0; i < totalBullets; ++i)
-					{
-						float angleDeg = baseAngle + i * angleStep;
-						float angleRad = glm::radians(angleDeg);
-					
-						vec2 dir = { cosf(angleRad), sinf(angleRad) };
-						vec2 velocity = dir * PROJECTILE_SPEED * 2.f;
-
-						Motion& refreshedMotion = registry.motions.get(enemyEntity); 
-						vec2 spawnPos = refreshedMotion.position + dir * refreshedMotion.scale.x / 3.f;
-
-						createFinalBossProjectile(spawnPos, FINAL_BOSS_PROJECTILE, velocity, enemyBehavior.phase);
-					
-						if (enemyBehavior.phase == 2)
-							Entity spiralProjectile = createFinalBossProjectile(spawnPos, FINAL_BOSS_PROJECTILE, velocity, enemyBehavior.phase);
-						enemyBehavior.shoot_cool_down = FINAL_BOSS_BASE_SHOOT_COOLDOWN;
-					}
+					float baseAngle = static_cast<float>(final_boss_rng() % 360) + static_cast<float>(final_boss_rng() % 45); // randomized patterns
+					float firstAngle = glm::radians(baseAngle);
+					float stepAngle = glm::radians(static_cast<float>(angleStep));
+
+					int phase = enemyBehavior.phase;
+					commands.push([bossPosition, spawnRadius, firstAngle, stepAngle, totalBullets, phase]() {
+						BULLET_KIND kind = phase == 2 ? BULLET_KIND::FINAL_BOSS_SPIRAL : BULLET_KIND::FINAL_BOSS;
+						enemy_bullets.ring(kind, bossPosition, spawnRadius, firstAngle, stepAngle, totalBullets, PROJECTILE_SPEED * 2.f, FINAL_BOSS_PROJECTILE);
+						// the second phase has always fired every bullet twice
+						if (phase == 2)
+							enemy_bullets.ring(kind, bossPosition, spawnRadius, firstAngle, stepAngle, totalBullets, PROJECTILE_SPEED * 2.f, FINAL_BOSS_PROJECTILE);
+					});
+					enemyBehavior.shoot_cool_down.start(FINAL_BOSS_BASE_SHOOT_COOLDOWN);
 				} else {
-					Motion& refreshedMotion = registry.motions.get(enemyEntity); 
 					vec2 dir = direction;
 					vec2 velocity = dir * PROJECTILE_SPEED * 0.5f;
 
-					Entity eyeBallProjectile_1 = createFinalBossProjectile(refreshedMotion.position - 50.f, FINAL_BOSS_PROJECTILE, velocity, 3);
-					Entity eyeBallProjectile_2 = createFinalBossProjectile(refreshedMotion.position + 50.f, FINAL_BOSS_PROJECTILE, velocity, 3);
-					enemyBehavior.shoot_cool_down = FINAL_BOSS_EYEBALL_SHOOT_COOLDOWN;
+					commands.push([bossPosition, velocity]() {
+						createFinalBossProjectile(bossPosition - 50.f, FINAL_BOSS_PROJECTILE, velocity);
+						createFinalBossProjectile(bossPosition + 50.f, FINAL_BOSS_PROJECTILE, velocity);
+					});
+					enemyBehavior.shoot_cool_down.start(FINAL_BOSS_EYEBALL_SHOOT_COOLDOWN);
 				}
 			}
 
-			if (enemyBehavior.spiral_duration <= 0.f) {
+			if (enemyBehavior.spiral_duration.due()) {
 				enemyBehavior.state = FinalBossState::TIRED;
-				changeAnimationFrames(enemyEntity, 0, 7);
+				commands.push([enemyEntity]() { changeAnimationFrames(enemyEntity, 0, 7); });
 
-				enemyBehavior.spiral_duration = FINAL_BOSS_SHOOT_DURATION;
-				enemyBehavior.shoot_cool_down = FINAL_BOSS_BASE_SHOOT_COOLDOWN;
-				enemyBehavior.cool_down = FINAL_BOSS_TIRED_COOLDOWN;
+				enemyBehavior.cool_down.start(FINAL_BOSS_TIRED_COOLDOWN);
 			}
 
 			break;
@@ -619,20 +461,15 @@ FinalBossState AISystem::handleFinalBossBehaviour(Entity& enemyEntity, FinalBoss
 			if (enemy.health <= 2/3.f * enemy.total_health && enemyBehavior.phase == 1) {
 				enemyBehavior.phase = 2;
 				enemyBehavior.state = FinalBossState::SPAWN_1;
-				enemyBehavior.cool_down = FINAL_BOSS_BASE_COOLDOWN;
-				changeAnimationFrames(enemyEntity, 8, 10);
+				commands.push([enemyEntity]() { changeAnimationFrames(enemyEntity, 8, 10); });
 			} else if (enemy.health <= 1/3.f * enemy.total_health && enemyBehavior.phase == 2) {
 				enemyBehavior.phase = 3;
 				enemyBehavior.state = FinalBossState::SPAWN_1;
-				enemyBehavior.cool_down = FINAL_BOSS_BASE_COOLDOWN;
-				changeAnimationFrames(enemyEntity, 8, 10);
+				commands.push([enemyEntity]() { changeAnimationFrames(enemyEntity, 8, 10); });
 			} else {
-				enemyBehavior.cool_down -= elapsed_ms;
-				if (enemyBehavior.cool_down <= 0.f) {
+				if (enemyBehavior.cool_down.due()) {
 					enemyBehavior.state = FinalBossState::SPAWN_1;
-					enemyBehavior.shoot_cool_down = FINAL_BOSS_BASE_SHOOT_COOLDOWN;
-					enemyBehavior.cool_down = FINAL_BOSS_BASE_COOLDOWN;
-					changeAnimationFrames(enemyEntity, 8, 10);
+					commands.push([enemyEntity]() { changeAnimationFrames(enemyEntity, 8, 10); });
 				}
 			}
 			break;
@@ -642,163 +479,398 @@ FinalBossState AISystem::handleFinalBossBehaviour(Entity& enemyEntity, FinalBoss
 	return enemyBehavior.state;
 }
 
-DenderiteState AISystem::handleDenderiteBehavior(Entity& enemyEntity, DenderiteAI& enemyBehavior, float dist, vec2 direction, bool playerDetected, float elapsed_ms)
+void AISystem::stepSpikeEnemies(float elapsed_ms, AICommandQueue& commands)
 {
-	Motion& enemyMotion = registry.motions.get(enemyEntity);
-	Enemy& enemy = registry.enemies.get(enemyEntity);
+	auto& ais = registry.spikeEnemyAIs;
+	for (size_t i = 0; i < ais.size(); i++)
+	{
+		if (!spike_batch.scheduled[i])
+			continue;
 
-	switch (enemyBehavior.state) {
+		SpikeEnemyAI& enemyBehavior = ais.components[i];
+		bool playerDetected = spike_batch.detected[i];
 
-		case DenderiteState::HUNT:
+		// undetected enemies only patrol/decay, they never look at the player
+		float dist = 0.f;
+		vec2 direction = { 0.f, 0.f };
+		if (playerDetected || enemyBehavior.state == SpikeEnemyState::CHASING)
 		{
-			if (playerDetected) {
-				enemyBehavior.state = DenderiteState::PIERCE;
-				enemyBehavior.chargeTime = 2000.f;
-				enemyBehavior.isCharging = true;
-			}
-			break;
+			dist = spike_batch.distance(i);
+			direction = spike_batch.direction(i);
 		}
 
-		case DenderiteState::PIERCE:
-		{
-			const float pierceSpeed = 1500.f;
+		enemyBehavior.state = handleSpikeEnemyBehavior(ais.entities[i], spike_batch.motion(i), enemyBehavior, dist, direction, playerDetected, spike_batch.step_ms[i], commands);
+	}
+}
 
-			if (enemyBehavior.isCharging) {
-				enemyBehavior.chargeTime -= elapsed_ms;
-				enemyMotion.velocity = vec2(0.f);
+void AISystem::stepRBCEnemies(float elapsed_ms, AICommandQueue& commands)
+{
+	auto& ais = registry.rbcEnemyAIs;
+	gatherBehaviours(ais, rbc_behaviours, rbc_table);
+	runBehaviours(rbc_table, rbc_behaviours, rbc_batch, rbc_rng, commands);
+	for (size_t i = 0; i < ais.size(); i++)
+	{
+		RBCEnemyAI& ai = ais.components[i];
+		scatterBehaviour(ai, rbc_behaviours, i);
+		ai.state = (RBCEnemyState)rbc_table.states[ai.behaviourState].tag;
+	}
+}
 
-				enemyMotion.angle = atan2(direction.y, direction.x) * (180.f / M_PI) + 90.f;
+void AISystem::stepBacteriophages(float elapsed_ms, AICommandQueue& commands)
+{
+	auto& ais = registry.bacteriophageAIs;
+	for (size_t i = 0; i < ais.size(); i++)
+	{
+		if (!bacteriophage_batch.scheduled[i])
+			continue;
 
-				if (enemyBehavior.chargeTime <= 0.f) {
-					vec2 locked_direction = glm::normalize(direction);
-					enemyMotion.velocity = locked_direction * pierceSpeed;
-					
-					enemyBehavior.isCharging = false;
-					enemyBehavior.chargeTime = 0.f;
-					enemyBehavior.shootCoolDown = 1000.f;
-				}
-			} else {
-				enemyBehavior.chargeDuration -= elapsed_ms;
-				if (enemyBehavior.chargeDuration <= 0.f) {
-					enemyMotion.velocity = { 0.f, 0.f };
-					enemyBehavior.state = DenderiteState::SHOOT;
-				}
-			}
-			break;
-		}
+		BacteriophageAI& enemyBehavior = ais.components[i];
+		bool playerDetected = bacteriophage_batch.detected[i];
 
-		case DenderiteState::SHOOT:
+		// the keep-away target is only used while the player is in range
+		vec2 directionToPlayer = { 0.f, 0.f };
+		vec2 positionToReach = player_position;
+		if (playerDetected)
 		{
-			if (enemyMotion.angle != 0.f) {
-				const float smoothing_factor = 0.1f;
-
-				enemyMotion.angle = glm::lerp(enemyMotion.angle, 0.f, smoothing_factor);
+			directionToPlayer = bacteriophage_batch.direction(i);
+			float circleAngle = (2 * M_PI / MAX_BACTERIOPHAGE_COUNT) * enemyBehavior.placement_index;
+			positionToReach = player_position + vec2(cosf(circleAngle) * BACTERIOPHAGE_ENEMY_KEEP_AWAY_RADIUS, sinf(circleAngle) * SPIKE_ENEMY_DETECTION_RADIUS);
+		}
 
-				if (std::fabs(enemyMotion.angle) < 0.1f) {
-					enemyMotion.angle = 0.f;
-				}
-			}
+		enemyBehavior.state = handleBacteriophageBehavior(bacteriophage_batch.motion(i), enemyBehavior, playerDetected, bacteriophage_batch.step_ms[i], positionToReach, directionToPlayer);
+	}
+}
 
-			enemyMotion.velocity = {0.f, 0.f};
+void AISystem::stepBosses(float elapsed_ms, AICommandQueue& commands)
+{
+	auto& ais = registry.bossAIs;
+	gatherBehaviours(ais, boss_behaviours, boss_table);
+	for (size_t i = 0; i < ais.size(); i++)
+	{
+		Enemy* enemy = boss_batch.enemies[i];
+		boss_behaviours.health_ratio[i] = enemy ? enemy->health / enemy->total_health : 1.f;
+		boss_behaviours.projectile_size[i] = ais.components[i].projectile_size;
+	}
 
-			enemyBehavior.shootCoolDown -= elapsed_ms;
-			if (enemyBehavior.shootCoolDown <= 0.f) {
-				createProjectile(enemyMotion.position, {PROJECTILE_SIZE, PROJECTILE_SIZE}, direction * DENDERITE_PROJECTILE_SPEED, PROJECTILE_DAMAGE);
-				enemyBehavior.shootCoolDown = 1000.0f; 
-			}
-			break;
-		}
+	runBehaviours(boss_table, boss_behaviours, boss_batch, boss_rng, commands);
+	for (size_t i = 0; i < ais.size(); i++)
+	{
+		BossAI& ai = ais.components[i];
+		scatterBehaviour(ai, boss_behaviours, i);
+		const BehaviourState& state = boss_table.states[ai.behaviourState];
+		ai.state = (BossState)state.tag;
+		ai.is_charging = state.charging;
 	}
+}
 
-	return enemyBehavior.state;
+void AISystem::stepFinalBosses(float elapsed_ms, AICommandQueue& commands)
+{
+	auto& ais = registry.finalBossAIs;
+	for (size_t i = 0; i < ais.size(); i++)
+	{
+		FinalBossAI& enemyBehavior = ais.components[i];
+		enemyBehavior.state = handleFinalBossBehaviour(ais.entities[i], final_boss_batch.motion(i), final_boss_batch.enemies[i], enemyBehavior,
+			final_boss_batch.distance(i), final_boss_batch.direction(i), final_boss_batch.detected[i], elapsed_ms, commands);
+	}
 }
 
-// handle AI behavior for all enemies with according parameters
-void AISystem::step(float elapsed_ms)
+void AISystem::stepDenderites(float elapsed_ms, AICommandQueue& commands)
 {
+	auto& ais = registry.denderiteAIs;
+	gatherBehaviours(ais, denderite_behaviours, denderite_table);
+	runBehaviours(denderite_table, denderite_behaviours, denderite_batch, denderite_rng, commands);
+	for (size_t i = 0; i < ais.size(); i++)
+	{
+		DenderiteAI& ai = ais.components[i];
+		scatterBehaviour(ai, denderite_behaviours, i);
+		const BehaviourState& state = denderite_table.states[ai.behaviourState];
+		ai.state = (DenderiteState)state.tag;
+		ai.isCharging = state.charging;
+	}
+}
 
-	auto playerMotion = registry.motions.get(registry.players.entities[0]);
+void BehaviourBatch::resize(size_t n)
+{
+	state.resize(n);
+	timer.resize(n);
+	repeat_timer.resize(n);
+	health_ratio.assign(n, 1.f);
+	projectile_size.assign(n, vec2(PROJECTILE_SIZE, PROJECTILE_SIZE));
+}
 
-	for (auto& enemyEntity : registry.spikeEnemyAIs.entities)
+template <typename AI>
+void AISystem::gatherBehaviours(ComponentContainer<AI>& ais, BehaviourBatch& behaviours, const BehaviourTable& table)
+{
+	behaviours.resize(ais.size());
+	for (size_t i = 0; i < ais.size(); i++)
 	{
-		SpikeEnemyAI& enemyBehavior = registry.spikeEnemyAIs.get(enemyEntity);
-		Motion& enemyMotion = registry.motions.get(enemyEntity);
-		Animation& enemyAnimation = registry.animations.get(enemyEntity);
+		AI& ai = ais.components[i];
+		// spawned (or loaded) straight into an enum state, pick it up from there
+		if (ai.behaviourState < 0 || ai.behaviourState >= (int)table.states.size())
+		{
+			int state = table.stateForTag((int)ai.state);
+			ai.behaviourState = state >= 0 ? state : 0;
+			ai.behaviourTimer.start(table.spawn_delay_ms);
+			ai.behaviourRepeatTimer.start(table.states[ai.behaviourState].first_repeat_ms);
+		}
+		behaviours.state[i] = ai.behaviourState;
+		behaviours.timer[i] = ai.behaviourTimer;
+		behaviours.repeat_timer[i] = ai.behaviourRepeatTimer;
+	}
+}
 
-		vec2 direction;
-		float dist = 0;
-		bool playerDetected = isPlayerInRadius(playerMotion.position, enemyMotion.position, dist, direction, enemyBehavior.detectionRadius);
+void AISystem::scatterBehaviour(EnemyAI& ai, const BehaviourBatch& behaviours, size_t i)
+{
+	ai.behaviourState = behaviours.state[i];
+	ai.behaviourTimer = behaviours.timer[i];
+	ai.behaviourRepeatTimer = behaviours.repeat_timer[i];
+}
 
-		enemyBehavior.state = handleSpikeEnemyBehavior(enemyEntity, enemyBehavior, dist, direction, playerDetected, elapsed_ms);	
-	}
-	
-	for (auto& enemyEntity : registry.rbcEnemyAIs.entities)
+// the interpreter: every table-driven enemy goes through the same few steps each frame
+// on_tick -> on_repeat when due -> first matching transition, the timers are deadlines so nothing ticks them
+void AISystem::runBehaviours(const BehaviourTable& table, BehaviourBatch& behaviours, const AIBatch& batch, std::default_random_engine& rng, AICommandQueue& commands)
+{
+	if (table.states.empty())
+		return;
+
+	for (size_t i = 0; i < behaviours.size(); i++)
 	{
-		RBCEnemyAI& enemyBehavior = registry.rbcEnemyAIs.get(enemyEntity);
-		Motion& enemyMotion = registry.motions.get(enemyEntity);
-		Animation& enemyAnimation = registry.animations.get(enemyEntity);
+		if (!batch.scheduled[i])
+			continue;
+
+		const BehaviourState* state = &table.states[behaviours.state[i]];
 
-		vec2 direction;
-		float dist = 0;
-		bool playerDetected = isPlayerInRadius(playerMotion.position, enemyMotion.position, dist, direction, enemyBehavior.detectionRadius);
+		runBehaviourActions(state->on_tick, *state, behaviours, batch, i, rng, commands);
 
-		enemyBehavior.state = handleRBCBehavior(enemyEntity, enemyBehavior, dist, direction, playerDetected, elapsed_ms);
+		if (state->repeat_ms > 0.f)
+		{
+			if (behaviours.repeat_timer[i].due())
+			{
+				runBehaviourActions(state->on_repeat, *state, behaviours, batch, i, rng, commands);
+				behaviours.repeat_timer[i].start(state->repeat_ms);
+			}
+		}
 
-		EnemyAI castedEnemyBehavior = (EnemyAI)enemyBehavior;
-		enemyBehavior.patrolForwards = castedEnemyBehavior.patrolForwards;
-		enemyBehavior.patrolTime = castedEnemyBehavior.patrolTime;
-		enemyBehavior.patrolOrigin = castedEnemyBehavior.patrolOrigin;
+		bool detected = batch.detected[i];
+		for (const BehaviourTransition& transition : state->transitions)
+		{
+			if (transition.after_timer && !behaviours.timer[i].due())
+				continue;
+			if (transition.player_detected != -1 && transition.player_detected != (int)detected)
+				continue;
+			if (transition.health_below >= 0.f && behaviours.health_ratio[i] >= transition.health_below)
+				continue;
+
+			int next = transition.targets[rng() % transition.targets.size()];
+			runBehaviourActions(state->on_exit, *state, behaviours, batch, i, rng, commands);
+
+			behaviours.state[i] = next;
+			state = &table.states[next];
+			behaviours.timer[i].start(state->duration_ms);
+			behaviours.repeat_timer[i].start(state->first_repeat_ms);
+			runBehaviourActions(state->on_enter, *state, behaviours, batch, i, rng, commands);
+			break;
+		}
 	}
+}
+
+void AISystem::runBehaviourActions(const std::vector<BehaviourAction>& actions, const BehaviourState& state, const BehaviourBatch& behaviours,
+	const AIBatch& batch, size_t i, std::default_random_engine& rng, AICommandQueue& commands)
+{
+	Motion& motion = batch.motion(i);
 
-	for (auto& enemyEntity : registry.bacteriophageAIs.entities)
+	for (BehaviourAction action : actions)
 	{
-		BacteriophageAI& enemyBehavior = registry.bacteriophageAIs.get(enemyEntity);
-		Motion& enemyMotion = registry.motions.get(enemyEntity);
+		switch (action)
+		{
+		case BehaviourAction::STOP:
+			motion.velocity = { 0.f, 0.f };
+			break;
 
-		vec2 direction;
-		float dist = 0;
-		bool playerDetected = isPlayerInRadius(playerMotion.position, enemyMotion.position, dist, direction, enemyBehavior.detectionRadius);
-		
-		vec2 directionToPlayer = glm::normalize(playerMotion.position - enemyMotion.position);
-		float circleAngle = (2 * M_PI / MAX_BACTERIOPHAGE_COUNT) * enemyBehavior.placement_index;
-		vec2 positionToReach = playerMotion.position + vec2(cosf(circleAngle) * BACTERIOPHAGE_ENEMY_KEEP_AWAY_RADIUS, sinf(circleAngle) * SPIKE_ENEMY_DETECTION_RADIUS);
+		case BehaviourAction::FACE_PLAYER:
+		{
+			vec2 direction = batch.direction(i);
+			motion.angle = atan2(direction.y, direction.x) * (180.f / M_PI) + 90.f;
+			break;
+		}
 
-		enemyBehavior.state = handleBacteriophageBehavior(enemyEntity, enemyBehavior, direction, playerDetected, elapsed_ms, positionToReach, directionToPlayer);
-	}
+		case BehaviourAction::SETTLE_ANGLE:
+			if (motion.angle != 0.f)
+			{
+				const float smoothing_factor = 0.1f;
+				motion.angle = glm::lerp(motion.angle, 0.f, smoothing_factor);
+				if (std::fabs(motion.angle) < 0.1f)
+					motion.angle = 0.f;
+			}
+			break;
 
-	for (auto& enemyEntity : registry.bossAIs.entities)
-	{
-		BossAI& enemyBehavior = registry.bossAIs.get(enemyEntity);
-		Motion& enemyMotion = registry.motions.get(enemyEntity);
+		case BehaviourAction::DASH_AT_PLAYER:
+			motion.velocity = batch.direction(i) * state.speed;
+			break;
 
-		vec2 direction;
-		float dist = 0;
-		bool playerDetected = isPlayerInRadius(playerMotion.position, enemyMotion.position, dist, direction, enemyBehavior.detectionRadius);
+		case BehaviourAction::FLEE_PLAYER:
+			motion.velocity = -batch.direction(i) * state.speed;
+			break;
 
-		enemyBehavior.state = handleBossBehaviour(enemyEntity, enemyBehavior, dist, direction, playerDetected, elapsed_ms);
+		case BehaviourAction::RUN_FROM_PLAYER:
+			if (batch.detected[i] && batch.dist_sq[i] > 0.001f * 0.001f)
+			{
+				// run away from character by adjusting direction directly opposite from player
+				vec2 direction = batch.direction(i);
+				float new_angle = atan2(direction.y, direction.x);
+				new_angle *= (360.f / (2 * M_PI)) + 90.f;
+				if (new_angle < 0)
+					new_angle += 360;
+				motion.angle = new_angle;
+				motion.velocity = -direction * state.speed;
+			}
+			break;
+
+		case BehaviourAction::RANDOM_DRIFT:
+		{
+			std::uniform_real_distribution<float> uniform_dist(0.0f, 360.f);
+			motion.angle = uniform_dist(rng);
+			motion.velocity = vec2(cos(motion.angle), sin(motion.angle)) * state.speed;
+			break;
+		}
+
+		case BehaviourAction::SHOOT_RING:
+		{
+			vec2 position = motion.position;
+			float spawnRadius = motion.scale.x / 3.f;
+			vec2 size = behaviours.projectile_size[i];
+			float step = glm::radians(state.ring_step_deg);
+			int count = (int)ceilf(360.f / state.ring_step_deg);
+			float speed = state.projectile_speed;
+			commands.push([position, spawnRadius, size, step, count, speed]() {
+				enemy_bullets.ring(BULLET_KIND::BOSS, position, spawnRadius, 0.f, step, count, speed, size);
+			});
+			break;
+		}
+
+		case BehaviourAction::SHOOT_AT_PLAYER:
+		{
+			vec2 position = motion.position;
+			vec2 aim = batch.direction(i);
+			int count = state.fan_count;
+			float spread = glm::radians(state.fan_spread_deg);
+			float speed = state.projectile_speed;
+			commands.push([position, aim, count, spread, speed]() {
+				enemy_bullets.fan(BULLET_KIND::ENEMY, position, aim, count, spread, speed, {PROJECTILE_SIZE, PROJECTILE_SIZE});
+			});
+			break;
+		}
+
+		default:
+			break;
+		}
 	}
+}
 
-	for (auto& enemyEntity : registry.finalBossAIs.entities)
-	{
-		FinalBossAI& enemyBehavior = registry.finalBossAIs.get(enemyEntity);
-		Motion& enemyMotion = registry.motions.get(enemyEntity);
+template <typename AI>
+void AISystem::gatherEnemies(ComponentContainer<AI>& ais, AIBatch& batch)
+{
+	batch.enemies.resize(ais.size());
+	for (size_t i = 0; i < ais.size(); i++)
+		batch.enemies[i] = registry.enemies.has(ais.entities[i]) ? &registry.enemies.get(ais.entities[i]) : nullptr;
+}
 
-		vec2 direction;
-		float dist = 0;
-		bool playerDetected = isPlayerInRadius(playerMotion.position, enemyMotion.position, dist, direction, enemyBehavior.detectionRadius);
+template <typename AI>
+void AISystem::scheduleBatch(ComponentContainer<AI>& ais, AIBatch& batch, float elapsed_ms)
+{
+	const float half_width = WINDOW_WIDTH_PX / 2.f;
+	const float half_height = WINDOW_HEIGHT_PX / 2.f;
 
-		enemyBehavior.state = handleFinalBossBehaviour(enemyEntity, enemyBehavior, dist, direction, playerDetected, elapsed_ms);
+	for (size_t i = 0; i < ais.size(); i++)
+	{
+		vec2 offset = batch.motion(i).position - camera_position;
+		float screens = max(fabs(offset.x) / half_width, fabs(offset.y) / half_height);
+
+		size_t tier = 0;
+		while (tier + 1 < lod_tiers.size() && screens > lod_tiers[tier].max_distance)
+			tier++;
+
+		// only the first tier is exempt from stretching, it's what the player is looking at
+		unsigned int interval = lod_tiers[tier].frame_interval;
+		if (tier > 0)
+			interval *= lod_stretch;
+
+		// stagger by entity id so a far group doesn't all update on the same frame
+		AI& ai = ais.components[i];
+		ai.lodPendingMs += elapsed_ms;
+		batch.scheduled[i] = interval <= 1 || (frame_counter + (unsigned int)ais.entities[i]) % interval == 0;
+		if (batch.scheduled[i])
+		{
+			batch.step_ms[i] = ai.lodPendingMs;
+			ai.lodPendingMs = 0.f;
+		}
 	}
+}
 
-	for (auto& enemyEntity : registry.denderiteAIs.entities)
+// handle AI behavior for all enemies with according parameters
+void AISystem::step(float elapsed_ms)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	Entity player_entity = registry.players.entities[0];
+	player_position = registry.motions.get(player_entity).position;
+	player_detection_range = registry.players.get(player_entity).detection_range;
+	camera_position = registry.cameras.size() > 0 ? registry.cameras.components[0].position : player_position;
+
+	glfw_time = glfwGetTime();
+
+	// gather everything that needs registry lookups up front, the jobs below only touch
+	// their own AI components and the motions they were handed
+	gatherBatch(registry.spikeEnemyAIs, spike_batch, elapsed_ms);
+	scheduleBatch(registry.spikeEnemyAIs, spike_batch, elapsed_ms);
+	gatherBatch(registry.rbcEnemyAIs, rbc_batch, elapsed_ms);
+	scheduleBatch(registry.rbcEnemyAIs, rbc_batch, elapsed_ms);
+	gatherBatch(registry.bacteriophageAIs, bacteriophage_batch, elapsed_ms);
+	scheduleBatch(registry.bacteriophageAIs, bacteriophage_batch, elapsed_ms);
+	gatherBatch(registry.bossAIs, boss_batch, elapsed_ms);
+	gatherEnemies(registry.bossAIs, boss_batch);
+	gatherBatch(registry.finalBossAIs, final_boss_batch, elapsed_ms);
+	gatherEnemies(registry.finalBossAIs, final_boss_batch);
+	gatherBatch(registry.denderiteAIs, denderite_batch, elapsed_ms);
+
+	std::function<void()> jobs[AI_ARCHETYPE_COUNT] = {
+		[&]() { stepSpikeEnemies(elapsed_ms, command_queues[0]); },
+		[&]() { stepRBCEnemies(elapsed_ms, command_queues[1]); },
+		[&]() { stepBacteriophages(elapsed_ms, command_queues[2]); },
+		[&]() { stepBosses(elapsed_ms, command_queues[3]); },
+		[&]() { stepFinalBosses(elapsed_ms, command_queues[4]); },
+		[&]() { stepDenderites(elapsed_ms, command_queues[5]); },
+	};
+
+	size_t enemy_count = spike_batch.size() + rbc_batch.size() + bacteriophage_batch.size() +
+		boss_batch.size() + final_boss_batch.size() + denderite_batch.size();
+
+	if (enemy_count >= AI_PARALLEL_MIN_ENEMIES)
+	{
+		// main thread takes the first archetype while the workers take the rest
+		std::future<void> pending[AI_ARCHETYPE_COUNT - 1];
+		for (int i = 1; i < AI_ARCHETYPE_COUNT; i++)
+			pending[i - 1] = workers.submit(jobs[i]);
+		jobs[0]();
+		for (std::future<void>& job : pending)
+			job.get();
+	}
+	else
 	{
-		DenderiteAI& enemyBehavior = registry.denderiteAIs.get(enemyEntity);
-		Motion& enemyMotion = registry.motions.get(enemyEntity);
+		for (std::function<void()>& job : jobs)
+			job();
+	}
 
-		vec2 direction;
-		float dist = 0;
-		bool playerDetected = isPlayerInRadius(playerMotion.position, enemyMotion.position, dist, direction, enemyBehavior.detectionRadius);
+	// apply side effects in archetype order so the result doesn't depend on thread timing
+	for (AICommandQueue& queue : command_queues)
+		queue.apply();
 
-		enemyBehavior.state = handleDenderiteBehavior(enemyEntity, enemyBehavior, dist, direction, playerDetected, elapsed_ms);
-	}
+	frame_counter++;
+
+	// stretch the off-screen tiers while over budget, relax once there's headroom again
+	last_step_ms = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	if (last_step_ms > AI_TIME_BUDGET_MS && lod_stretch < AI_LOD_MAX_STRETCH)
+		lod_stretch *= 2;
+	else if (last_step_ms < AI_TIME_BUDGET_MS / 2.f && lod_stretch > 1)
+		lod_stretch /= 2;
 }
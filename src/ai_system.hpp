@@ -2,21 +2,163 @@
 
 #include "common.hpp"
 #include "render_system.hpp"
+#include "behaviour_table.hpp"
+#include "thread_pool.hpp"
 #include "tinyECS/registry.hpp"
 
+#include <functional>
+#include <random>
+
+// spike, RBC, bacteriophage, boss, final boss, denderite
+const int AI_ARCHETYPE_COUNT = 6;
+// below this many enemies the jobs just run inline, handing them to workers costs more than it saves
+const size_t AI_PARALLEL_MIN_ENEMIES = 64;
+
+// Per-archetype scratch for the batched update. Positions are gathered once per frame so
+// the player distance test runs over flat arrays instead of per-enemy registry lookups.
+struct AIBatch
+{
+	// indices into registry.motions rather than pointers, creating projectiles/effects mid-update
+	// can reallocate the motion array but never reorders it
+	std::vector<unsigned int> motion_index;
+	std::vector<float> offset_x;	// player - enemy
+	std::vector<float> offset_y;
+	std::vector<float> dist_sq;
+	std::vector<float> radius_sq;	// detection radius already scaled by the player's detection range
+	std::vector<unsigned char> detected;
+
+	// LOD schedule: whether the state machine runs this frame and with how much time
+	std::vector<unsigned char> scheduled;
+	std::vector<float> step_ms;
+
+	// only gathered for the bosses, which read their health ratio
+	std::vector<Enemy*> enemies;
+
+	void resize(size_t n);
+	size_t size() const { return motion_index.size(); }
+	Motion& motion(size_t i) const { return registry.motions.components[motion_index[i]]; }
+
+	// distance/direction to the player, only computed for enemies that actually react to it
+	float distance(size_t i) const { return sqrtf(dist_sq[i]); }
+	vec2 direction(size_t i) const { return glm::normalize(vec2(offset_x[i], offset_y[i])); }
+};
+
+// Squared distance to the player for a whole archetype. offset_x/offset_y hold the enemy positions
+// on the way in and the offsets to the player on the way out.
+void detectPlayer(size_t n, float player_x, float player_y, const float* radius_sq,
+	float* offset_x, float* offset_y, float* dist_sq, unsigned char* detected);
+
+// State machine data for the table-driven archetypes, gathered from the AI components each frame
+struct BehaviourBatch
+{
+	std::vector<int> state;			// index into BehaviourTable::states
+	std::vector<Deadline> timer;
+	std::vector<Deadline> repeat_timer;
+	std::vector<float> health_ratio;
+	std::vector<vec2> projectile_size;
+
+	void resize(size_t n);
+	size_t size() const { return state.size(); }
+};
+
+// Side effects (spawning, damage, animation changes) recorded by an archetype's update.
+// Updates can run on worker threads, so anything that adds/removes components or touches
+// another entity's components is deferred and applied on the main thread after the join.
+class AICommandQueue
+{
+public:
+	void push(std::function<void()> command) { commands.push_back(std::move(command)); }
+	void apply();
+
+private:
+	std::vector<std::function<void()>> commands;
+};
+
+// Enemies within max_distance of the camera (in half-screens) update every frame_interval frames.
+// Tiers are checked in order, anything past the last tier uses the last tier's interval.
+struct AILodTier
+{
+	float max_distance;
+	unsigned int frame_interval;
+};
+
 class AISystem
 {
 public:
+	AISystem();
+
 	void step(float elapsed_ms);
 
+	void setLodTiers(const std::vector<AILodTier>& tiers);
+
+	// wall time of the last step, for the budget and debugging
+	float lastStepMs() const { return last_step_ms; }
+
 private:
-	bool isPlayerInRadius(vec2 player, vec2 enemy, float& distance, vec2& direction, float detectionRadius);
+	// fills the batch for one archetype and runs the squared distance pass
+	template <typename AI>
+	void gatherBatch(ComponentContainer<AI>& ais, AIBatch& batch, float elapsed_ms);
+
+	// looks up the Enemy component of each AI entity, for the archetypes that read their health
+	template <typename AI>
+	void gatherEnemies(ComponentContainer<AI>& ais, AIBatch& batch);
+
+	// table-driven archetypes (boss, denderite, rbc) copy their state machine in and out of a BehaviourBatch
+	template <typename AI>
+	void gatherBehaviours(ComponentContainer<AI>& ais, BehaviourBatch& behaviours, const BehaviourTable& table);
+	void scatterBehaviour(EnemyAI& ai, const BehaviourBatch& behaviours, size_t i);
+	void runBehaviours(const BehaviourTable& table, BehaviourBatch& behaviours, const AIBatch& batch, std::default_random_engine& rng, AICommandQueue& commands);
+	void runBehaviourActions(const std::vector<BehaviourAction>& actions, const BehaviourState& state, const BehaviourBatch& behaviours,
+		const AIBatch& batch, size_t i, std::default_random_engine& rng, AICommandQueue& commands);
+
+	// decides which enemies of a regular archetype run this frame, bosses and denderites always do
+	template <typename AI>
+	void scheduleBatch(ComponentContainer<AI>& ais, AIBatch& batch, float elapsed_ms);
+
+	// one update per archetype, these run as parallel jobs
+	void stepSpikeEnemies(float elapsed_ms, AICommandQueue& commands);
+	void stepRBCEnemies(float elapsed_ms, AICommandQueue& commands);
+	void stepBacteriophages(float elapsed_ms, AICommandQueue& commands);
+	void stepBosses(float elapsed_ms, AICommandQueue& commands);
+	void stepFinalBosses(float elapsed_ms, AICommandQueue& commands);
+	void stepDenderites(float elapsed_ms, AICommandQueue& commands);
+
+	SpikeEnemyState handleSpikeEnemyBehavior(Entity enemyEntity, Motion& enemyMotion, SpikeEnemyAI& enemyBehavior, float dist, vec2 direction, bool playerDetected, float elapsed_ms, AICommandQueue& commands);
+	BacteriophageState handleBacteriophageBehavior(Motion& enemyMotion, BacteriophageAI& enemyBehavior, bool playerDetected, float elapsed_ms, vec2 positionToReach, vec2 directionToPlayer);
+	FinalBossState handleFinalBossBehaviour(Entity enemyEntity, Motion& enemyMotion, Enemy* enemyPtr, FinalBossAI& enemyBehavior, float dist, vec2 direction, bool playerDetected, float elapsed_ms, AICommandQueue& commands);
+
+	// player state shared by all archetypes for this frame
+	vec2 player_position;
+	float player_detection_range = 1.f;
+	vec2 camera_position;
+
+	std::vector<AILodTier> lod_tiers;
+	unsigned int lod_stretch = 1;	// multiplier on off-screen intervals while over budget
+	unsigned int frame_counter = 0;
+	float last_step_ms = 0.f;
+
+	double glfw_time = 0.0;
+
+	// each archetype job draws from its own generator so threads never share rng state
+	std::default_random_engine rbc_rng;
+	std::default_random_engine boss_rng;
+	std::default_random_engine final_boss_rng;
+	std::default_random_engine denderite_rng;
+
+	BehaviourTable boss_table;
+	BehaviourTable denderite_table;
+	BehaviourTable rbc_table;
+	BehaviourBatch boss_behaviours;
+	BehaviourBatch denderite_behaviours;
+	BehaviourBatch rbc_behaviours;
 
-	SpikeEnemyState handleSpikeEnemyBehavior(Entity& enemyEntity, SpikeEnemyAI& enemyBehavior, float dist, vec2 direction, bool playerDetected, float elapsed_ms);
-	RBCEnemyState handleRBCBehavior(Entity& enemyEntity, RBCEnemyAI& enemyBehavior, float dist, vec2 direction, bool playerDetected, float elapsed_ms);
-	BacteriophageState handleBacteriophageBehavior(Entity& enemyEntity, BacteriophageAI& enemyBehavior, vec2 direction, bool playerDetected, float elapsed_ms, vec2 positionToReach, vec2 directionToPlayer);
-	BossState handleBossBehaviour(Entity& enemyEntity, BossAI& enemyBehavior, float dist, vec2 direction, bool playerDetected, float elapsed_ms);
-	FinalBossState handleFinalBossBehaviour(Entity& enemyEntity, FinalBossAI& enemyBehavior, float dist, vec2 direction, bool playerDetected, float elapsed_ms);
-	DenderiteState handleDenderiteBehavior(Entity& enemyEntity, DenderiteAI& enemyBehavior, float dist, vec2 direction, bool playerDetected, float elapsed_ms);
+	ThreadPool workers;
+	AICommandQueue command_queues[AI_ARCHETYPE_COUNT];
 
+	AIBatch spike_batch;
+	AIBatch rbc_batch;
+	AIBatch bacteriophage_batch;
+	AIBatch boss_batch;
+	AIBatch final_boss_batch;
+	AIBatch denderite_batch;
 };
\ No newline at end of file
@@ -1,105 +1,141 @@
 #include "animation_system.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+AnimationClipTable animation_clips;
+ExpiryQueue animation_expiries;
+
+int AnimationClipTable::clipId(const AnimationClip& clip)
+{
+	for (size_t i = 0; i < clips.size(); i++)
+	{
+		const AnimationClip& c = clips[i];
+		if (c.start_frame == clip.start_frame && c.end_frame == clip.end_frame && c.frame_ms == clip.frame_ms && c.loop == clip.loop)
+			return (int)i;
+	}
+
+	assert(clip.end_frame >= clip.start_frame && clip.frame_ms > 0.f);
+	const int count = clip.end_frame - clip.start_frame + 1;
+	int clip_period = INT_MAX;
+	if (clip.loop == ANIM_LOOP_TYPES::LOOP)
+		clip_period = count;
+	else if (clip.loop == ANIM_LOOP_TYPES::PING_PONG)
+		clip_period = std::max(2 * count - 2, 1); // the end frames show once per cycle
+
+	clips.push_back(clip);
+	start_frame.push_back(clip.start_frame);
+	frame_count.push_back(count);
+	frame_ms.push_back(clip.frame_ms);
+	period.push_back(clip_period);
+	wrap_ms.push_back(clip.loop == ANIM_LOOP_TYPES::NO_LOOP ? std::numeric_limits<float>::infinity() : clip_period * clip.frame_ms);
+	return (int)clips.size() - 1;
+}
+
 void AnimationSystem::step(float elapsed_ms)
 {
 	// TODO: add conditional for game over -> game state?
-    std::vector<Entity> removals;
 
-	for (auto& entity : registry.animations.entities)
+	// The frame comes straight from the time since the clip started, so a slow frame skips
+	// sprite frames rather than slowing the animation down. The first pass only touches the
+	// packed Animation components and the clip arrays, the sprite sheets are looked up after
+	// for the few animations whose frame actually changed.
+	std::vector<Animation>& animations = registry.animations.components;
+	const int count = (int)animations.size();
+	changed.clear();
+	for (int i = 0; i < count; i++)
 	{
-		Animation& animation = registry.animations.get(entity);
-		SpriteSheetImage& sprite_sheet = registry.spriteSheetImages.get(entity);
+		Animation& animation = animations[i];
+		const int c = animation.clip;
 
-		// check if frame should be updated
-		if (animation.time_since_last_frame >= animation.time_per_frame)
-		{
-			// we've reached the last frame going forwards
-			if (animation.forwards && sprite_sheet.current_frame + 1 > animation.end_frame)
-			{
-				if (animation.loop == ANIM_LOOP_TYPES::NO_LOOP)
-				{
-					// animation is over since no loop, remove the entity from game
-					// registry.remove_all_components_of(entity);
-                    removals.push_back(entity);
-                }
-				else if (animation.loop == ANIM_LOOP_TYPES::PING_PONG)
-				{
-					// go backwards through the frames
-					sprite_sheet.current_frame--;
-					animation.forwards = !animation.forwards;
-				}
-				else if (animation.loop == ANIM_LOOP_TYPES::LOOP)
-				{
-					sprite_sheet.current_frame = animation.start_frame;
-				}
-			}
-			// we've reached the last frame going backwards
-			else if (!animation.forwards && sprite_sheet.current_frame - 1 < animation.start_frame)
-			{
-				if (!animation.forwards && animation.loop == ANIM_LOOP_TYPES::NO_LOOP)
-				{
-					// registry.remove_all_components_of(entity);
-                    removals.push_back(entity);
-                }
-				else if (animation.loop == ANIM_LOOP_TYPES::PING_PONG)
-				{
-					// go forwards through the frames
-					sprite_sheet.current_frame++;
-					animation.forwards = !animation.forwards;
-				}
-				else if (animation.loop == ANIM_LOOP_TYPES::LOOP)
-				{
-					sprite_sheet.current_frame = animation.end_frame;
-				}
-			}
-			else if (animation.forwards)
-			{
-				sprite_sheet.current_frame++;
-			}
-			else
-			{
-				sprite_sheet.current_frame--;
-			}
-
-			animation.time_since_last_frame = 0;
-		}
-		else
+		// a step can be longer than a short clip, so the wrap is a remainder rather than one period
+		float time_ms = animation.time_ms + elapsed_ms;
+		if (time_ms >= animation_clips.wrap_ms[c])
+			time_ms = std::fmod(time_ms, animation_clips.wrap_ms[c]);
+		animation.time_ms = time_ms;
+
+		// forwards through the period, and for PING_PONG back down once past the last frame,
+		// NO_LOOP clips hold their last frame
+		const int played = (int)(time_ms / animation_clips.frame_ms[c]);
+		const int position = played % animation_clips.period[c];
+		const int offset = position < animation_clips.frame_count[c] ? position : animation_clips.period[c] - position;
+		const int frame = animation_clips.start_frame[c] + std::min(offset, animation_clips.frame_count[c] - 1);
+		if (frame != animation.frame)
 		{
-			animation.time_since_last_frame += elapsed_ms;
+			animation.frame = frame;
+			changed.push_back(i);
 		}
 	}
 
-    int size = removals.size();
-    for(int i = 0; i < size; i++) {
-        registry.remove_all_components_of(removals[i]);
-    }
+	for (int i : changed)
+		registry.spriteSheetImages.get(registry.animations.entities[i]).current_frame = animations[i].frame;
+
+	// finished NO_LOOP animations, only the ones due are looked at
+	animation_expiries.advance(elapsed_ms);
+}
+
+void playAnimation(Entity entity, int clip, ExpiryQueue::Callback on_finish)
+{
+	Animation& animation = registry.animations.has(entity) ? registry.animations.get(entity) : registry.animations.emplace(entity);
+	animation.clip = clip;
+	animation.time_ms = 0.f;
+	animation.frame = -1;
+
+	const AnimationClip& played = animation_clips.clip(clip);
+	if (played.loop != ANIM_LOOP_TYPES::NO_LOOP)
+	{
+		animation_expiries.cancel(entity);
+		return;
+	}
+	if (!on_finish)
+	{
+		on_finish = [](Entity e) {
+			// animation is over since no loop, remove the entity from game
+			if (registry.animations.has(e))
+				registry.remove_all_components_of(e);
+		};
+	}
+	animation_expiries.schedule(entity, played.frame_ms * (played.end_frame - played.start_frame + 1), std::move(on_finish));
 }
 
 void changeAnimationFrames(Entity entity, int start_frame, int end_frame)
 {
 	Animation& animation = registry.animations.get(entity);
-	animation.start_frame = start_frame;
-	animation.end_frame = end_frame;
+	AnimationClip clip = animation_clips.clip(animation.clip);
+	clip.start_frame = start_frame;
+	clip.end_frame = end_frame;
+
+	// the AI asks again every update while it stays in a state
+	const int id = animation_clips.clipId(clip);
+	if (id != animation.clip)
+	{
+		animation.clip = id;
+		animation.time_ms = 0.f;
+	}
 }
 
 void toggleDashAnimation(Entity entity, bool is_dashing)
 {
 	Animation &a = registry.animations.get(entity);
 	SpriteSheetImage &s = registry.spriteSheetImages.get(entity);
+	AnimationClip clip = animation_clips.clip(a.clip);
 
 	if (is_dashing)
 	{
-		a.start_frame = player_dash_start;
-		a.end_frame = player_dash_end;
-		a.loop = ANIM_LOOP_TYPES::LOOP;
+		clip.start_frame = player_dash_start;
+		clip.end_frame = player_dash_end;
+		clip.loop = ANIM_LOOP_TYPES::LOOP;
 	}
 	else
 	{
-		a.start_frame = player_idle_start;
-		a.end_frame = player_idle_end;
-		a.loop = ANIM_LOOP_TYPES::PING_PONG;
+		clip.start_frame = player_idle_start;
+		clip.end_frame = player_idle_end;
+		clip.loop = ANIM_LOOP_TYPES::PING_PONG;
 	}
 
-	s.current_frame = a.start_frame;
-	a.forwards = true;
-}
\ No newline at end of file
+	a.clip = animation_clips.clipId(clip);
+	a.time_ms = 0.f;
+	a.frame = clip.start_frame;
+	s.current_frame = clip.start_frame;
+}
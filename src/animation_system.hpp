@@ -1,9 +1,52 @@
+#pragma once
+
 #include <iostream>
+#include <climits>
+#include <vector>
 #include "common.hpp"
+#include "expiry_queue.hpp"
 #include "tinyECS/tiny_ecs.hpp"
 #include "tinyECS/components.hpp"
 #include "tinyECS/registry.hpp"
 
+// the frames [start_frame, end_frame] of a sprite sheet, frame_ms each.
+// A NO_LOOP clip holds its last frame, started with playAnimation its entity is removed (or handed to on_finish) after.
+struct AnimationClip
+{
+	int start_frame = 0;
+	int end_frame = 0;
+	float frame_ms = 100.f;
+	ANIM_LOOP_TYPES loop = ANIM_LOOP_TYPES::NO_LOOP;
+};
+
+// Every clip in use, Animation::clip is an index into it. Entities playing the same frames at the
+// same speed share a clip. Next to the clips are the numbers AnimationSystem::step needs, one array
+// each, worked out per loop type once here so the step does the same arithmetic for every clip.
+class AnimationClipTable
+{
+public:
+	// the id of an equal clip, added first if there isn't one yet
+	int clipId(const AnimationClip& clip);
+
+	const AnimationClip& clip(int id) const { return clips[id]; }
+	int size() const { return (int)clips.size(); }
+
+	std::vector<int> start_frame;
+	std::vector<int> frame_count;
+	std::vector<float> frame_ms;
+	// frames played before the sequence repeats, PING_PONG goes there and back, INT_MAX for NO_LOOP
+	std::vector<int> period;
+	// time wraps back by this much so it never loses precision, infinite for NO_LOOP
+	std::vector<float> wrap_ms;
+
+private:
+	std::vector<AnimationClip> clips;
+};
+
+// defined in animation_system.cpp
+extern AnimationClipTable animation_clips;
+// the ends of NO_LOOP animations, advanced by AnimationSystem::step
+extern ExpiryQueue animation_expiries;
 
 class AnimationSystem
 {
@@ -12,9 +55,18 @@ public:
 	void step(float elapsed_ms);
 
 	AnimationSystem() {}
+
+private:
+	// indices of the animations whose frame changed this step, reused every step
+	std::vector<int> changed;
 };
 
 // animation utils
+// gives the entity the clip from its first frame, a NO_LOOP clip then calls on_finish once it has played,
+// which removes the entity unless given
+void playAnimation(Entity entity, int clip, ExpiryQueue::Callback on_finish = nullptr);
+
+// the entity's clip with other frames, restarting only if that is a different clip
 void changeAnimationFrames(Entity entity, int start_frame, int end_frame);
 
-void toggleDashAnimation(Entity entity, bool is_dashing);
\ No newline at end of file
+void toggleDashAnimation(Entity entity, bool is_dashing);
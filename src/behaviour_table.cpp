@@ -0,0 +1,222 @@
+#include "behaviour_table.hpp"
+
+#include "../ext/json/json.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <unordered_map>
+
+using json = nlohmann::json;
+
+static const char* ACTION_NAMES[(int)BehaviourAction::ACTION_COUNT] = {
+	"stop",
+	"face_player",
+	"settle_angle",
+	"dash_at_player",
+	"flee_player",
+	"run_from_player",
+	"random_drift",
+	"shoot_ring",
+	"shoot_at_player",
+};
+
+int BehaviourTable::stateForTag(int tag) const
+{
+	for (size_t i = 0; i < states.size(); i++)
+		if (states[i].tag == tag)
+			return (int)i;
+	return -1;
+}
+
+// error reporting shared by the readers below, prefixed with where in the file we are
+struct TableReader
+{
+	std::string where;
+	bool ok = true;
+
+	void error(const std::string& message)
+	{
+		std::cerr << "ERROR: behaviours.json: " << where << ": " << message << std::endl;
+		ok = false;
+	}
+
+	float readNumber(const json& object, const char* key, float fallback, bool allow_negative = false)
+	{
+		if (!object.contains(key))
+			return fallback;
+		if (!object[key].is_number())
+		{
+			error(std::string(key) + " must be a number");
+			return fallback;
+		}
+		float value = object[key].get<float>();
+		if (value < 0.f && !allow_negative)
+		{
+			error(std::string(key) + " can't be negative");
+			return fallback;
+		}
+		return value;
+	}
+
+	bool readBool(const json& object, const char* key, bool fallback)
+	{
+		if (!object.contains(key))
+			return fallback;
+		if (!object[key].is_boolean())
+		{
+			error(std::string(key) + " must be true or false");
+			return fallback;
+		}
+		return object[key].get<bool>();
+	}
+
+	std::vector<BehaviourAction> readActions(const json& object, const char* key)
+	{
+		std::vector<BehaviourAction> actions;
+		if (!object.contains(key))
+			return actions;
+		if (!object[key].is_array())
+		{
+			error(std::string(key) + " must be a list of actions");
+			return actions;
+		}
+		for (const json& name : object[key])
+		{
+			int found = -1;
+			for (int i = 0; i < (int)BehaviourAction::ACTION_COUNT; i++)
+				if (name.is_string() && name.get<std::string>() == ACTION_NAMES[i])
+					found = i;
+			if (found == -1)
+				error("unknown action " + name.dump() + " in " + key);
+			else
+				actions.push_back((BehaviourAction)found);
+		}
+		return actions;
+	}
+};
+
+bool loadBehaviourTable(const std::string& path, const std::string& archetype, const std::vector<std::string>& tag_names, BehaviourTable& table)
+{
+	std::ifstream file(path);
+	if (!file.is_open())
+	{
+		std::cerr << "ERROR: could not open behaviour table " << path << std::endl;
+		return false;
+	}
+
+	json root = json::parse(file, nullptr, false);
+	if (root.is_discarded() || !root.is_object())
+	{
+		std::cerr << "ERROR: behaviour table " << path << " is not valid json" << std::endl;
+		return false;
+	}
+
+	TableReader reader;
+	reader.where = archetype;
+
+	if (!root.contains(archetype) || !root[archetype].is_object())
+	{
+		reader.error("missing");
+		return false;
+	}
+	const json& entry = root[archetype];
+	if (!entry.contains("states") || !entry["states"].is_array() || entry["states"].empty())
+	{
+		reader.error("needs a non-empty list of states");
+		return false;
+	}
+
+	BehaviourTable loaded;
+	loaded.spawn_delay_ms = reader.readNumber(entry, "spawn_delay_ms", 0.f);
+
+	// names first, transitions can point forwards
+	std::unordered_map<std::string, int> state_ids;
+	for (const json& state : entry["states"])
+	{
+		if (!state.is_object() || !state.contains("name") || !state["name"].is_string())
+		{
+			reader.error("every state needs a name");
+			return false;
+		}
+		std::string name = state["name"].get<std::string>();
+		if (state_ids.count(name))
+			reader.error("state " + name + " is declared twice");
+		int id = (int)state_ids.size();
+		state_ids[name] = id;
+	}
+
+	for (const json& state : entry["states"])
+	{
+		BehaviourState def;
+		def.name = state["name"].get<std::string>();
+		reader.where = archetype + "." + def.name;
+
+		std::string tag = state.contains("tag") && state["tag"].is_string() ? state["tag"].get<std::string>() : "";
+		auto tag_it = std::find(tag_names.begin(), tag_names.end(), tag);
+		if (tag_it == tag_names.end())
+			reader.error("tag " + (tag.empty() ? std::string("is missing") : tag + " is not a state of " + archetype));
+		else
+			def.tag = (int)(tag_it - tag_names.begin());
+
+		def.charging = reader.readBool(state, "charging", false);
+		def.duration_ms = reader.readNumber(state, "duration_ms", 0.f);
+		def.repeat_ms = reader.readNumber(state, "repeat_ms", 0.f);
+		def.first_repeat_ms = reader.readNumber(state, "first_repeat_ms", def.repeat_ms);
+		def.speed = reader.readNumber(state, "speed", 0.f);
+		def.projectile_speed = reader.readNumber(state, "projectile_speed", 0.f);
+		def.ring_step_deg = reader.readNumber(state, "ring_step_deg", 30.f);
+		if (def.ring_step_deg <= 0.f)
+			reader.error("ring_step_deg has to be positive");
+		def.fan_count = (int)reader.readNumber(state, "fan_count", 1.f);
+		if (def.fan_count < 1)
+			reader.error("fan_count has to be at least 1");
+		def.fan_spread_deg = reader.readNumber(state, "fan_spread_deg", 0.f);
+
+		def.on_enter = reader.readActions(state, "on_enter");
+		def.on_tick = reader.readActions(state, "on_tick");
+		def.on_repeat = reader.readActions(state, "on_repeat");
+		def.on_exit = reader.readActions(state, "on_exit");
+
+		if (!def.on_repeat.empty() && def.repeat_ms <= 0.f)
+			reader.error("on_repeat needs a positive repeat_ms");
+
+		if (state.contains("transitions"))
+		{
+			if (!state["transitions"].is_array())
+				reader.error("transitions must be a list");
+			else for (const json& t : state["transitions"])
+			{
+				BehaviourTransition transition;
+				transition.after_timer = reader.readBool(t, "after_timer", false);
+				if (t.contains("player_detected"))
+					transition.player_detected = reader.readBool(t, "player_detected", false) ? 1 : 0;
+				transition.health_below = reader.readNumber(t, "health_below", -1.f, true);
+
+				if (transition.after_timer && def.duration_ms <= 0.f)
+					reader.error("after_timer transition needs a positive duration_ms");
+				if (!transition.after_timer && transition.player_detected == -1 && transition.health_below < 0.f)
+					reader.error("transition has no condition, it would fire every frame");
+
+				if (!t.contains("to") || !t["to"].is_array() || t["to"].empty())
+					reader.error("transition needs a non-empty \"to\" list");
+				else for (const json& target : t["to"])
+				{
+					if (!target.is_string() || !state_ids.count(target.get<std::string>()))
+						reader.error("transition to unknown state " + target.dump());
+					else
+						transition.targets.push_back(state_ids[target.get<std::string>()]);
+				}
+				def.transitions.push_back(transition);
+			}
+		}
+
+		loaded.states.push_back(def);
+	}
+
+	if (!reader.ok)
+		return false;
+
+	table = std::move(loaded);
+	return true;
+}
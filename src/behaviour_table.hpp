@@ -0,0 +1,72 @@
+#pragma once
+
+#include "common.hpp"
+
+#include <string>
+#include <vector>
+
+// Data-driven enemy state machines, see data/ai/behaviours.json.
+// Each archetype is a list of states with timers, actions and transitions; AISystem interprets them.
+
+// the fixed vocabulary of things a state can do, implemented in AISystem::runBehaviourAction
+enum class BehaviourAction
+{
+	STOP = 0,			// zero velocity
+	FACE_PLAYER,		// turn the sprite towards the player
+	SETTLE_ANGLE,		// ease the sprite back to upright
+	DASH_AT_PLAYER,		// velocity towards the player at speed
+	FLEE_PLAYER,		// velocity away from the player at speed
+	RUN_FROM_PLAYER,	// like flee, but only while detected (rbc)
+	RANDOM_DRIFT,		// random heading at speed
+	SHOOT_RING,			// boss projectiles every ring_step_deg at projectile_speed
+	SHOOT_AT_PLAYER,	// fan_count projectiles over fan_spread_deg, centred on the player, at projectile_speed
+	ACTION_COUNT
+};
+
+struct BehaviourTransition
+{
+	// every condition that is set has to hold, the first matching transition wins
+	bool after_timer = false;
+	int player_detected = -1;	// -1 don't care, 0 lost, 1 detected
+	float health_below = -1.f;	// health ratio, ignored when negative
+
+	// picked uniformly at random
+	std::vector<int> targets;
+};
+
+struct BehaviourState
+{
+	std::string name;
+	int tag = 0;				// value of the archetype's state enum other systems look at
+	bool charging = false;		// mirrored into the AI component for collision code
+
+	float duration_ms = 0.f;	// timer for after_timer transitions
+	float repeat_ms = 0.f;		// period of on_repeat, 0 disables it
+	float first_repeat_ms = 0.f;
+
+	float speed = 0.f;
+	float projectile_speed = 0.f;
+	float ring_step_deg = 30.f;
+	int fan_count = 1;
+	float fan_spread_deg = 0.f;
+
+	std::vector<BehaviourAction> on_enter;
+	std::vector<BehaviourAction> on_tick;
+	std::vector<BehaviourAction> on_repeat;
+	std::vector<BehaviourAction> on_exit;
+	std::vector<BehaviourTransition> transitions;
+};
+
+struct BehaviourTable
+{
+	std::vector<BehaviourState> states;
+	// timer for entities that were spawned straight into a state rather than entering it
+	float spawn_delay_ms = 0.f;
+
+	// first state carrying the tag, -1 if there is none
+	int stateForTag(int tag) const;
+};
+
+// Loads and validates the table for one archetype. tag_names are the archetype's enum values in order,
+// so "tag": "RUMBLE" resolves to BossState::RUMBLE. Problems are reported to stderr.
+bool loadBehaviourTable(const std::string& path, const std::string& archetype, const std::vector<std::string>& tag_names, BehaviourTable& table);
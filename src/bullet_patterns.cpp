@@ -0,0 +1,130 @@
+#include "bullet_patterns.hpp"
+#include "game_time.hpp"
+
+BulletBuffer enemy_bullets;
+
+BulletBuffer::BulletBuffer()
+{
+	kinds[(int)BULLET_KIND::BOSS] = { TEXTURE_ASSET_ID::BOSS_PROJECTILE, BOSS_PROJECTILE_DAMAGE, PROJECTILE_TTL_MS, 0.f };
+	kinds[(int)BULLET_KIND::FINAL_BOSS] = { TEXTURE_ASSET_ID::BOSS_PROJECTILE, BOSS_PROJECTILE_DAMAGE, 7500.f, 0.f };
+	kinds[(int)BULLET_KIND::FINAL_BOSS_SPIRAL] = { TEXTURE_ASSET_ID::BOSS_PROJECTILE, BOSS_PROJECTILE_DAMAGE, 7500.f, 0.5f };
+	kinds[(int)BULLET_KIND::ENEMY] = { TEXTURE_ASSET_ID::PROJECTILE, PROJECTILE_DAMAGE, PROJECTILE_TTL_MS, 0.f };
+
+	// allocated once, firing never reallocates
+	for (std::vector<float>* field : {&position_x, &position_y, &velocity_x, &velocity_y, &scale_x, &scale_y})
+		field->resize(CAPACITY);
+	expires_at_ms.resize(CAPACITY);
+	kind.resize(CAPACITY);
+}
+
+void BulletBuffer::spawn(BULLET_KIND bullet_kind, vec2 position, vec2 velocity, vec2 size)
+{
+	if (count == CAPACITY)
+		return;
+	const int i = count++;
+	position_x[i] = position.x;
+	position_y[i] = position.y;
+	velocity_x[i] = velocity.x;
+	velocity_y[i] = velocity.y;
+	scale_x[i] = size.x;
+	scale_y[i] = size.y;
+	expires_at_ms[i] = gameTime() + kinds[(int)bullet_kind].lifetime_ms;
+	kind[i] = bullet_kind;
+}
+
+void BulletBuffer::kill(int i)
+{
+	const int last = --count;
+	if (i == last)
+		return;
+
+	for (std::vector<float>* field : {&position_x, &position_y, &velocity_x, &velocity_y, &scale_x, &scale_y})
+		(*field)[i] = (*field)[last];
+	expires_at_ms[i] = expires_at_ms[last];
+	kind[i] = kind[last];
+}
+
+void BulletBuffer::ring(BULLET_KIND bullet_kind, vec2 center, float spawn_radius, float first_angle_rad, float step_rad, int n, float speed, vec2 size)
+{
+	// every direction is the one before it turned by step_rad
+	const float step_cos = cosf(step_rad);
+	const float step_sin = sinf(step_rad);
+	vec2 dir = { cosf(first_angle_rad), sinf(first_angle_rad) };
+	for (int b = 0; b < n; b++)
+	{
+		spawn(bullet_kind, center + dir * spawn_radius, dir * speed, size);
+		dir = { dir.x * step_cos - dir.y * step_sin, dir.x * step_sin + dir.y * step_cos };
+	}
+}
+
+void BulletBuffer::fan(BULLET_KIND bullet_kind, vec2 origin, vec2 aim, int n, float spread_rad, float speed, vec2 size)
+{
+	if (n <= 1)
+	{
+		spawn(bullet_kind, origin, aim * speed, size);
+		return;
+	}
+	const float first = atan2f(aim.y, aim.x) - spread_rad * 0.5f;
+	ring(bullet_kind, origin, 0.f, first, spread_rad / (float)(n - 1), n, speed, size);
+}
+
+void BulletBuffer::step(float elapsed_ms)
+{
+	const float step_seconds = elapsed_ms / 1000.f;
+
+	// this step's turn for each kind, the identity for the ones that fly straight
+	std::array<float, bullet_kind_count> turn_cos;
+	std::array<float, bullet_kind_count> turn_sin;
+	for (int k = 0; k < bullet_kind_count; k++)
+	{
+		const float angle = kinds[k].spin_rad_per_s * step_seconds;
+		turn_cos[k] = cosf(angle);
+		turn_sin[k] = sinf(angle);
+	}
+
+	for (int i = 0; i < count; i++)
+	{
+		position_x[i] += velocity_x[i] * step_seconds;
+		position_y[i] += velocity_y[i] * step_seconds;
+
+		const float c = turn_cos[(int)kind[i]];
+		const float s = turn_sin[(int)kind[i]];
+		const float vx = velocity_x[i];
+		const float vy = velocity_y[i];
+		velocity_x[i] = vx * c - vy * s;
+		velocity_y[i] = vx * s + vy * c;
+	}
+
+	// backwards, so kill() only ever moves a bullet that was already looked at
+	const double now = gameTime();
+	for (int i = count - 1; i >= 0; i--)
+	{
+		if (expires_at_ms[i] <= now)
+			kill(i);
+	}
+}
+
+void BulletBuffer::collide(vec2 center, float diameter, std::vector<BulletHit>& hits)
+{
+	hit_indices.clear();
+	for (int i = 0; i < count; i++)
+	{
+		const float dx = position_x[i] - center.x;
+		const float dy = position_y[i] - center.y;
+		const float reach = (diameter + fabsf(scale_x[i])) * 0.5f;
+		if (dx * dx + dy * dy < reach * reach)
+			hit_indices.push_back(i);
+	}
+
+	for (auto it = hit_indices.rbegin(); it != hit_indices.rend(); ++it)
+	{
+		const int i = *it;
+		hits.push_back({ { position_x[i], position_y[i] }, { scale_x[i], scale_y[i] }, kinds[(int)kind[i]].damage });
+		kill(i);
+	}
+}
+
+void BulletBuffer::clear()
+{
+	count = 0;
+}
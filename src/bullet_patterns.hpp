@@ -0,0 +1,85 @@
+#pragma once
+
+#include "common.hpp"
+#include "tinyECS/components.hpp"
+
+#include <array>
+#include <vector>
+
+// What a bullet looks like and how it flies, shared by every bullet of the kind.
+// A spinning kind turns its velocity as it flies, so a ring of them curls into a spiral;
+// the turn is worked out once per kind each step, not per bullet.
+enum class BULLET_KIND
+{
+	BOSS = 0,				// SHOOT_RING of the boss's behaviour table
+	FINAL_BOSS = BOSS + 1,	// rings of the final boss's first phase
+	FINAL_BOSS_SPIRAL = FINAL_BOSS + 1,
+	ENEMY = FINAL_BOSS_SPIRAL + 1, // SHOOT_AT_PLAYER fans
+	BULLET_KIND_COUNT
+};
+const int bullet_kind_count = (int)BULLET_KIND::BULLET_KIND_COUNT;
+
+struct BulletKind
+{
+	TEXTURE_ASSET_ID texture = TEXTURE_ASSET_ID::BOSS_PROJECTILE;
+	float damage = BOSS_PROJECTILE_DAMAGE;
+	float lifetime_ms = PROJECTILE_TTL_MS;
+	float spin_rad_per_s = 0.f;
+};
+
+// a bullet that reached the player, already removed from the buffer
+struct BulletHit
+{
+	vec2 position;
+	vec2 size;
+	float damage;
+};
+
+// Enemy bullets fired as whole patterns. They aren't registry entities: every field is a float
+// array like ParticleBucket, live bullets are always [0, size()) and kill() moves the last one
+// into the freed slot. The patterns write straight into the arrays and step each bullet's direction
+// by one precomputed rotation, so a ring costs one cos/sin pair rather than one per bullet.
+class BulletBuffer
+{
+public:
+	// a few seconds of boss rings plus every denderite shooting, past it new bullets are dropped
+	static const int CAPACITY = 4096;
+
+	BulletBuffer();
+
+	// count bullets first_angle_rad, first_angle_rad + step_rad, ... around center, starting spawn_radius out
+	void ring(BULLET_KIND kind, vec2 center, float spawn_radius, float first_angle_rad, float step_rad, int count, float speed, vec2 size);
+	// count bullets spread evenly over spread_rad, centred on aim (a unit vector)
+	void fan(BULLET_KIND kind, vec2 origin, vec2 aim, int count, float spread_rad, float speed, vec2 size);
+
+	// moves every bullet, turns the spinning kinds and drops the bullets whose lifetime is over
+	void step(float elapsed_ms);
+	// Tests every bullet against a circle of the given diameter in one pass, the same test as
+	// collides() in physics_system.cpp. The bullets inside are removed and appended to hits.
+	void collide(vec2 center, float diameter, std::vector<BulletHit>& hits);
+	void clear();
+
+	int size() const { return count; }
+
+	std::array<BulletKind, bullet_kind_count> kinds;
+
+	std::vector<float> position_x;
+	std::vector<float> position_y;
+	std::vector<float> velocity_x;
+	std::vector<float> velocity_y;
+	std::vector<float> scale_x;
+	std::vector<float> scale_y;
+	std::vector<double> expires_at_ms; // game time, see game_time.hpp
+	std::vector<BULLET_KIND> kind;
+
+private:
+	void spawn(BULLET_KIND kind, vec2 position, vec2 velocity, vec2 size);
+	void kill(int i);
+
+	int count = 0;
+	std::vector<int> hit_indices;
+};
+
+// defined in bullet_patterns.cpp
+// stepped and tested against the player by WorldSystem::handleProjectiles, drawn by RenderSystem::drawBullets
+extern BulletBuffer enemy_bullets;
@@ -115,6 +115,15 @@ const float BACTERIOPHAGE_ENEMY_DETECTION_RADIUS = 500.0f;
 const float BACTERIOPHAGE_ENEMY_SPEED = 150.0f;
 const float NEXT_LEVEL_BLACK_SCREEN_TIMER_MS = 1000.0f;
 
+// AI level of detail: regular enemies away from the camera update less often, see AISystem
+// distances are measured in half-screens from the camera, so 1 is the edge of the screen
+const float AI_LOD_NEAR_DISTANCE = 1.25f;
+const float AI_LOD_MID_DISTANCE = 2.5f;
+const float AI_LOD_FAR_DISTANCE = 5.f;
+// when a frame of AI takes longer than this the off-screen tiers get stretched further
+const float AI_TIME_BUDGET_MS = 2.f;
+const unsigned int AI_LOD_MAX_STRETCH = 8;
+
 // ENEMY STATS
 const float ENEMY_HEALTH = 50;
 const float ENEMY_SPAWN_RATE_MS = 1 * 1000;
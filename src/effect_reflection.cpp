@@ -0,0 +1,129 @@
+#include "effect_reflection.hpp"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <cassert>
+
+void UniformHandle::set(float value) const
+{
+	if (location < 0)
+		return;
+	assert(type == GL_FLOAT);
+	glUniform1f(location, value);
+}
+
+void UniformHandle::set(int value) const
+{
+	if (location < 0)
+		return;
+	assert(type == GL_INT || type == GL_BOOL || type == GL_SAMPLER_2D || type == GL_UNSIGNED_INT_SAMPLER_2D);
+	glUniform1i(location, value);
+}
+
+void UniformHandle::set(const vec2 &value) const
+{
+	if (location < 0)
+		return;
+	assert(type == GL_FLOAT_VEC2);
+	glUniform2fv(location, 1, glm::value_ptr(value));
+}
+
+void UniformHandle::set(const vec3 &value) const
+{
+	if (location < 0)
+		return;
+	assert(type == GL_FLOAT_VEC3);
+	glUniform3fv(location, 1, glm::value_ptr(value));
+}
+
+void UniformHandle::set(const mat3 &value) const
+{
+	if (location < 0)
+		return;
+	assert(type == GL_FLOAT_MAT3);
+	glUniformMatrix3fv(location, 1, GL_FALSE, glm::value_ptr(value));
+}
+
+void UniformHandle::set(const mat4 &value) const
+{
+	if (location < 0)
+		return;
+	assert(type == GL_FLOAT_MAT4);
+	glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value));
+}
+
+// locations an attribute of this type takes up
+static int attributeSlots(GLenum type)
+{
+	switch (type)
+	{
+	case GL_FLOAT_MAT2:
+		return 2;
+	case GL_FLOAT_MAT3:
+		return 3;
+	case GL_FLOAT_MAT4:
+		return 4;
+	default:
+		return 1;
+	}
+}
+
+EffectReflection reflectProgram(GLuint program)
+{
+	EffectReflection reflection;
+	char name[256];
+
+	GLint uniform_total = 0;
+	glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &uniform_total);
+	for (GLint i = 0; i < uniform_total; i++)
+	{
+		GLsizei length = 0;
+		GLint size = 0;
+		GLenum type = GL_NONE;
+		glGetActiveUniform(program, (GLuint)i, sizeof(name), &length, &size, &type, name);
+
+		// arrays are reported as "name[0]"
+		std::string uniform_name(name, length);
+		size_t bracket = uniform_name.find('[');
+		if (bracket != std::string::npos)
+			uniform_name.resize(bracket);
+
+		for (int id = 0; id < uniform_count; id++)
+		{
+			if (uniform_names[id] != uniform_name)
+				continue;
+			UniformHandle &handle = reflection.uniforms[id];
+			handle.location = glGetUniformLocation(program, name);
+			handle.type = type;
+			handle.size = size;
+			break;
+		}
+	}
+
+	GLint attribute_total = 0;
+	glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &attribute_total);
+	for (GLint i = 0; i < attribute_total; i++)
+	{
+		GLsizei length = 0;
+		GLint size = 0;
+		GLenum type = GL_NONE;
+		glGetActiveAttrib(program, (GLuint)i, sizeof(name), &length, &size, &type, name);
+
+		const std::string attribute_name(name, length);
+		const GLint location = glGetAttribLocation(program, name);
+		if (attribute_name == "in_position")
+			reflection.in_position = location;
+		else if (attribute_name == "in_texcoord")
+			reflection.in_texcoord = location;
+		else if (attribute_name == "in_color")
+			reflection.in_color = location;
+		else if (location >= 0)
+		{
+			for (int slot = 0; slot < attributeSlots(type) * size; slot++)
+				reflection.instance_locations.push_back(location + slot);
+		}
+	}
+	gl_has_errors();
+
+	return reflection;
+}
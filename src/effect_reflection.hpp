@@ -0,0 +1,99 @@
+#pragma once
+
+#include "common.hpp"
+
+#include <glm/mat4x4.hpp>
+
+#include <array>
+#include <string>
+#include <vector>
+
+// Uniforms the renderer sets. Their locations are looked up once per program by
+// reflectProgram, the draw code only indexes the table.
+enum class UNIFORM_ID
+{
+	TRANSFORM = 0,
+	PROJECTION = TRANSFORM + 1,
+	FCOLOR = PROJECTION + 1,
+	SAMPLER0 = FCOLOR + 1,
+	TIME = SAMPLER0 + 1,
+	DARKEN_SCREEN_FACTOR = TIME + 1,
+	VIGNETTE_SCREEN_FACTOR = DARKEN_SCREEN_FACTOR + 1,
+	TOTAL_FRAMES = VIGNETTE_SCREEN_FACTOR + 1,
+	CURRENT_FRAME = TOTAL_FRAMES + 1,
+	SPRITE_WIDTH = CURRENT_FRAME + 1,
+	SPRITE_HEIGHT = SPRITE_WIDTH + 1,
+	CAMERA_POSITION = SPRITE_HEIGHT + 1,
+	MAP_WIDTH = CAMERA_POSITION + 1,
+	MAP_HEIGHT = MAP_WIDTH + 1,
+	PLAYER_GRID_POSITION = MAP_HEIGHT + 1,
+	MAP_TEXTURE = PLAYER_GRID_POSITION + 1,
+	MAX_HEALTH = MAP_TEXTURE + 1,
+	CURRENT_HEALTH = MAX_HEALTH + 1,
+	HEALTH_TEXTURE = CURRENT_HEALTH + 1,
+	MAX_DANGER = HEALTH_TEXTURE + 1,
+	CURRENT_DANGER = MAX_DANGER + 1,
+	COOLDOWN_RATIO = CURRENT_DANGER + 1,
+	UNIFORM_COUNT = COOLDOWN_RATIO + 1
+};
+const int uniform_count = (int)UNIFORM_ID::UNIFORM_COUNT;
+
+// glsl names, in UNIFORM_ID order
+const std::array<std::string, uniform_count> uniform_names = {
+	"transform",
+	"projection",
+	"fcolor",
+	"sampler0",
+	"time",
+	"darken_screen_factor",
+	"vignette_screen_factor",
+	"total_frames",
+	"current_frame",
+	"sprite_width",
+	"sprite_height",
+	"camera_position",
+	"map_width",
+	"map_height",
+	"player_grid_position",
+	"map_texture",
+	"max_health",
+	"current_health",
+	"health_texture",
+	"max_danger",
+	"current_danger",
+	"cooldown_ratio"
+};
+
+// One uniform of one program. Setting a uniform the program doesn't have, or that the
+// compiler dropped, does nothing, same as glUniform* with location -1.
+// The setter has to match the glsl type, which is asserted.
+struct UniformHandle
+{
+	GLint location = -1;
+	GLenum type = GL_NONE;
+	GLint size = 0; // array length, 1 for plain uniforms
+
+	void set(float value) const;
+	void set(int value) const;
+	void set(const vec2 &value) const;
+	void set(const vec3 &value) const;
+	void set(const mat3 &value) const;
+	void set(const mat4 &value) const;
+};
+
+struct EffectReflection
+{
+	std::array<UniformHandle, uniform_count> uniforms;
+
+	// per vertex attributes, -1 when the program doesn't read them
+	GLint in_position = -1;
+	GLint in_texcoord = -1;
+	GLint in_color = -1;
+	// every other active attribute is per instance, one entry per location (a mat3 takes three)
+	std::vector<GLint> instance_locations;
+
+	const UniformHandle &operator[](UNIFORM_ID id) const { return uniforms[(int)id]; }
+};
+
+// enumerates the active uniforms and attributes of a linked program
+EffectReflection reflectProgram(GLuint program);
@@ -1,10 +0,0 @@
-#pragma once
-
-#include "tinyECS/registry.hpp"
-
-class EffectSystem
-{
-public:
-    EffectSystem();
-    void step(float elapsed_ms);
-};
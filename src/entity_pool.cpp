@@ -0,0 +1,41 @@
+#include "entity_pool.hpp"
+
+std::array<EntityPool, projectile_archetype_count> projectile_pools;
+// effects only live for a few frames each, fewer are dead at once
+EntityPool effect_pool(64);
+
+Entity EntityPool::acquire(bool& reused)
+{
+	reused = !free.empty();
+	if (!reused)
+	{
+		misses++;
+		return Entity();
+	}
+	hits++;
+	Entity entity = free.back();
+	free.pop_back();
+	return entity;
+}
+
+bool EntityPool::release(Entity entity)
+{
+	if ((int)free.size() >= capacity)
+		return false;
+	free.push_back(entity);
+	return true;
+}
+
+void EntityPool::clear()
+{
+	free.clear();
+	hits = 0;
+	misses = 0;
+}
+
+void clearEntityPools()
+{
+	for (EntityPool& pool : projectile_pools)
+		pool.clear();
+	effect_pool.clear();
+}
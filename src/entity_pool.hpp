@@ -0,0 +1,41 @@
+#pragma once
+
+#include "tinyECS/tiny_ecs.hpp"
+#include "tinyECS/components.hpp"
+
+#include <array>
+#include <vector>
+
+// Dead entities of one archetype parked for reuse. A parked entity keeps every component it had,
+// so its slots and hash map entries stay in the registry, and the factory that takes it back out
+// only resets the data. Bursts of bullets then cost no inserts or removals in the containers.
+// The pool only holds the ids, marking a parked entity inactive is up to the archetype's factory.
+class EntityPool
+{
+public:
+	explicit EntityPool(int capacity = 256) : capacity(capacity) {}
+
+	// a parked entity when there is one (a hit, reused is true), a brand new one otherwise (a miss)
+	Entity acquire(bool& reused);
+	// false once capacity entities are parked, the caller removes this one from the registry instead
+	bool release(Entity entity);
+	// forgets the parked entities, for when the registry is emptied under them
+	void clear();
+
+	int parked() const { return (int)free.size(); }
+
+	int hits = 0;
+	int misses = 0;
+
+private:
+	int capacity;
+	std::vector<Entity> free;
+};
+
+// defined in entity_pool.cpp
+// one pool per projectile factory, indexed by PROJECTILE_ARCHETYPE
+extern std::array<EntityPool, projectile_archetype_count> projectile_pools;
+extern EntityPool effect_pool;
+
+// empties every pool above, restart_game removes the parked entities with everything else
+void clearEntityPools();
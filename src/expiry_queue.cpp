@@ -0,0 +1,43 @@
+#include "expiry_queue.hpp"
+
+#include <algorithm>
+
+ExpiryQueue world_expiries;
+ExpiryQueue ui_expiries;
+
+void ExpiryQueue::schedule(Entity entity, float delay_ms, Callback on_expire)
+{
+	const uint32_t ticket = ++next_ticket;
+	tickets[entity] = ticket;
+	heap.push_back({ now_ms + delay_ms, ticket, entity, std::move(on_expire) });
+	std::push_heap(heap.begin(), heap.end(), later);
+}
+
+void ExpiryQueue::cancel(Entity entity)
+{
+	tickets.erase(entity);
+}
+
+void ExpiryQueue::advance(float elapsed_ms)
+{
+	now_ms += elapsed_ms;
+	while (!heap.empty() && heap.front().deadline_ms <= now_ms)
+	{
+		std::pop_heap(heap.begin(), heap.end(), later);
+		Entry entry = std::move(heap.back());
+		heap.pop_back();
+
+		auto live = tickets.find(entry.entity);
+		if (live == tickets.end() || live->second != entry.ticket)
+			continue;
+		tickets.erase(live);
+		// may schedule again, the loop picks that up if it is already due
+		entry.on_expire(entry.entity);
+	}
+}
+
+void ExpiryQueue::clear()
+{
+	heap.clear();
+	tickets.clear();
+}
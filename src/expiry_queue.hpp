@@ -0,0 +1,52 @@
+#pragma once
+
+#include "tinyECS/tiny_ecs.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+// Fires a callback for an entity once its own clock passes a deadline, for things that just
+// end after a while (projectiles, popups, one-shot animations). Deadlines sit in a min-heap,
+// so advancing costs a comparison plus the entries actually due, not a pass over everything alive.
+// An entity has at most one pending expiry per queue, scheduling again replaces it.
+class ExpiryQueue
+{
+public:
+	using Callback = std::function<void(Entity)>;
+
+	// on_expire(entity) runs from advance() once delay_ms more of this queue's time has passed
+	void schedule(Entity entity, float delay_ms, Callback on_expire);
+	void cancel(Entity entity);
+
+	// moves the clock on, firing what is due in deadline order
+	void advance(float elapsed_ms);
+	void clear();
+
+	double now() const { return now_ms; }
+	int pending() const { return (int)tickets.size(); }
+
+private:
+	struct Entry
+	{
+		double deadline_ms;
+		uint32_t ticket;
+		Entity entity;
+		Callback on_expire;
+	};
+	// the soonest deadline on top
+	static bool later(const Entry& a, const Entry& b) { return a.deadline_ms > b.deadline_ms; }
+
+	std::vector<Entry> heap;
+	// the ticket of each entity's live entry, replaced and cancelled entries stay in the heap until they surface
+	std::unordered_map<unsigned int, uint32_t> tickets;
+	uint32_t next_ticket = 0;
+	double now_ms = 0.0;
+};
+
+// defined in expiry_queue.cpp
+// game time, advanced by WorldSystem::step at the game speed: projectiles
+extern ExpiryQueue world_expiries;
+// real time, advanced by WorldSystem::step: popups
+extern ExpiryQueue ui_expiries;
@@ -0,0 +1,22 @@
+#include "game_time.hpp"
+
+double game_time_ms = 0.0;
+
+void advanceGameTime(float elapsed_ms)
+{
+	game_time_ms += elapsed_ms;
+}
+
+void to_json(nlohmann::json& j, const Deadline& deadline)
+{
+	j = deadline.remaining();
+}
+
+void from_json(const nlohmann::json& j, Deadline& deadline)
+{
+	float remaining_ms = j.get<float>();
+	if (remaining_ms > 0.f)
+		deadline.start(remaining_ms);
+	else
+		deadline.stop();
+}
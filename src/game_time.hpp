@@ -0,0 +1,40 @@
+#pragma once
+
+#include "../ext/json/json.hpp"
+
+// defined in game_time.cpp
+// Milliseconds of play so far, moved on once per frame by WorldSystem::step at the game speed.
+// It stands still whenever the world isn't stepped (paused, shop, cutscenes).
+extern double game_time_ms;
+
+inline double gameTime() { return game_time_ms; }
+void advanceGameTime(float elapsed_ms);
+
+// A countdown kept as the game time it runs out at instead of as time left, so nothing
+// decrements it every frame: start() is the only write and due() is a single comparison.
+// A default (or stopped) Deadline is already due.
+struct Deadline
+{
+	double at_ms = -1.0;
+
+	void start(float duration_ms) { at_ms = game_time_ms + duration_ms; }
+	void stop() { at_ms = -1.0; }
+
+	bool due() const { return game_time_ms >= at_ms; }
+	// 0 once due
+	float remaining() const { return due() ? 0.f : (float)(at_ms - game_time_ms); }
+
+	// true for the first check after a started deadline runs out, which also stops it,
+	// for things that happen once at the end rather than for as long as it is due
+	bool ranOut()
+	{
+		if (at_ms < 0.0 || !due())
+			return false;
+		stop();
+		return true;
+	}
+};
+
+// saved as the time left, the clock itself starts over every launch
+void to_json(nlohmann::json& j, const Deadline& deadline);
+void from_json(const nlohmann::json& j, Deadline& deadline);
@@ -0,0 +1,192 @@
+#include "glyph_atlas.hpp"
+#include "texture_atlas.hpp"
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+#include <iostream>
+
+// all sizes of a pixel font fit on one 512 page, bigger pages only for larger base sizes
+static const int GLYPH_ATLAS_MIN_PAGE_SIZE = 512;
+// dynamic strings (fps, counters) would grow the cache without bound, start over past this
+static const size_t MAX_CACHED_LAYOUTS = 512;
+
+bool GlyphAtlas::init(const std::string &font_filename, unsigned int base_size, const std::vector<unsigned int> &pixel_sizes)
+{
+	this->base_size = base_size;
+
+	FT_Library ft;
+	if (FT_Init_FreeType(&ft))
+	{
+		std::cerr << "ERROR::FREETYPE: Could not init FreeType Library" << std::endl;
+		return false;
+	}
+
+	FT_Face face;
+	if (FT_New_Face(ft, font_filename.c_str(), 0, &face))
+	{
+		std::cerr << "ERROR::FREETYPE: Failed to load font: " << font_filename << std::endl;
+		FT_Done_FreeType(ft);
+		return false;
+	}
+
+	// rasterise every glyph of every size, FreeType reuses the glyph slot so the bitmaps are copied out
+	std::vector<AtlasRect> rects;
+	std::vector<std::vector<unsigned char>> bitmaps;
+	sizes.assign(pixel_sizes.size(), FontSize());
+	for (size_t s = 0; s < pixel_sizes.size(); s++)
+	{
+		sizes[s].pixels = pixel_sizes[s];
+		FT_Set_Pixel_Sizes(face, 0, pixel_sizes[s]);
+		for (int c = GLYPH_FIRST_CHAR; c < GLYPH_LAST_CHAR; c++)
+		{
+			AtlasRect rect;
+			std::vector<unsigned char> bitmap;
+			if (FT_Load_Char(face, c, FT_LOAD_RENDER))
+				std::cerr << "ERROR::FREETYTPE: Failed to load Glyph " << (char)c << std::endl;
+			else
+			{
+				const FT_GlyphSlot slot = face->glyph;
+				Glyph &glyph = sizes[s].glyphs[c - GLYPH_FIRST_CHAR];
+				glyph.size = {(int)slot->bitmap.width, (int)slot->bitmap.rows};
+				glyph.bearing = {slot->bitmap_left, slot->bitmap_top};
+				glyph.advance = (float)(slot->advance.x >> 6); // advance is in 1/64 pixels
+
+				rect.size = glyph.size;
+				bitmap.resize(glyph.size.x * glyph.size.y);
+				for (int row = 0; row < glyph.size.y; row++)
+				{
+					const unsigned char *src = slot->bitmap.buffer + row * slot->bitmap.pitch;
+					std::copy(src, src + glyph.size.x, bitmap.begin() + row * glyph.size.x);
+				}
+			}
+			rects.push_back(rect);
+			bitmaps.push_back(std::move(bitmap));
+		}
+	}
+
+	FT_Done_Face(face);
+	FT_Done_FreeType(ft);
+
+	// one page, doubled until everything fits on it
+	int page_size = GLYPH_ATLAS_MIN_PAGE_SIZE;
+	AtlasReport report = packAtlas(rects, page_size);
+	while (report.pages > 1 && page_size < TEXTURE_ATLAS_PAGE_SIZE)
+	{
+		page_size *= 2;
+		report = packAtlas(rects, page_size);
+	}
+	std::cout << "Glyph atlas: " << report.images << " glyphs in " << report.pages << " page(s) of "
+			  << page_size << "x" << page_size << ", " << (int)(report.efficiency() * 100.f + 0.5f) << "% used" << std::endl;
+
+	// the zero padding around each glyph keeps linear filtering from bleeding in a neighbour
+	std::vector<unsigned char> page(page_size * page_size, 0);
+	for (size_t i = 0; i < rects.size(); i++)
+	{
+		const AtlasRect &rect = rects[i];
+		if (rect.page != 0)
+			continue;
+		for (int row = 0; row < rect.size.y; row++)
+			std::copy(bitmaps[i].begin() + row * rect.size.x, bitmaps[i].begin() + (row + 1) * rect.size.x,
+					  page.begin() + (rect.position.y + row) * page_size + rect.position.x);
+		sizes[i / GLYPH_CHAR_COUNT].glyphs[i % GLYPH_CHAR_COUNT].uv = atlasUV(rect, page_size);
+	}
+
+	// rows of one byte texels aren't 4 byte aligned
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glGenTextures(1, &atlas_texture);
+	glBindTexture(GL_TEXTURE_2D, atlas_texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, page_size, page_size, 0, GL_RED, GL_UNSIGNED_BYTE, page.data());
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	gl_has_errors();
+
+	return report.pages <= 1;
+}
+
+void GlyphAtlas::destroy()
+{
+	glDeleteTextures(1, &atlas_texture);
+	atlas_texture = 0;
+	layouts.clear();
+}
+
+int GlyphAtlas::pickSize(float pixels) const
+{
+	int best = -1;
+	for (int i = 0; i < (int)sizes.size(); i++)
+	{
+		if (sizes[i].pixels < pixels)
+			continue;
+		if (best < 0 || sizes[i].pixels < sizes[best].pixels)
+			best = i;
+	}
+	if (best >= 0)
+		return best;
+
+	// larger than everything baked, stretch the largest
+	best = 0;
+	for (int i = 1; i < (int)sizes.size(); i++)
+	{
+		if (sizes[i].pixels > sizes[best].pixels)
+			best = i;
+	}
+	return best;
+}
+
+const std::vector<vec4> &GlyphAtlas::layout(const std::string &text, int size_index)
+{
+	std::string key(1, (char)size_index);
+	key += text;
+	auto cached = layouts.find(key);
+	if (cached != layouts.end())
+		return cached->second;
+
+	if (layouts.size() >= MAX_CACHED_LAYOUTS)
+		layouts.clear();
+
+	std::vector<vec4> &quads = layouts[key];
+	quads.reserve(text.size() * 6);
+	float pen = 0.f;
+	for (char c : text)
+	{
+		if (c < GLYPH_FIRST_CHAR || c >= GLYPH_LAST_CHAR)
+			continue;
+		const Glyph &glyph = sizes[size_index].glyphs[c - GLYPH_FIRST_CHAR];
+
+		const float x0 = pen + glyph.bearing.x;
+		const float y0 = (float)(glyph.bearing.y - glyph.size.y);
+		const float x1 = x0 + glyph.size.x;
+		const float y1 = y0 + glyph.size.y;
+		pen += glyph.advance;
+		if (glyph.size.x == 0 || glyph.size.y == 0)
+			continue;
+
+		// the bitmap's first row is its top, so v grows downwards while y grows upwards
+		const vec4 &uv = glyph.uv;
+		quads.push_back({x0, y1, uv.x, uv.y});
+		quads.push_back({x0, y0, uv.x, uv.w});
+		quads.push_back({x1, y0, uv.z, uv.w});
+
+		quads.push_back({x0, y1, uv.x, uv.y});
+		quads.push_back({x1, y0, uv.z, uv.w});
+		quads.push_back({x1, y1, uv.z, uv.y});
+	}
+	return quads;
+}
+
+void GlyphAtlas::append(const std::string &text, float x, float y, float scale, const vec3 &color, std::vector<TextVertex> &vertices)
+{
+	if (sizes.empty())
+		return;
+
+	const float pixels = scale * base_size;
+	const int size_index = pickSize(pixels);
+	const float size_scale = pixels / sizes[size_index].pixels;
+
+	for (const vec4 &corner : layout(text, size_index))
+		vertices.push_back({{x + corner.x * size_scale, y + corner.y * size_scale}, {corner.z, corner.w}, color});
+}
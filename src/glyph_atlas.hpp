@@ -0,0 +1,64 @@
+#pragma once
+
+#include "common.hpp"
+
+#include <array>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// first and one past the last character baked, printable ASCII
+const int GLYPH_FIRST_CHAR = 32;
+const int GLYPH_LAST_CHAR = 127;
+const int GLYPH_CHAR_COUNT = GLYPH_LAST_CHAR - GLYPH_FIRST_CHAR;
+
+struct Glyph
+{
+	ivec2 size = {0, 0};	// bitmap size in pixels
+	ivec2 bearing = {0, 0}; // offset from the pen on the baseline to the left/top of the bitmap
+	float advance = 0.f;	// pixels to the next pen position
+	vec4 uv = {0.f, 0.f, 0.f, 0.f};
+};
+
+// One vertex of a glyph quad, six per glyph so a whole frame of text is one glDrawArrays
+struct TextVertex
+{
+	vec2 position;
+	vec2 texcoord;
+	vec3 color;
+};
+
+// All glyphs of one font, rasterised by FreeType at a few pixel sizes and packed into a single
+// R8 texture. Strings are laid out once per size and kept, most of the HUD and shop text is the
+// same from frame to frame.
+class GlyphAtlas
+{
+public:
+	// bakes the font at every size in pixel_sizes, scale 1 in append() is base_size pixels
+	bool init(const std::string &font_filename, unsigned int base_size, const std::vector<unsigned int> &pixel_sizes);
+	void destroy();
+
+	// appends the quads of text with its baseline starting at (x, y), in window pixels
+	void append(const std::string &text, float x, float y, float scale, const vec3 &color, std::vector<TextVertex> &vertices);
+
+	GLuint texture() const { return atlas_texture; }
+	size_t cachedLayouts() const { return layouts.size(); }
+
+private:
+	struct FontSize
+	{
+		unsigned int pixels = 0;
+		std::array<Glyph, GLYPH_CHAR_COUNT> glyphs;
+	};
+
+	// the smallest baked size at least as large as the text is drawn, so glyphs are only shrunk
+	int pickSize(float pixels) const;
+	// (x, y, u, v) of every vertex of text at baked size and origin 0
+	const std::vector<vec4> &layout(const std::string &text, int size_index);
+
+	std::vector<FontSize> sizes;
+	unsigned int base_size = 0;
+	GLuint atlas_texture = 0;
+	// keyed by size index followed by the text
+	std::unordered_map<std::string, std::vector<vec4>> layouts;
+};
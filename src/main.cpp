@@ -1,4 +1,3 @@
-#define GL3W_IMPLEMENTATION
 #include <gl3w.h>
 
 // stdlib
@@ -47,7 +46,7 @@ int main()
 
 	// initialize the main systems
 	renderer_system.init(window);
-	world_system.init(&renderer_system);
+	world_system.init(&renderer_system, &particle_system);
 
 	GameState &current_state = world_system.current_state;
 	GameState &previous_state = world_system.previous_state;
@@ -97,7 +96,9 @@ int main()
 			ai_system.step(elapsed_ms);
 			physics_system.step(elapsed_ms);
 			world_system.handle_collisions();
+			// the only particle step of a frame, after the collisions that spawn death bursts
             particle_system.step(elapsed_ms);
+			renderer_system.setParticleStats(particle_system.stats());
 			animation_system.step(elapsed_ms);
 			renderer_system.draw();
 			renderer_system.drawUIElements();
@@ -0,0 +1,168 @@
+#include "particle_emitters.hpp"
+
+#include "../ext/json/json.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+using json = nlohmann::json;
+
+static const char* EMITTER_NAMES[particle_type_count] = {
+    "death",
+    "ripple",
+};
+
+ParticleEmitter::ParticleEmitter()
+{
+    // constant 1 unless the file says otherwise
+    for (ParticleCurve* curve : {&size_over_life, &alpha_over_life, &red_over_life, &green_over_life,
+                                 &blue_over_life, &follow_speed_over_life})
+        curve->fill(1.f);
+}
+
+// error reporting for the readers below, prefixed with the emitter being read
+struct EmitterReader
+{
+    std::string where;
+    bool ok = true;
+
+    void error(const std::string& message)
+    {
+        std::cerr << "ERROR: emitters.json: " << where << ": " << message << std::endl;
+        ok = false;
+    }
+
+    float readNumber(const json& object, const char* key, float fallback)
+    {
+        if (!object.contains(key))
+            return fallback;
+        if (!object[key].is_number() || object[key].get<float>() < 0.f)
+        {
+            error(std::string(key) + " must be a non-negative number");
+            return fallback;
+        }
+        return object[key].get<float>();
+    }
+
+    // [min, max]
+    vec2 readRange(const json& object, const char* key, vec2 fallback)
+    {
+        if (!object.contains(key))
+            return fallback;
+        const json& range = object[key];
+        if (!range.is_array() || range.size() != 2 || !range[0].is_number() || !range[1].is_number() ||
+            range[0].get<float>() < 0.f || range[0].get<float>() > range[1].get<float>())
+        {
+            error(std::string(key) + " must be [min, max] with 0 <= min <= max");
+            return fallback;
+        }
+        return {range[0].get<float>(), range[1].get<float>()};
+    }
+
+    // Keys are [age, value...] with ages rising from 0 to 1, channel picks the value.
+    // Linear between keys, held flat before the first and after the last.
+    void readCurve(const json& object, const char* key, int channel, int channels, ParticleCurve& curve)
+    {
+        if (!object.contains(key))
+            return;
+        const json& keys = object[key];
+        if (!keys.is_array() || keys.empty())
+        {
+            error(std::string(key) + " must be a list of keys");
+            return;
+        }
+
+        std::vector<float> ages;
+        std::vector<float> values;
+        for (const json& k : keys)
+        {
+            bool valid = k.is_array() && (int)k.size() == 1 + channels;
+            for (size_t i = 0; valid && i < k.size(); i++)
+                valid = k[i].is_number() && k[i].get<float>() >= 0.f;
+            if (!valid || k[0].get<float>() > 1.f || (!ages.empty() && k[0].get<float>() < ages.back()))
+            {
+                error(std::string(key) + " key " + k.dump() + " must be " + (channels == 1 ? "[age, value]" : "[age, r, g, b]") +
+                      ", non-negative, with ages from 0 to 1 in order");
+                return;
+            }
+            ages.push_back(k[0].get<float>());
+            values.push_back(k[1 + channel].get<float>());
+        }
+
+        for (int s = 0; s < PARTICLE_CURVE_SAMPLES; s++)
+        {
+            const float age = (float)s / (float)(PARTICLE_CURVE_SAMPLES - 1);
+            size_t next = 0;
+            while (next < ages.size() && ages[next] < age)
+                next++;
+            if (next == 0)
+                curve[s] = values.front();
+            else if (next == ages.size())
+                curve[s] = values.back();
+            else
+            {
+                const float t = (age - ages[next - 1]) / (ages[next] - ages[next - 1]);
+                curve[s] = values[next - 1] + (values[next] - values[next - 1]) * t;
+            }
+        }
+    }
+};
+
+bool loadParticleEmitters(const std::string& path, ParticleEmitters& emitters)
+{
+    std::ifstream file(path);
+    if (!file.is_open())
+    {
+        std::cerr << "ERROR: could not open particle emitters " << path << std::endl;
+        return false;
+    }
+
+    json root = json::parse(file, nullptr, false);
+    if (root.is_discarded() || !root.is_object())
+    {
+        std::cerr << "ERROR: particle emitters " << path << " is not valid json" << std::endl;
+        return false;
+    }
+
+    bool ok = true;
+    for (int type = 0; type < particle_type_count; type++)
+    {
+        EmitterReader reader;
+        reader.where = EMITTER_NAMES[type];
+        if (!root.contains(reader.where) || !root[reader.where].is_object())
+        {
+            reader.error("missing");
+            ok = false;
+            continue;
+        }
+        const json& entry = root[reader.where];
+
+        ParticleEmitter emitter;
+        emitter.burst_count = (int)reader.readNumber(entry, "burst_count", (float)emitter.burst_count);
+        emitter.spawn_interval_ms = reader.readNumber(entry, "spawn_interval_ms", emitter.spawn_interval_ms);
+        emitter.lifetime_ms = reader.readRange(entry, "lifetime_ms", emitter.lifetime_ms);
+        emitter.speed = reader.readRange(entry, "speed", emitter.speed);
+        emitter.size = reader.readRange(entry, "size", emitter.size);
+        emitter.aspect = reader.readNumber(entry, "aspect", emitter.aspect);
+        emitter.burst_ms = reader.readRange(entry, "burst_ms", emitter.burst_ms);
+        emitter.follow_acceleration = reader.readRange(entry, "follow_acceleration", emitter.follow_acceleration);
+        emitter.damping = reader.readNumber(entry, "damping", emitter.damping);
+        emitter.max_speed = reader.readNumber(entry, "max_speed", emitter.max_speed);
+        reader.readCurve(entry, "size_over_life", 0, 1, emitter.size_over_life);
+        reader.readCurve(entry, "alpha_over_life", 0, 1, emitter.alpha_over_life);
+        reader.readCurve(entry, "color_over_life", 0, 3, emitter.red_over_life);
+        reader.readCurve(entry, "color_over_life", 1, 3, emitter.green_over_life);
+        reader.readCurve(entry, "color_over_life", 2, 3, emitter.blue_over_life);
+        reader.readCurve(entry, "follow_speed_over_life", 0, 1, emitter.follow_speed_over_life);
+
+        // the kernels divide by the lifetime
+        if (emitter.lifetime_ms.x <= 0.f)
+            reader.error("lifetime_ms must be positive");
+
+        if (reader.ok)
+            emitters[type] = emitter;
+        ok &= reader.ok;
+    }
+    return ok;
+}
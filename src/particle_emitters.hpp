@@ -0,0 +1,56 @@
+#pragma once
+
+#include "common.hpp"
+#include "tinyECS/components.hpp"
+
+#include <array>
+#include <string>
+
+// samples per curve, indexed by age (0 at spawn, 1 at expiry) rounded to the nearest sample
+const int PARTICLE_CURVE_SAMPLES = 64;
+using ParticleCurve = std::array<float, PARTICLE_CURVE_SAMPLES>;
+
+// How one PARTICLE_TYPE spawns and changes over its life, read from data/particles/emitters.json.
+// Ranges are [min, max] and drawn uniformly per particle. The curves are given in the file as
+// [age, value] keys and baked here into tables, so the kernels look values up instead of computing them.
+struct ParticleEmitter
+{
+    // spawning
+    int burst_count = 1;            // particles per createParticles call without a count
+    float spawn_interval_ms = 0.f;  // between trail spawns, for types that follow something
+    vec2 lifetime_ms = {1000.f, 1000.f};
+    vec2 speed = {0.f, 0.f};        // in a random direction
+    vec2 size = {1.f, 1.f};         // height, the width is size * aspect
+    float aspect = 1.f;
+    vec2 burst_ms = {0.f, 0.f};     // death particles: time spent bursting before following the player
+    vec2 follow_acceleration = {0.f, 0.f};
+
+    // motion, per step
+    float damping = 1.f;
+    float max_speed = 0.f;
+
+    // over life
+    ParticleCurve size_over_life;   // times the spawn size
+    ParticleCurve alpha_over_life;
+    ParticleCurve red_over_life;
+    ParticleCurve green_over_life;
+    ParticleCurve blue_over_life;
+    ParticleCurve follow_speed_over_life; // times the follow acceleration
+
+    ParticleEmitter();
+};
+
+using ParticleEmitters = std::array<ParticleEmitter, particle_type_count>;
+
+// nearest curve sample for a particle with lifetime left out of max_lifetime, the AVX2 kernels do the same in 8 lanes
+inline int particleCurveIndex(float lifetime_ms, float max_lifetime_ms)
+{
+    const float age = 1.f - lifetime_ms / max_lifetime_ms;
+    const int index = (int)(age * (float)(PARTICLE_CURVE_SAMPLES - 1) + 0.5f);
+    // expired particles are stepped once more before being killed
+    return index < 0 ? 0 : (index > PARTICLE_CURVE_SAMPLES - 1 ? PARTICLE_CURVE_SAMPLES - 1 : index);
+}
+
+// Reads one emitter per particle type, by the names in PARTICLE_TYPE order ("death", "ripple").
+// Problems go to stderr, returns false if anything was wrong.
+bool loadParticleEmitters(const std::string& path, ParticleEmitters& emitters);
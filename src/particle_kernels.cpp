@@ -0,0 +1,256 @@
+#include "particle_kernels.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// the AVX2 path compares states as 32 bit lanes
+static_assert(sizeof(PARTICLE_STATE) == sizeof(int32_t), "PARTICLE_STATE must be 32 bits wide");
+
+// the rest of the tuning comes from the emitters
+static const float DEATH_FOLLOW_MS = 1000.f;
+static const float DEATH_MIN_DISTANCE = 0.1f;
+
+// a max_speed of 0 in the file means no limit
+static float speedLimit(const ParticleEmitter &emitter)
+{
+    return emitter.max_speed > 0.f ? emitter.max_speed : std::numeric_limits<float>::infinity();
+}
+
+// scale, color and alpha from the emitter's curves at the particle's age, for every type
+static void applyCurves(ParticleBucket &bucket, const ParticleEmitter &emitter, int i, int sample)
+{
+    const float size = bucket.spawn_size[i] * emitter.size_over_life[sample];
+    bucket.scale_x[i] = size * emitter.aspect;
+    bucket.scale_y[i] = size;
+    bucket.color_r[i] = emitter.red_over_life[sample];
+    bucket.color_g[i] = emitter.green_over_life[sample];
+    bucket.color_b[i] = emitter.blue_over_life[sample];
+    bucket.alpha[i] = emitter.alpha_over_life[sample];
+}
+
+void stepDeathParticlesScalar(ParticleBucket &bucket, const ParticleEmitter &emitter, int first, int last, float elapsed_ms, bool has_player, vec2 player_position)
+{
+    const float step_seconds = elapsed_ms / 1000.f;
+    const float max_speed = speedLimit(emitter);
+    for (int i = first; i < last; i++)
+    {
+        const float lifetime = bucket.lifetime_ms[i] - elapsed_ms;
+        bucket.lifetime_ms[i] = lifetime;
+        const int sample = particleCurveIndex(lifetime, bucket.max_lifetime_ms[i]);
+
+        float vx = bucket.velocity_x[i];
+        float vy = bucket.velocity_y[i];
+        if (bucket.state[i] == PARTICLE_STATE::BURST)
+        {
+            vx = vx * emitter.damping;
+            vy = vy * emitter.damping;
+            bucket.state_timer_ms[i] -= elapsed_ms;
+            if (bucket.state_timer_ms[i] <= 0.f)
+            {
+                bucket.state[i] = PARTICLE_STATE::FOLLOW;
+                bucket.state_timer_ms[i] = DEATH_FOLLOW_MS;
+            }
+        }
+        else if (bucket.state[i] == PARTICLE_STATE::FOLLOW && has_player)
+        {
+            float dx = player_position.x - bucket.position_x[i];
+            float dy = player_position.y - bucket.position_y[i];
+            const float distance = std::sqrt(dx * dx + dy * dy);
+            if (distance > DEATH_MIN_DISTANCE)
+            {
+                dx = dx / distance;
+                dy = dy / distance;
+                const float speed = bucket.speed_factor[i] * emitter.follow_speed_over_life[sample];
+                vx = vx + dx * speed * step_seconds;
+                vy = vy + dy * speed * step_seconds;
+                const float current_speed = std::sqrt(vx * vx + vy * vy);
+                if (current_speed > max_speed)
+                {
+                    vx = vx / current_speed * max_speed;
+                    vy = vy / current_speed * max_speed;
+                }
+            }
+        }
+        applyCurves(bucket, emitter, i, sample);
+
+        bucket.velocity_x[i] = vx;
+        bucket.velocity_y[i] = vy;
+        bucket.position_x[i] += vx * step_seconds;
+        bucket.position_y[i] += vy * step_seconds;
+    }
+}
+
+void stepRippleParticlesScalar(ParticleBucket &bucket, const ParticleEmitter &emitter, int first, int last, float elapsed_ms)
+{
+    const float step_seconds = elapsed_ms / 1000.f;
+    for (int i = first; i < last; i++)
+    {
+        const float lifetime = bucket.lifetime_ms[i] - elapsed_ms;
+        bucket.lifetime_ms[i] = lifetime;
+        applyCurves(bucket, emitter, i, particleCurveIndex(lifetime, bucket.max_lifetime_ms[i]));
+
+        float x = bucket.position_x[i] + bucket.velocity_x[i] * step_seconds;
+        float y = bucket.position_y[i] + bucket.velocity_y[i] * step_seconds;
+
+        const float vx = bucket.velocity_x[i] * emitter.damping;
+        const float vy = bucket.velocity_y[i] * emitter.damping;
+        bucket.velocity_x[i] = vx;
+        bucket.velocity_y[i] = vy;
+
+        // the second move is the one PhysicsSystem made when particles were entities
+        bucket.position_x[i] = x + vx * step_seconds;
+        bucket.position_y[i] = y + vy * step_seconds;
+    }
+}
+
+#if defined(__AVX2__)
+
+// particleCurveIndex for 8 particles
+static __m256i curveIndices(__m256 lifetime, __m256 max_lifetime)
+{
+    const __m256 age = _mm256_sub_ps(_mm256_set1_ps(1.f), _mm256_div_ps(lifetime, max_lifetime));
+    const __m256 scaled = _mm256_add_ps(_mm256_mul_ps(age, _mm256_set1_ps((float)(PARTICLE_CURVE_SAMPLES - 1))), _mm256_set1_ps(0.5f));
+    const __m256i index = _mm256_max_epi32(_mm256_cvttps_epi32(scaled), _mm256_setzero_si256());
+    return _mm256_min_epi32(index, _mm256_set1_epi32(PARTICLE_CURVE_SAMPLES - 1));
+}
+
+// applyCurves for the 8 particles from i, one gather per curve
+static void applyCurves(ParticleBucket &bucket, const ParticleEmitter &emitter, int i, __m256i sample)
+{
+    const __m256 size = _mm256_mul_ps(_mm256_loadu_ps(&bucket.spawn_size[i]), _mm256_i32gather_ps(emitter.size_over_life.data(), sample, 4));
+    _mm256_storeu_ps(&bucket.scale_x[i], _mm256_mul_ps(size, _mm256_set1_ps(emitter.aspect)));
+    _mm256_storeu_ps(&bucket.scale_y[i], size);
+    _mm256_storeu_ps(&bucket.color_r[i], _mm256_i32gather_ps(emitter.red_over_life.data(), sample, 4));
+    _mm256_storeu_ps(&bucket.color_g[i], _mm256_i32gather_ps(emitter.green_over_life.data(), sample, 4));
+    _mm256_storeu_ps(&bucket.color_b[i], _mm256_i32gather_ps(emitter.blue_over_life.data(), sample, 4));
+    _mm256_storeu_ps(&bucket.alpha[i], _mm256_i32gather_ps(emitter.alpha_over_life.data(), sample, 4));
+}
+
+void stepDeathParticles(ParticleBucket &bucket, const ParticleEmitter &emitter, int first, int last, float elapsed_ms, bool has_player, vec2 player_position)
+{
+    const __m256 elapsed = _mm256_set1_ps(elapsed_ms);
+    const __m256 seconds = _mm256_set1_ps(elapsed_ms / 1000.f);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 burst_damping = _mm256_set1_ps(emitter.damping);
+    const __m256 follow_ms = _mm256_set1_ps(DEATH_FOLLOW_MS);
+    const __m256 min_distance = _mm256_set1_ps(DEATH_MIN_DISTANCE);
+    const __m256 max_speed = _mm256_set1_ps(speedLimit(emitter));
+    const __m256 target_x = _mm256_set1_ps(player_position.x);
+    const __m256 target_y = _mm256_set1_ps(player_position.y);
+    const __m256 player_mask = has_player ? _mm256_castsi256_ps(_mm256_set1_epi32(-1)) : zero;
+    const __m256i burst_state = _mm256_set1_epi32((int32_t)PARTICLE_STATE::BURST);
+    const __m256i follow_state = _mm256_set1_epi32((int32_t)PARTICLE_STATE::FOLLOW);
+
+    int i = first;
+    for (; i + 8 <= last; i += 8)
+    {
+        const __m256 lifetime = _mm256_sub_ps(_mm256_loadu_ps(&bucket.lifetime_ms[i]), elapsed);
+        _mm256_storeu_ps(&bucket.lifetime_ms[i], lifetime);
+        const __m256i sample = curveIndices(lifetime, _mm256_loadu_ps(&bucket.max_lifetime_ms[i]));
+
+        // both masks are taken before the burst switch, a particle starts following on the next step
+        __m256i state = _mm256_loadu_si256((const __m256i *)&bucket.state[i]);
+        const __m256 is_burst = _mm256_castsi256_ps(_mm256_cmpeq_epi32(state, burst_state));
+        const __m256 is_follow = _mm256_castsi256_ps(_mm256_cmpeq_epi32(state, follow_state));
+
+        __m256 vx = _mm256_loadu_ps(&bucket.velocity_x[i]);
+        __m256 vy = _mm256_loadu_ps(&bucket.velocity_y[i]);
+        const __m256 x = _mm256_loadu_ps(&bucket.position_x[i]);
+        const __m256 y = _mm256_loadu_ps(&bucket.position_y[i]);
+
+        // burst
+        __m256 timer = _mm256_loadu_ps(&bucket.state_timer_ms[i]);
+        const __m256 burst_timer = _mm256_sub_ps(timer, elapsed);
+        const __m256 switched = _mm256_and_ps(is_burst, _mm256_cmp_ps(burst_timer, zero, _CMP_LE_OQ));
+        timer = _mm256_blendv_ps(timer, burst_timer, is_burst);
+        timer = _mm256_blendv_ps(timer, follow_ms, switched);
+        _mm256_storeu_ps(&bucket.state_timer_ms[i], timer);
+        state = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(state), _mm256_castsi256_ps(follow_state), switched));
+        _mm256_storeu_si256((__m256i *)&bucket.state[i], state);
+        vx = _mm256_blendv_ps(vx, _mm256_mul_ps(vx, burst_damping), is_burst);
+        vy = _mm256_blendv_ps(vy, _mm256_mul_ps(vy, burst_damping), is_burst);
+
+        // follow, lanes that don't steer divide by a zero distance and are blended away
+        __m256 dx = _mm256_sub_ps(target_x, x);
+        __m256 dy = _mm256_sub_ps(target_y, y);
+        const __m256 distance = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)));
+        const __m256 steer = _mm256_and_ps(_mm256_and_ps(is_follow, player_mask), _mm256_cmp_ps(distance, min_distance, _CMP_GT_OQ));
+        dx = _mm256_div_ps(dx, distance);
+        dy = _mm256_div_ps(dy, distance);
+        const __m256 speed = _mm256_mul_ps(_mm256_loadu_ps(&bucket.speed_factor[i]),
+                                           _mm256_i32gather_ps(emitter.follow_speed_over_life.data(), sample, 4));
+        __m256 steer_x = _mm256_add_ps(vx, _mm256_mul_ps(_mm256_mul_ps(dx, speed), seconds));
+        __m256 steer_y = _mm256_add_ps(vy, _mm256_mul_ps(_mm256_mul_ps(dy, speed), seconds));
+        const __m256 current_speed = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(steer_x, steer_x), _mm256_mul_ps(steer_y, steer_y)));
+        const __m256 clamp = _mm256_cmp_ps(current_speed, max_speed, _CMP_GT_OQ);
+        steer_x = _mm256_blendv_ps(steer_x, _mm256_mul_ps(_mm256_div_ps(steer_x, current_speed), max_speed), clamp);
+        steer_y = _mm256_blendv_ps(steer_y, _mm256_mul_ps(_mm256_div_ps(steer_y, current_speed), max_speed), clamp);
+        vx = _mm256_blendv_ps(vx, steer_x, steer);
+        vy = _mm256_blendv_ps(vy, steer_y, steer);
+
+        applyCurves(bucket, emitter, i, sample);
+
+        _mm256_storeu_ps(&bucket.velocity_x[i], vx);
+        _mm256_storeu_ps(&bucket.velocity_y[i], vy);
+        _mm256_storeu_ps(&bucket.position_x[i], _mm256_add_ps(x, _mm256_mul_ps(vx, seconds)));
+        _mm256_storeu_ps(&bucket.position_y[i], _mm256_add_ps(y, _mm256_mul_ps(vy, seconds)));
+    }
+    stepDeathParticlesScalar(bucket, emitter, i, last, elapsed_ms, has_player, player_position);
+}
+
+void stepRippleParticles(ParticleBucket &bucket, const ParticleEmitter &emitter, int first, int last, float elapsed_ms)
+{
+    const __m256 elapsed = _mm256_set1_ps(elapsed_ms);
+    const __m256 seconds = _mm256_set1_ps(elapsed_ms / 1000.f);
+    const __m256 damping = _mm256_set1_ps(emitter.damping);
+
+    int i = first;
+    for (; i + 8 <= last; i += 8)
+    {
+        const __m256 lifetime = _mm256_sub_ps(_mm256_loadu_ps(&bucket.lifetime_ms[i]), elapsed);
+        _mm256_storeu_ps(&bucket.lifetime_ms[i], lifetime);
+        applyCurves(bucket, emitter, i, curveIndices(lifetime, _mm256_loadu_ps(&bucket.max_lifetime_ms[i])));
+
+        __m256 vx = _mm256_loadu_ps(&bucket.velocity_x[i]);
+        __m256 vy = _mm256_loadu_ps(&bucket.velocity_y[i]);
+        const __m256 x = _mm256_add_ps(_mm256_loadu_ps(&bucket.position_x[i]), _mm256_mul_ps(vx, seconds));
+        const __m256 y = _mm256_add_ps(_mm256_loadu_ps(&bucket.position_y[i]), _mm256_mul_ps(vy, seconds));
+
+        vx = _mm256_mul_ps(vx, damping);
+        vy = _mm256_mul_ps(vy, damping);
+        _mm256_storeu_ps(&bucket.velocity_x[i], vx);
+        _mm256_storeu_ps(&bucket.velocity_y[i], vy);
+        _mm256_storeu_ps(&bucket.position_x[i], _mm256_add_ps(x, _mm256_mul_ps(vx, seconds)));
+        _mm256_storeu_ps(&bucket.position_y[i], _mm256_add_ps(y, _mm256_mul_ps(vy, seconds)));
+    }
+    stepRippleParticlesScalar(bucket, emitter, i, last, elapsed_ms);
+}
+
+const char *particleKernelPath()
+{
+    return "avx2";
+}
+
+#else
+
+void stepDeathParticles(ParticleBucket &bucket, const ParticleEmitter &emitter, int first, int last, float elapsed_ms, bool has_player, vec2 player_position)
+{
+    stepDeathParticlesScalar(bucket, emitter, first, last, elapsed_ms, has_player, player_position);
+}
+
+void stepRippleParticles(ParticleBucket &bucket, const ParticleEmitter &emitter, int first, int last, float elapsed_ms)
+{
+    stepRippleParticlesScalar(bucket, emitter, first, last, elapsed_ms);
+}
+
+const char *particleKernelPath()
+{
+    return "scalar";
+}
+
+#endif
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "common.hpp"
+#include "particle_emitters.hpp"
+#include "particle_pool.hpp"
+
+// Update kernels, one per PARTICLE_TYPE, over the particles [first, last) of a bucket. Each
+// advances lifetimes, state, velocity and position by one step and sets scale, color and alpha
+// from the type's emitter curves at the particle's new age; expired particles
+// (lifetime <= 0) are left in place for the caller to kill. Particles don't affect each
+// other, so disjoint ranges can be stepped on different threads.
+// With PARTICLES_AVX2 on in CMake they run 8 particles at a time, the scalar versions
+// below do the rest and are the only path otherwise. Both do the same float operations
+// in the same order, so they agree up to the last bits of sqrt and division.
+
+// burst damping, then following the player faster as the particle ages, up to the emitter's max speed
+void stepDeathParticles(ParticleBucket &bucket, const ParticleEmitter &emitter, int first, int last, float elapsed_ms, bool has_player, vec2 player_position);
+// drift and damping
+void stepRippleParticles(ParticleBucket &bucket, const ParticleEmitter &emitter, int first, int last, float elapsed_ms);
+
+void stepDeathParticlesScalar(ParticleBucket &bucket, const ParticleEmitter &emitter, int first, int last, float elapsed_ms, bool has_player, vec2 player_position);
+void stepRippleParticlesScalar(ParticleBucket &bucket, const ParticleEmitter &emitter, int first, int last, float elapsed_ms);
+
+// "avx2" or "scalar", whichever stepDeathParticles and stepRippleParticles use
+const char *particleKernelPath();
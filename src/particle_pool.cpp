@@ -0,0 +1,77 @@
+#include "particle_pool.hpp"
+
+#include <cassert>
+
+ParticlePool particle_pool;
+
+ParticleBucket::ParticleBucket()
+{
+    // allocated once, spawning never reallocates
+    for (std::vector<float> *field : {&position_x, &position_y, &velocity_x, &velocity_y, &scale_x, &scale_y,
+                                      &spawn_size, &color_r, &color_g, &color_b, &alpha, &lifetime_ms,
+                                      &max_lifetime_ms, &state_timer_ms, &speed_factor})
+        field->resize(CAPACITY);
+    state.resize(CAPACITY);
+}
+
+int ParticleBucket::spawn(vec2 position)
+{
+    assert(count < CAPACITY);
+    const int i = count++;
+    respawn(i, position);
+    return i;
+}
+
+void ParticleBucket::respawn(int i, vec2 position)
+{
+    assert(i >= 0 && i < count);
+    position_x[i] = position.x;
+    position_y[i] = position.y;
+    velocity_x[i] = 0.f;
+    velocity_y[i] = 0.f;
+    scale_x[i] = 1.f;
+    scale_y[i] = 1.f;
+    spawn_size[i] = 1.f;
+    color_r[i] = 1.f;
+    color_g[i] = 1.f;
+    color_b[i] = 1.f;
+    alpha[i] = 1.f;
+    lifetime_ms[i] = 2000.f;
+    max_lifetime_ms[i] = 2000.f;
+    state_timer_ms[i] = 0.f;
+    speed_factor[i] = 100.f;
+    state[i] = PARTICLE_STATE::BURST;
+}
+
+void ParticleBucket::kill(int i)
+{
+    assert(i >= 0 && i < count);
+    const int last = --count;
+    if (i == last)
+        return;
+
+    for (std::vector<float> *field : {&position_x, &position_y, &velocity_x, &velocity_y, &scale_x, &scale_y,
+                                      &spawn_size, &color_r, &color_g, &color_b, &alpha, &lifetime_ms,
+                                      &max_lifetime_ms, &state_timer_ms, &speed_factor})
+        (*field)[i] = (*field)[last];
+    state[i] = state[last];
+}
+
+void ParticleBucket::clear()
+{
+    count = 0;
+}
+
+void ParticlePool::clear()
+{
+    for (ParticleBucket &b : buckets)
+        b.clear();
+}
+
+int ParticlePool::size() const
+{
+    int total = 0;
+    for (const ParticleBucket &b : buckets)
+        total += b.size();
+    return total;
+}
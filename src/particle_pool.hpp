@@ -0,0 +1,76 @@
+#pragma once
+
+#include "common.hpp"
+#include "tinyECS/components.hpp"
+
+#include <array>
+#include <vector>
+
+// The particles of one PARTICLE_TYPE, every field in its own float array so the update
+// kernels can work on 8 particles at a time. Live particles are always [0, size()),
+// kill() moves the last one into the freed slot, so indices are only stable until the next kill.
+struct ParticleBucket
+{
+    // ripples at 60 fps and a few death bursts at once, ParticleSystem evicts before going past it
+    static const int CAPACITY = 4096;
+
+    ParticleBucket();
+
+    // returns the index of the new particle with every field but its position defaulted, the bucket must not be full
+    int spawn(vec2 position);
+    // puts a new particle, defaulted the same way, in the slot of particle i, no other index changes
+    void respawn(int i, vec2 position);
+    void kill(int i);
+    void clear();
+
+    int size() const { return count; }
+
+    std::vector<float> position_x;
+    std::vector<float> position_y;
+    std::vector<float> velocity_x;
+    std::vector<float> velocity_y;
+    std::vector<float> scale_x;
+    std::vector<float> scale_y;
+    std::vector<float> spawn_size; // the kernels set scale from it and the emitter's size curve
+    std::vector<float> color_r;
+    std::vector<float> color_g;
+    std::vector<float> color_b;
+    std::vector<float> alpha;
+    std::vector<float> lifetime_ms;
+    std::vector<float> max_lifetime_ms;
+    std::vector<float> state_timer_ms;
+    std::vector<float> speed_factor;
+    std::vector<PARTICLE_STATE> state;
+
+    int count = 0;
+};
+
+// Every live particle, bucketed by type; particles are not registry entities.
+// ParticleSystem spawns, steps and expires them here and the renderer reads the arrays directly.
+class ParticlePool
+{
+public:
+    ParticleBucket &bucket(PARTICLE_TYPE type) { return buckets[(int)type]; }
+    const ParticleBucket &bucket(PARTICLE_TYPE type) const { return buckets[(int)type]; }
+
+    void clear();
+
+    // all types together
+    int size() const;
+
+private:
+    std::array<ParticleBucket, particle_type_count> buckets;
+};
+
+// What ParticleSystem did over one frame, shown under the FPS counter
+struct ParticleStats
+{
+    int live = 0;
+    int spawned = 0;
+    int expired = 0;
+    int evicted = 0; // oldest particles removed to make room under the live budget
+    int dropped = 0; // spawns refused past the per frame budget
+};
+
+// defined in particle_pool.cpp
+extern ParticlePool particle_pool;
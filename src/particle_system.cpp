@@ -1,192 +1,253 @@
 #include "particle_system.hpp"
+#include "particle_kernels.hpp"
 #include "tinyECS/registry.hpp"
+#include <algorithm>
+#include <cstdlib>
 #include <iostream>
 #include <random>
+#include <utility>
 
 // defined in registry.cpp
 extern ECSRegistry registry;
 
+ParticleRandom::ParticleRandom(uint64_t seed, uint64_t stream)
+{
+    // the standard pcg32 seeding, any stream number gives an odd increment
+    state = 0u;
+    increment = (stream << 1u) | 1u;
+    next();
+    state += seed;
+    next();
+}
+
+uint32_t ParticleRandom::next()
+{
+    uint64_t old_state = state;
+    state = old_state * 6364136223846793005ULL + increment;
+    uint32_t xorshifted = (uint32_t)(((old_state >> 18u) ^ old_state) >> 27u);
+    uint32_t rotation = (uint32_t)(old_state >> 59u);
+    return (xorshifted >> rotation) | (xorshifted << ((32u - rotation) & 31u));
+}
+
+float ParticleRandom::uniform()
+{
+    // the top 24 bits, every value exactly representable
+    return (float)(next() >> 8) * (1.0f / 16777216.0f);
+}
+
+float ParticleRandom::between(vec2 range)
+{
+    return range.x + uniform() * (range.y - range.x);
+}
+
 ParticleSystem::ParticleSystem()
 {
+    const std::string emitters_path = data_path() + "/particles/emitters.json";
+    // every spawn looks its emitter up in the table, release builds must not run on without it
+    if (!loadParticleEmitters(emitters_path, emitters))
+    {
+        std::cerr << "ERROR: failed to load particle emitters from " << emitters_path << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
     // creatge random number generator
     std::random_device rd;
-    rng = std::default_random_engine(rd());
-    uniform_dist = std::uniform_real_distribution<float>(0.0f, 1.0f);
+    setSeed(((uint64_t)rd() << 32) | rd());
+}
+
+void ParticleSystem::setSeed(uint64_t seed)
+{
+    this->seed = seed;
+    spawn_calls = 0;
 }
 
 void ParticleSystem::step(float elapsed_ms)
 {
-    // Iterate backwards to safely remove expired particles.
-    for (int i = (int)registry.particles.size() - 1; i >= 0; i--)
+    // the player is looked up once for every following particle
+    bool has_player = !registry.players.entities.empty();
+    vec2 player_position = {0.f, 0.f};
+    if (has_player)
+        player_position = registry.motions.get(registry.players.entities[0]).position;
+
+    // each type is updated by its own kernel, see particle_kernels.hpp, over fixed size chunks
+    // that write only their own particles. The kernels draw no random numbers, so the result
+    // doesn't depend on how the chunks were spread over the threads.
+    struct Chunk
     {
-        Entity entity = registry.particles.entities[i];
-        Particle& particle = registry.particles.components[i];
-
-        // update lifetime
-        particle.lifetime_ms -= elapsed_ms;
-
-        // Remove expired particles
-        if (particle.lifetime_ms <= 0)
-        {
-            registry.remove_all_components_of(entity);
-            continue;
-        }
+        PARTICLE_TYPE type;
+        int first;
+        int last;
+    };
+    std::vector<Chunk> chunks;
+    for (int type = 0; type < particle_type_count; type++)
+    {
+        const int count = particle_pool.bucket((PARTICLE_TYPE)type).size();
+        for (int first = 0; first < count; first += PARTICLE_CHUNK_SIZE)
+            chunks.push_back({(PARTICLE_TYPE)type, first, std::min(first + PARTICLE_CHUNK_SIZE, count)});
+    }
 
-        // update particle behavior based on type
-        switch (particle.type)
+    auto step_chunk = [&](int c) {
+        const Chunk& chunk = chunks[c];
+        ParticleBucket& bucket = particle_pool.bucket(chunk.type);
+        switch (chunk.type)
         {
             case PARTICLE_TYPE::DEATH_PARTICLE:
-            {
-                Motion& motion = registry.motions.get(entity);
-
-                if (particle.state == PARTICLE_STATE::BURST)
-                {
-                    motion.velocity *= 0.98f;
-                    particle.state_timer_ms -= elapsed_ms;
-                    if (particle.state_timer_ms <= 0)
-                    {
-                        particle.state = PARTICLE_STATE::FOLLOW;
-                        particle.state_timer_ms = 1000.f;
-                    }
-                }
-                else if (particle.state == PARTICLE_STATE::FOLLOW)
-                {
-                    if (!registry.players.entities.empty())
-                    {
-                        Entity player_entity = registry.players.entities[0];
-                        Motion& player_motion = registry.motions.get(player_entity);
-                        vec2 direction = player_motion.position - motion.position;
-                        float distance = glm::length(direction);
-                        if (distance > 0.1f)
-                        {
-                            direction = glm::normalize(direction);
-                            float speed_factor = particle.speed_factor * (1.0f + (1.0f - particle.lifetime_ms / particle.max_lifetime_ms) * 200.0f);
-                            motion.velocity += direction * speed_factor * (elapsed_ms / 1000.f);
-                            float max_speed = 600.0f;
-                            float current_speed = glm::length(motion.velocity);
-                            if (current_speed > max_speed)
-                            {
-                                motion.velocity = glm::normalize(motion.velocity) * max_speed;
-                            }
-                        }
-                    }
-                    float life_ratio = particle.lifetime_ms / particle.max_lifetime_ms;
-                    if (registry.colors.has(entity))
-                    {
-                        vec3& color = registry.colors.get(entity);
-                        color = color * life_ratio * 2.0f;
-                    }
-                }
-                break; 
-            }
+                stepDeathParticles(bucket, emitters[(int)chunk.type], chunk.first, chunk.last, elapsed_ms, has_player, player_position);
+                break;
             case PARTICLE_TYPE::RIPPLE_PARTICLE:
-            {
-                Motion& motion = registry.motions.get(entity);
-                
-                motion.position += motion.velocity * (elapsed_ms / 1000.f);
-                
-                float life_ratio = particle.lifetime_ms / particle.max_lifetime_ms;
-                float start_size = 2.0f;
-                float end_size = 4.0f;
-                float current_size = start_size + (end_size - start_size) * (1.0f - life_ratio);
-                motion.scale = {current_size, current_size};
-                
-                if (registry.colors.has(entity))
-                {
-                    vec3& color = registry.colors.get(entity);
-                    color = color * life_ratio;
-                }
-                motion.velocity *= 0.97f;
-                
+                stepRippleParticles(bucket, emitters[(int)chunk.type], chunk.first, chunk.last, elapsed_ms);
                 break;
-            }
             default:
                 break;
         }
+    };
+
+    if (particle_pool.size() >= PARTICLE_PARALLEL_MIN)
+        workers.parallelFor((int)chunks.size(), step_chunk);
+    else
+    {
+        for (int c = 0; c < (int)chunks.size(); c++)
+            step_chunk(c);
+    }
+
+    // the kills below move particles, the next eviction looks for the oldest again
+    for (std::vector<int>& oldest : eviction_order)
+        oldest.clear();
+
+    // Remove expired particles, backwards so the particle swapped in was already checked
+    for (int type = 0; type < particle_type_count; type++)
+    {
+        ParticleBucket& bucket = particle_pool.bucket((PARTICLE_TYPE)type);
+        for (int i = bucket.size() - 1; i >= 0; i--)
+        {
+            if (bucket.lifetime_ms[i] <= 0)
+            {
+                bucket.kill(i);
+                frame_stats.expired++;
+            }
+        }
     }
+
+    // spawns since the last step count towards this frame
+    frame_stats.live = particle_pool.size();
+    last_frame_stats = frame_stats;
+    frame_stats = ParticleStats();
+}
+
+void ParticleSystem::clear()
+{
+    particle_pool.clear();
+    for (std::vector<int>& oldest : eviction_order)
+        oldest.clear();
+    frame_stats = ParticleStats();
+    last_frame_stats = ParticleStats();
+}
+
+int ParticleSystem::spawn(PARTICLE_TYPE type, vec2 position)
+{
+    if (frame_stats.spawned >= PARTICLE_MAX_SPAWNS_PER_FRAME)
+    {
+        frame_stats.dropped++;
+        return -1;
+    }
+
+    ParticleBucket& bucket = particle_pool.bucket(type);
+    if (particle_pool.size() >= PARTICLE_MAX_LIVE || bucket.size() == ParticleBucket::CAPACITY)
+    {
+        // the other types hold the whole budget
+        if (bucket.size() == 0)
+        {
+            frame_stats.dropped++;
+            return -1;
+        }
+
+        std::vector<int>& oldest = eviction_order[(int)type];
+        if (oldest.empty())
+            findOldest(type);
+        const int i = oldest.back();
+        oldest.pop_back();
+        bucket.respawn(i, position);
+        frame_stats.evicted++;
+        frame_stats.spawned++;
+        return i;
+    }
+
+    frame_stats.spawned++;
+    return bucket.spawn(position);
+}
+
+void ParticleSystem::findOldest(PARTICLE_TYPE type)
+{
+    // oldest by time alive, the order in the bucket is lost to swap removal
+    const ParticleBucket& bucket = particle_pool.bucket(type);
+    std::vector<std::pair<float, int>> ages(bucket.size());
+    for (int i = 0; i < bucket.size(); i++)
+        ages[i] = {bucket.max_lifetime_ms[i] - bucket.lifetime_ms[i], i};
+
+    // spawn only gets here with spawns left in the frame and a non-empty bucket
+    const int count = std::min(PARTICLE_MAX_SPAWNS_PER_FRAME - frame_stats.spawned, bucket.size());
+    auto by_age = [](const std::pair<float, int>& a, const std::pair<float, int>& b) {
+        return a.first > b.first || (a.first == b.first && a.second < b.second);
+    };
+    std::nth_element(ages.begin(), ages.begin() + (count - 1), ages.end(), by_age);
+    std::sort(ages.begin(), ages.begin() + count, by_age);
+
+    std::vector<int>& oldest = eviction_order[(int)type];
+    oldest.clear();
+    for (int i = count - 1; i >= 0; i--)
+        oldest.push_back(ages[i].second);
 }
 
 void ParticleSystem::createParticles(PARTICLE_TYPE type, vec2 position, int count)
 {
-    switch (type)
+    random = ParticleRandom(seed, spawn_calls++);
+    for (int i = 0; i < count; i++)
     {
-        case PARTICLE_TYPE::DEATH_PARTICLE:
-            for (int i = 0; i < count; i++)
-            {
-                Entity particle = createDeathParticle(position);
-                particlesByType[type].push_back(particle);
-            }
-            break;
-            /// add more particles type heree
-        default:
-            break;
+        emitParticle(type, position, 1.0f);
     }
 }
 
-Entity ParticleSystem::createDeathParticle(vec2 position)
+void ParticleSystem::createParticles(PARTICLE_TYPE type, vec2 position)
 {
-    Entity entity = Entity();
+    createParticles(type, position, emitters[(int)type].burst_count);
+}
 
-    // create motion component
-    Motion& motion = registry.motions.emplace(entity);
-    motion.position = position;
-    motion.angle = 0.0f;
+int ParticleSystem::emitParticle(PARTICLE_TYPE type, vec2 position, float lifetime_scale)
+{
+    const ParticleEmitter& emitter = emitters[(int)type];
+    ParticleBucket& bucket = particle_pool.bucket(type);
+    int i = spawn(type, position);
+    if (i < 0)
+        return i;
 
     // random burst direction in a circle
-    float angle = uniform_dist(rng) * 2.0f * M_PI;
-    float speed = 100.0f + uniform_dist(rng) * 150.0f;
-    motion.velocity = {cos(angle) * speed, sin(angle) * speed};
-
-    // random size variation
-    float size_factor = 16.0f + uniform_dist(rng) * 10.0f;
-    motion.scale = {size_factor/2, size_factor};
-
-    // random color (temporary)
-    // float r = 0.5f + uniform_dist(rng) * 0.2f;
-    // float g = 0.7f + uniform_dist(rng) * 0.3f;
-    // float b = 0.2f + uniform_dist(rng) * 0.2f;    
-    float r = 1.0f;
-    float g = 1.0f;
-    float b = 1.0f;
-    registry.colors.emplace(entity, vec3(r, g, b));
-
-    // add  componentss
-    Particle& particle = registry.particles.emplace(entity);
-    particle.type = PARTICLE_TYPE::DEATH_PARTICLE;
-    particle.lifetime_ms = 1000.0f + uniform_dist(rng) * 500.0f;
-    particle.max_lifetime_ms = particle.lifetime_ms;
-    particle.state = PARTICLE_STATE::BURST;
-    particle.state_timer_ms = 300.0f + uniform_dist(rng) * 200.0f; // Time before following player
-    particle.speed_factor = 50.0f + uniform_dist(rng) * 50.0f;
-
-    registry.renderRequests.insert(
-        entity,
-        {TEXTURE_ASSET_ID::DEATH_PARTICLE,
-         EFFECT_ASSET_ID::TEXTURED,  
-         GEOMETRY_BUFFER_ID::SPRITE});
-
-    return entity;
+    float angle = random.uniform() * 2.0f * M_PI;
+    float speed = random.between(emitter.speed);
+    bucket.velocity_x[i] = cos(angle) * speed;
+    bucket.velocity_y[i] = sin(angle) * speed;
+
+    bucket.spawn_size[i] = random.between(emitter.size);
+    bucket.lifetime_ms[i] = random.between(emitter.lifetime_ms) * lifetime_scale;
+    bucket.max_lifetime_ms[i] = bucket.lifetime_ms[i];
+    // types with a burst follow the player after it
+    bucket.state[i] = emitter.burst_ms.y > 0.f ? PARTICLE_STATE::BURST : PARTICLE_STATE::FADE;
+    bucket.state_timer_ms[i] = random.between(emitter.burst_ms);
+    bucket.speed_factor[i] = random.between(emitter.follow_acceleration);
+
+    // the look at age 0 until the first step
+    bucket.scale_x[i] = bucket.spawn_size[i] * emitter.size_over_life[0] * emitter.aspect;
+    bucket.scale_y[i] = bucket.spawn_size[i] * emitter.size_over_life[0];
+    bucket.color_r[i] = emitter.red_over_life[0];
+    bucket.color_g[i] = emitter.green_over_life[0];
+    bucket.color_b[i] = emitter.blue_over_life[0];
+    bucket.alpha[i] = emitter.alpha_over_life[0];
+
+    return i;
 }
 
-Entity ParticleSystem::createRippleParticle(vec2 position, float lifetime_scale = 1.0f)
+int ParticleSystem::createRippleParticle(vec2 position, float lifetime_scale = 1.0f)
 {
-    Entity entity = Entity();
-    Motion& motion = registry.motions.emplace(entity);
-    motion.position = position;
-
-    Particle& particle = registry.particles.emplace(entity);
-    particle.type = PARTICLE_TYPE::RIPPLE_PARTICLE;
-    particle.max_lifetime_ms = (3000.0f + uniform_dist(rng) * 200.0f) * lifetime_scale;
-    particle.max_lifetime_ms = particle.lifetime_ms;
-    particle.state = PARTICLE_STATE::FADE;
-
-    registry.renderRequests.insert(
-        entity,
-        {TEXTURE_ASSET_ID::PIXEL_PARTICLE,
-         EFFECT_ASSET_ID::TEXTURED,
-         GEOMETRY_BUFFER_ID::SPRITE});
-
-    return entity;
+    return emitParticle(PARTICLE_TYPE::RIPPLE_PARTICLE, position, lifetime_scale);
 }
 
 void ParticleSystem::createPlayerRipples(Entity player_entity)
@@ -198,6 +259,8 @@ void ParticleSystem::createPlayerRipples(Entity player_entity)
     float player_speed = glm::length(player_motion.velocity);
     if (glm::length(player_motion.velocity) < 1.0f) return;
 
+    random = ParticleRandom(seed, spawn_calls++);
+
     vec2 velocity_direction = glm::normalize(player_motion.velocity);
     vec2 perpendicular = vec2(-velocity_direction.y, velocity_direction.x);
 
@@ -208,8 +271,8 @@ void ParticleSystem::createPlayerRipples(Entity player_entity)
 
     float random_factor = 5.0f;
     vec2 randomness = vec2(
-        (uniform_dist(rng) - 0.5f) * random_factor,
-        (uniform_dist(rng) - 0.5f) * random_factor
+        (random.uniform() - 0.5f) * random_factor,
+        (random.uniform() - 0.5f) * random_factor
     );
 
     vec2 left_position = tail_center - perpendicular * side_offset + randomness;
@@ -224,8 +287,8 @@ void ParticleSystem::createPlayerRipples(Entity player_entity)
     float right_speed = right_distance * speed_scale;
 
     float angle_variation = 0.01f;
-    float angle_offset_left = (uniform_dist(rng) - 0.5f) * angle_variation;
-    float angle_offset_right = (uniform_dist(rng) - 0.5f) * angle_variation;
+    float angle_offset_left = (random.uniform() - 0.5f) * angle_variation;
+    float angle_offset_right = (random.uniform() - 0.5f) * angle_variation;
 
     vec2 left_base_dir = -perpendicular;
     vec2 right_base_dir = perpendicular;
@@ -245,15 +308,18 @@ void ParticleSystem::createPlayerRipples(Entity player_entity)
     );
 
     float lifetime_scale = glm::clamp(player_speed / 100.f, 0.2f, 1.0f);
-    Entity left_particle = createRippleParticle(left_position, lifetime_scale);
-    Entity right_particle = createRippleParticle(right_position, lifetime_scale);
-
-    Motion& left_motion = registry.motions.get(left_particle);
-    Motion& right_motion = registry.motions.get(right_particle);
-
-    left_motion.velocity = left_direction * left_speed;
-    right_motion.velocity = right_direction * right_speed;
-
-    particlesByType[PARTICLE_TYPE::RIPPLE_PARTICLE].push_back(left_particle);
-    particlesByType[PARTICLE_TYPE::RIPPLE_PARTICLE].push_back(right_particle);
+    // the second spawn may evict and move the first, so each velocity is set right away
+    ParticleBucket& ripples = particle_pool.bucket(PARTICLE_TYPE::RIPPLE_PARTICLE);
+    int left_particle = createRippleParticle(left_position, lifetime_scale);
+    if (left_particle >= 0)
+    {
+        ripples.velocity_x[left_particle] = left_direction.x * left_speed;
+        ripples.velocity_y[left_particle] = left_direction.y * left_speed;
+    }
+    int right_particle = createRippleParticle(right_position, lifetime_scale);
+    if (right_particle >= 0)
+    {
+        ripples.velocity_x[right_particle] = right_direction.x * right_speed;
+        ripples.velocity_y[right_particle] = right_direction.y * right_speed;
+    }
 }
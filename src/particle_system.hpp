@@ -1,13 +1,45 @@
 #pragma once
 
 #include "common.hpp"
+#include "particle_emitters.hpp"
+#include "particle_pool.hpp"
+#include "thread_pool.hpp"
 #include "tinyECS/tiny_ecs.hpp"
 #include "tinyECS/components.hpp"
 #include "tinyECS/registry.hpp"
+#include <array>
+#include <cstdint>
 #include <vector>
-#include <unordered_map>
-#include <random>
 
+// step splits the buckets into chunks of this many particles, a multiple of 8 so the AVX2 path is never split
+const int PARTICLE_CHUNK_SIZE = 1024;
+// below this many live particles the chunks just run inline, handing them to workers costs more than it saves
+const int PARTICLE_PARALLEL_MIN = 2048;
+// budget: spawns past the first ones of a frame are dropped, and past this many live particles
+// a spawn evicts the oldest particle of its type
+const int PARTICLE_MAX_SPAWNS_PER_FRAME = 256;
+const int PARTICLE_MAX_LIVE = 6000;
+
+// PCG32, a small generator with independent streams. Every spawn call draws from its own stream,
+// numbered in call order from the system's seed, so a run with the same seed and the same calls
+// spawns the same particles whichever thread runs what.
+struct ParticleRandom
+{
+    ParticleRandom(uint64_t seed = 0, uint64_t stream = 0);
+
+    uint32_t next();
+    // in [0, 1)
+    float uniform();
+    // in [range.x, range.y), for the emitters' [min, max] ranges
+    float between(vec2 range);
+
+private:
+    uint64_t state;
+    uint64_t increment;
+};
+
+// The one particle system, owned by main and stepped once per GAME_PLAY frame after collisions
+// (which spawn the death bursts). WorldSystem spawns through a pointer to it.
 class ParticleSystem 
 {
 public:
@@ -17,20 +49,50 @@ public:
     // update particle positions, velocities, lifetimes, etfcc
     void step(float elapsed_ms);
 
-    // create different types of particles
+    // removes every particle, on restart
+    void clear();
+
+    // the last completed frame
+    const ParticleStats& stats() const { return last_frame_stats; }
+
+    // spawns are reproducible from here on, the seed is random otherwise
+    void setSeed(uint64_t seed);
+
+    // the definitions loaded from data/particles/emitters.json
+    const ParticleEmitter& emitter(PARTICLE_TYPE type) const { return emitters[(int)type]; }
+
+    // create different types of particles, count of them or the emitter's burst count
     void createParticles(PARTICLE_TYPE type, vec2 position, int count);
+    void createParticles(PARTICLE_TYPE type, vec2 position);
 
-    Entity createRippleParticle(vec2 position, float lifetime_scale);
+    // particles live in particle_pool, these return the pool index or -1 when it is full
+    int createRippleParticle(vec2 position, float lifetime_scale);
     void createPlayerRipples(Entity player_entity);
 
 private:
-    // helper function to create a death particle
-    Entity createDeathParticle(vec2 position);
+    // takes a slot within the budget, evicting if needed, -1 when the frame's spawns are used up
+    int spawn(PARTICLE_TYPE type, vec2 position);
+    // fills eviction_order for a type with its oldest particles, as many as the frame can still spawn
+    void findOldest(PARTICLE_TYPE type);
+
+    // one particle with everything drawn from its emitter's ranges
+    int emitParticle(PARTICLE_TYPE type, vec2 position, float lifetime_scale);
+
+    ParticleEmitters emitters;
+
+    // indices of the particles to evict next, oldest last. Found once when a full bucket first evicts
+    // instead of scanning it again for every spawn; evicted slots are reused in place so the
+    // other indices stay valid until step kills particles and empties the lists.
+    std::array<std::vector<int>, particle_type_count> eviction_order;
+
+    // random number generator for particle variations, a fresh stream for each spawn call
+    ParticleRandom random;
+    uint64_t seed = 0;
+    uint64_t spawn_calls = 0;
 
-    // track spawned particles by type (for potential optimizations???)
-    std::unordered_map<PARTICLE_TYPE, std::vector<Entity>> particlesByType;
+    // steps chunks of the buckets in parallel
+    ThreadPool workers;
 
-    // random number generator for particle variations
-    std::default_random_engine rng;
-    std::uniform_real_distribution<float> uniform_dist;
+    ParticleStats frame_stats;
+    ParticleStats last_frame_stats;
 };
\ No newline at end of file
@@ -0,0 +1,146 @@
+#include "path_planner.hpp"
+
+#include <algorithm>
+#include <queue>
+
+// the boss sits in the middle of the boss maps, don't route through it
+static const ivec2 BOSS_LOCS[] = {{9, 9}, {10, 9}, {9, 10}, {9, 10}};
+
+// path planning is bursty and cheap per request, a couple of workers is plenty
+static const unsigned int PATH_PLANNER_WORKERS = 2;
+
+bool isTraversableOnMap(const MapSnapshot& map, ivec2 pos)
+{
+	int map_width = map.size();
+	if (map_width == 0)
+		return false; // map is empty
+
+	int map_height = map[0].size();
+
+	// Check bounds
+	if (pos.x < 0 || pos.x >= map_width ||
+		pos.y < 0 || pos.y >= map_height)
+	{
+		return false;
+	}
+
+	return map[pos.x][pos.y] != tileType::WALL;
+}
+
+bool findPathOnMap(const MapSnapshot& map, ivec2 start_pos, ivec2 end_pos, std::vector<ivec2>& path)
+{
+	int map_width = map.size();
+	if (map_width == 0)
+		return false;
+	int map_height = map[0].size();
+
+	// nodes live in one arena and refer to their parent by index
+	struct Node {
+		ivec2 position;
+		int g_cost;
+		int h_cost;
+		int parent;
+		int f_cost() const { return g_cost + h_cost; }
+	};
+	std::vector<Node> nodes;
+
+	struct CompareNode {
+		const std::vector<Node>* nodes;
+		bool operator()(int a, int b) const {
+			return (*nodes)[a].f_cost() > (*nodes)[b].f_cost();
+		}
+	};
+
+	// per-cell closed flags and best node, only in-bounds cells are ever looked up
+	auto cell_index = [map_height](ivec2 p) { return p.x * map_height + p.y; };
+	std::vector<char> closed(map_width * map_height, 0);
+	std::vector<int> best_node(map_width * map_height, -1);
+
+	auto heuristic = [](ivec2 a, ivec2 b) {
+		return abs(a.x - b.x) + abs(a.y - b.y);
+	};
+
+	std::priority_queue<int, std::vector<int>, CompareNode> open(CompareNode{&nodes});
+
+	nodes.push_back({start_pos, 0, heuristic(start_pos, end_pos), -1});
+	open.push(0);
+	bool start_in_bounds = start_pos.x >= 0 && start_pos.x < map_width && start_pos.y >= 0 && start_pos.y < map_height;
+	if (start_in_bounds)
+		best_node[cell_index(start_pos)] = 0;
+
+	const ivec2 directions[] = {
+		{1, 0}, {-1, 0}, {0, 1}, {0, -1}
+	};
+
+	while (!open.empty()) {
+		int current = open.top();
+		open.pop();
+
+		if (nodes[current].position == end_pos) {
+			while (current != -1) {
+				path.push_back(nodes[current].position);
+				current = nodes[current].parent;
+			}
+			std::reverse(path.begin(), path.end());
+			return true;
+		}
+
+		ivec2 current_pos = nodes[current].position;
+		if (current_pos.x >= 0 && current_pos.x < map_width && current_pos.y >= 0 && current_pos.y < map_height)
+			closed[cell_index(current_pos)] = 1;
+
+		for (const ivec2& dir : directions) {
+			ivec2 neighbor_pos = current_pos + dir;
+
+			if (!isTraversableOnMap(map, neighbor_pos)) continue;
+			int cell = cell_index(neighbor_pos);
+			if (closed[cell]) continue;
+			if (std::find(std::begin(BOSS_LOCS), std::end(BOSS_LOCS), neighbor_pos) != std::end(BOSS_LOCS)) continue;
+
+			int g_cost = nodes[current].g_cost + 1;
+			int h_cost = heuristic(neighbor_pos, end_pos);
+			int f_cost = g_cost + h_cost;
+
+			if (best_node[cell] == -1 || f_cost < nodes[best_node[cell]].f_cost()) {
+				nodes.push_back({neighbor_pos, g_cost, h_cost, current});
+				int neighbor = (int)nodes.size() - 1;
+				open.push(neighbor);
+				best_node[cell] = neighbor;
+			}
+		}
+	}
+
+	return false;
+}
+
+PathPlanner::PathPlanner() : workers(PATH_PLANNER_WORKERS)
+{
+}
+
+void PathPlanner::syncMap(const MapSnapshot& map)
+{
+	// in-flight requests keep their own reference, so swapping the pointer never races with them
+	if (!snapshot || *snapshot != map)
+		snapshot = std::make_shared<const MapSnapshot>(map);
+}
+
+std::shared_future<std::vector<ivec2>> PathPlanner::requestPath(vec2 start_world, vec2 end_world)
+{
+	std::shared_ptr<const MapSnapshot> map = snapshot;
+	ivec2 start_pos = positionToGridCell(start_world);
+	ivec2 end_pos = positionToGridCell(end_world);
+
+	return workers.submit([map, start_pos, end_pos]() {
+		std::vector<ivec2> path;
+		if (map)
+			findPathOnMap(*map, start_pos, end_pos, path);
+		return path;
+	}).share();
+}
+
+bool PathPlanner::findPathNow(std::vector<ivec2>& path, vec2 start_world, vec2 end_world) const
+{
+	if (!snapshot)
+		return false;
+	return findPathOnMap(*snapshot, positionToGridCell(start_world), positionToGridCell(end_world), path);
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "common.hpp"
+#include "thread_pool.hpp"
+#include "tinyECS/components.hpp"
+
+#include <future>
+#include <memory>
+#include <vector>
+
+// Immutable copy of ProceduralMap::map (indexed map[x][y]) that worker threads can read
+// without touching the registry
+using MapSnapshot = std::vector<std::vector<tileType>>;
+
+// A* over the grid, 4-connected, walls and the boss cells are blocked.
+// Pure function of its inputs so the async planner and the synchronous one give identical paths.
+bool findPathOnMap(const MapSnapshot& map, ivec2 start_pos, ivec2 end_pos, std::vector<ivec2>& path);
+bool isTraversableOnMap(const MapSnapshot& map, ivec2 pos);
+
+// Runs path requests on background workers against a snapshot of the current map.
+// The returned future holds the path, or an empty vector when no path exists.
+class PathPlanner
+{
+public:
+	PathPlanner();
+
+	// re-snapshot the map if it changed since the last call, call once per frame before requesting
+	void syncMap(const MapSnapshot& map);
+
+	std::shared_future<std::vector<ivec2>> requestPath(vec2 start_world, vec2 end_world);
+
+	// same search on the calling thread, for comparing against the async results
+	bool findPathNow(std::vector<ivec2>& path, vec2 start_world, vec2 end_world) const;
+
+private:
+	std::shared_ptr<const MapSnapshot> snapshot;
+	ThreadPool workers;
+};
@@ -2,6 +2,7 @@
 #include "physics_system.hpp"
 #include "world_init.hpp"
 #include "animation_system.hpp"
+#include <chrono>
 #include <iostream>
 #include <queue>
 #include <glm/gtx/normalize_dot.hpp>
@@ -54,9 +55,7 @@ void PhysicsSystem::step(float elapsed_ms)
 		Dashing& dash = registry.dashes.get(dash_entity);
 		Motion& motion = registry.motions.get(player_entity);
 
-		dash.timer_ms -= elapsed_ms;
-
-		if (dash.timer_ms <= 0)
+		if (dash.end.due())
 		{
 			registry.dashes.remove(dash_entity);
 			motion.velocity = { 0, 0 };
@@ -72,6 +71,10 @@ void PhysicsSystem::step(float elapsed_ms)
 		}
 	}
 
+	// hunters plan against a snapshot of the map, refresh it before any requests go out
+	if (registry.denderiteAIs.size() > 0 && registry.proceduralMaps.size() > 0)
+		path_planner.syncMap(registry.proceduralMaps.components[0].map);
+
 	auto &motion_registry = registry.motions;
 	for (uint i = 0; i < motion_registry.size(); i++)
 	{
@@ -88,21 +91,29 @@ void PhysicsSystem::step(float elapsed_ms)
 			if (denderiteAI.state == DenderiteState::HUNT) {
 				denderiteAI.timeSinceLastRecalc += elapsed_ms;
 
-				bool needsRecalc = denderiteAI.path.empty() ||
-                           denderiteAI.timeSinceLastRecalc > denderiteAI.recalcTimeThreshold;
+				// swap in a finished plan, until then keep following the old path
+				if (denderiteAI.pending_path.valid() &&
+					denderiteAI.pending_path.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+					std::vector<ivec2> new_path = denderiteAI.pending_path.get();
+					denderiteAI.pending_path = {};
 
-				if (needsRecalc) {
-					denderiteAI.path.clear();
-            		denderiteAI.currentNodeIndex = 0;
-
-					if(find_path(denderiteAI.path, motion.position, player_motion.position)) {
-						denderiteAI.timeSinceLastRecalc = 0;
-					} else {
+					if (!new_path.empty()) {
+						denderiteAI.path = std::move(new_path);
+						denderiteAI.currentNodeIndex = 0;
+					} else if (denderiteAI.path.empty()) {
 						motion.velocity = {0.f, 0.f};
 						motion.angle = 0.f;
 					}
 				}
 
+				bool needsRecalc = denderiteAI.path.empty() ||
+                           denderiteAI.timeSinceLastRecalc > denderiteAI.recalcTimeThreshold;
+
+				if (needsRecalc && !denderiteAI.pending_path.valid()) {
+					denderiteAI.pending_path = path_planner.requestPath(motion.position, player_motion.position);
+					denderiteAI.timeSinceLastRecalc = 0;
+				}
+
 				if (!denderiteAI.path.empty()) {
 					if (denderiteAI.currentNodeIndex >= (int)denderiteAI.path.size()) {
 						motion.velocity = {0.f, 0.f};
@@ -133,16 +144,6 @@ void PhysicsSystem::step(float elapsed_ms)
 			}
 		}
 
-		if (registry.spiralProjectiles.has(entity)) {
-			float spiral_speed = 0.5f;
-			float angle = spiral_speed * step_seconds;
-
-			// 2D Rotation Matrix
-			float new_x = motion.velocity.x * cos(angle) - motion.velocity.y * sin(angle);
-			float new_y = motion.velocity.x * sin(angle) + motion.velocity.y * cos(angle);
-			motion.velocity = { new_x, new_y };
-		}
-
 		if (registry.followingProjectiles.has(entity)) {
 			float speed = glm::length(motion.velocity);
 			vec2 direction = glm::normalize(player_motion.position - motion.position);
@@ -171,13 +172,8 @@ void PhysicsSystem::step(float elapsed_ms)
 		// knockback
 		if (registry.players.has(entity)) {
 			Player& player = registry.players.get(entity);
-            if (player.knockback_duration > 0.0f) {
-			    player.knockback_duration -= elapsed_ms;
-            }
- 
-			if (player.knockback_duration < 0.f) {
+			if (player.knockback.ranOut()) {
 				motion.velocity = vec2(0.0f, 0.0f);
-				player.knockback_duration = 0.f;
 			}
 		}
 
@@ -239,21 +235,14 @@ void PhysicsSystem::step(float elapsed_ms)
 	}
 
 	// PLAYER DASH ACTION COOLDOWN
-	player.dash_cooldown_timer_ms -= elapsed_ms;
-	if (player.dash_cooldown_timer_ms <= 0)
+	if (player.dash_recharge.due() && player.dash_count < player.max_dash_count)
 	{
+		player.dash_count++;
+
+		// left due once full, the next dash starts it again
 		if (player.dash_count < player.max_dash_count)
 		{
-			player.dash_count++;
-
-			if (player.dash_count == player.max_dash_count)
-			{
-				player.dash_cooldown_timer_ms = 0;
-			}
-			else
-			{
-				player.dash_cooldown_timer_ms = player.dash_cooldown_ms;
-			}
+			player.dash_recharge.start(player.dash_cooldown_ms);
 		}
 	}
 	
@@ -315,7 +304,7 @@ void PhysicsSystem::step(float elapsed_ms)
 			Projectile& projectile = registry.projectiles.get(proj_entity);
 			
 			// to prevent projectile (from enemy) to enemy collision
-			if (projectile.from_enemy) continue;
+			if (projectile.from_enemy || !projectile.active) continue;
 
 			Motion& proj_motion = registry.motions.get(proj_entity);
 
@@ -331,7 +320,7 @@ void PhysicsSystem::step(float elapsed_ms)
 		{
 			// to make sure the player doesn't get locked to the enemy 
 			if ((registry.bossAIs.has(e_entity) || registry.finalBossAIs.has(e_entity)) && glm::length(e_motion.velocity) > 0.1f) {
-				player.knockback_duration = 500.f;
+				player.knockback.start(500.f);
 			} 
 
 			registry.collisions.emplace_with_duplicates(player_entity, e_entity);
@@ -340,8 +329,11 @@ void PhysicsSystem::step(float elapsed_ms)
 		 handleWallCollision(e_entity);
 	}
 
-	for (auto& proj_entity : registry.projectiles.entities)
+	for (uint i = 0; i < registry.projectiles.size(); i++)
 	{
+		if (!registry.projectiles.components[i].active)
+			continue;
+		Entity proj_entity = registry.projectiles.entities[i];
 		Motion& proj_motion = registry.motions.get(proj_entity);
 		// ensure the projectile is the "second" entity
 		if (detector.hasCollided(proj_motion, player_motion))
@@ -511,109 +503,12 @@ std::vector<vec2> PhysicsSystem::getWorldVertices(const std::vector<TexturedVert
 }
 
 bool PhysicsSystem::find_path(std::vector<ivec2> & path, vec2 start_world, vec2 end_world)
-{	
+{
 	const auto& map = registry.proceduralMaps.get(registry.proceduralMaps.entities[0]).map;
-	int map_height = map.size();
-	
-	std::vector<ivec2> boss_locs = {{9, 9}, {10, 9}, {9, 10}, {9, 10}};
-
-	ivec2 start_pos = positionToGridCell(start_world);
-	ivec2 end_pos = positionToGridCell(end_world);
-	
-	struct Node {
-		ivec2 position;
-		int g_cost;
-		int h_cost;
-		Node* parent;
-		int f_cost() const { return g_cost + h_cost; }
-	};
-
-	struct CompareNode {
-		bool operator()(const Node* a, const Node* b) const {
-			return a->f_cost() > b->f_cost(); 
-		}
-	};
-	
-	struct CompareVec2 {
-		bool operator()(const glm::ivec2& a, const glm::ivec2& b) const {
-			if (a.x == b.x) return a.y < b.y;
-			return a.x < b.x;
-		}
-	};
-
-	std::priority_queue<Node*, std::vector<Node*>, CompareNode> open;
-    std::set<ivec2, CompareVec2> closed;
-    std::map<ivec2, Node*, CompareVec2> all_nodes;
-
-	auto heuristic = [](ivec2 a, ivec2 b) {
-        return abs(a.x - b.x) + abs(a.y - b.y); 
-    };
-
-	
-	Node* start = new Node{ start_pos, 0, heuristic(start_pos, end_pos), nullptr };
-    open.push(start);
-    all_nodes[start_pos] = start;
-
-    const std::vector<ivec2> directions = {
-        {1, 0}, {-1, 0}, {0, 1}, {0, -1}
-    };
-
-	while(!open.empty()) {
-		Node* current = open.top();
-		open.pop();
-
-
-		if (current->position == end_pos) {
-			while (current) {
-				path.push_back(ivec2(current->position));
-				current = current->parent;	
-			}
-			std::reverse(path.begin(), path.end());
-			return true;
-		}
-
-		closed.insert(current->position);
-		
-		for (auto& dir : directions) {
-			ivec2 neighbor_pos = current->position + dir;
-
-            if (closed.find(neighbor_pos) != closed.end()) continue;
-            if (!isTraversable(neighbor_pos)) continue;
-			if (std::find(boss_locs.begin(), boss_locs.end(), neighbor_pos) != boss_locs.end()) continue;
-
-            int g_cost = current->g_cost + 1;
-            int h_cost = heuristic(neighbor_pos, end_pos);
-            int f_cost = g_cost + h_cost;
-
-            if (all_nodes.find(neighbor_pos) == all_nodes.end() || f_cost < all_nodes[neighbor_pos]->f_cost()) {
-                Node* neighbor = new Node{ neighbor_pos, g_cost, h_cost, current };
-                open.push(neighbor);
-                all_nodes[neighbor_pos] = neighbor;
-            }
-		}
-	}
-
-	return false;
+	return findPathOnMap(map, positionToGridCell(start_world), positionToGridCell(end_world), path);
 }
 
 bool PhysicsSystem::isTraversable(ivec2 pos) {
 	const auto& map = registry.proceduralMaps.get(registry.proceduralMaps.entities[0]).map;
-
-	int map_width = map.size();
-    if (map_width == 0)
-        return false; // map is empty
-
-    int map_height = map[0].size();
-
-	int x = pos.x;
-    int y = pos.y;
-
-    // Check bounds
-    if (x < 0 || x >= map_width ||
-        y < 0 || y >= map_height)
-    {
-        return false;
-    }
-
-	return map[x][y] != tileType::WALL;
+	return isTraversableOnMap(map, pos);
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include "common.hpp"
 #include "collisions/collision_system.hpp"
+#include "path_planner.hpp"
 #include "tinyECS/tiny_ecs.hpp"
 #include "tinyECS/components.hpp"
 #include "tinyECS/registry.hpp"
@@ -33,5 +34,8 @@ private:
 
 	// the collision detector to detect and handle collisions
 	CollisionSystem detector;
+
+	// background A* for the denderites
+	PathPlanner path_planner;
 };
 
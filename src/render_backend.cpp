@@ -0,0 +1,180 @@
+#include "render_backend.hpp"
+
+#include <cassert>
+
+void GLRenderBackend::init()
+{
+	stream.init(STREAM_FRAME_BYTES);
+}
+
+void GLRenderBackend::destroy()
+{
+	stream.destroy();
+}
+
+void GLRenderBackend::setUniform(const RenderCommand &command, const unsigned char *value)
+{
+	UniformHandle handle;
+	handle.location = command.uniform.location;
+	handle.type = command.uniform.type;
+	handle.size = 1;
+
+	switch (handle.type)
+	{
+	case GL_FLOAT:
+		handle.set(*(const float *)value);
+		break;
+	case GL_FLOAT_VEC2:
+		handle.set(*(const vec2 *)value);
+		break;
+	case GL_FLOAT_VEC3:
+		handle.set(*(const vec3 *)value);
+		break;
+	case GL_FLOAT_MAT3:
+		handle.set(*(const mat3 *)value);
+		break;
+	case GL_FLOAT_MAT4:
+		handle.set(*(const mat4 *)value);
+		break;
+	default:
+		handle.set(*(const int *)value);
+		break;
+	}
+}
+
+void GLRenderBackend::execute(const RenderCommandList &commands)
+{
+	stream_offsets.assign(commands.streamUploads(), 0);
+	// the uploads below bind their own buffers, 0 means the array buffer binding isn't known
+	array_buffer = 0;
+
+	for (const RenderCommand &command : commands.commands())
+	{
+		const unsigned char *payload = commands.payload(command);
+		switch (command.op)
+		{
+		case RENDER_OP::BEGIN_PASS:
+		{
+			const PassArgs &pass = command.pass;
+			glBindFramebuffer(GL_FRAMEBUFFER, pass.framebuffer);
+			glViewport(0, 0, pass.width, pass.height);
+			glDepthRange(pass.depth_near, pass.depth_far);
+			glClearColor(pass.clear_color[0], pass.clear_color[1], pass.clear_color[2], pass.clear_color[3]);
+			glClearDepth(pass.clear_depth);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			// native OpenGL does not work with a depth buffer and alpha blending,
+			// sprites are drawn back to front instead
+			glDisable(GL_DEPTH_TEST);
+			gl_has_errors();
+			break;
+		}
+		case RENDER_OP::SET_BLEND:
+			if (command.blend)
+			{
+				glEnable(GL_BLEND);
+				glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+			}
+			else
+				glDisable(GL_BLEND);
+			break;
+		case RENDER_OP::USE_PROGRAM:
+			glUseProgram(command.bind.object);
+			break;
+		case RENDER_OP::BIND_TEXTURE:
+			assert(command.bind.unit < (GLint)unit_textures.size());
+			glActiveTexture(GL_TEXTURE0 + command.bind.unit);
+			glBindTexture(GL_TEXTURE_2D, command.bind.object);
+			unit_textures[command.bind.unit] = command.bind.object;
+			if (command.bind.unit != 0)
+				glActiveTexture(GL_TEXTURE0);
+			break;
+		case RENDER_OP::BIND_VERTEX_ARRAY:
+			glBindVertexArray(command.bind.object);
+			break;
+		case RENDER_OP::SET_UNIFORM:
+			setUniform(command, payload);
+			break;
+		case RENDER_OP::UPLOAD_STREAM:
+			stream_offsets[command.upload.stream_slot] = stream.write(payload, command.payload_size);
+			array_buffer = 0;
+			break;
+		case RENDER_OP::UPLOAD_BUFFER:
+			glBindBuffer(GL_ARRAY_BUFFER, command.upload.object);
+			if (command.upload.reallocate)
+				glBufferData(GL_ARRAY_BUFFER, command.payload_size, payload, GL_STATIC_DRAW);
+			else
+				glBufferSubData(GL_ARRAY_BUFFER, command.upload.offset, command.payload_size, payload);
+			array_buffer = command.upload.object;
+			gl_has_errors();
+			break;
+		case RENDER_OP::UPLOAD_TEXTURE:
+		{
+			const UploadArgs &upload = command.upload;
+			const void *texels = command.payload_size > 0 ? payload : nullptr;
+			// uploads go through unit 0, its texture is put back afterwards
+			glBindTexture(GL_TEXTURE_2D, upload.object);
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+			if (upload.reallocate)
+				glTexImage2D(GL_TEXTURE_2D, 0, upload.internal_format, upload.width, upload.height, 0, upload.format, GL_UNSIGNED_BYTE, texels);
+			else
+				glTexSubImage2D(GL_TEXTURE_2D, 0, upload.x, upload.y, upload.width, upload.height, upload.format, GL_UNSIGNED_BYTE, texels);
+			glBindTexture(GL_TEXTURE_2D, unit_textures[0]);
+			gl_has_errors();
+			break;
+		}
+		case RENDER_OP::ATTRIB_POINTER:
+		{
+			const AttribArgs &attrib = command.attrib;
+			GLuint buffer = attrib.buffer;
+			GLintptr offset = attrib.offset;
+			if (attrib.stream_slot >= 0)
+			{
+				buffer = stream.buffer();
+				offset += stream_offsets[attrib.stream_slot];
+			}
+			if (buffer != array_buffer)
+			{
+				glBindBuffer(GL_ARRAY_BUFFER, buffer);
+				array_buffer = buffer;
+			}
+			glVertexAttribPointer(attrib.location, attrib.components, GL_FLOAT, GL_FALSE, attrib.stride, (void *)offset);
+			break;
+		}
+		case RENDER_OP::DRAW_ELEMENTS:
+			if (command.draw.instances > 0)
+				glDrawElementsInstanced(command.draw.mode, command.draw.count, GL_UNSIGNED_SHORT, nullptr, command.draw.instances);
+			else
+				glDrawElements(command.draw.mode, command.draw.count, GL_UNSIGNED_SHORT, nullptr);
+			gl_has_errors();
+			break;
+		case RENDER_OP::DRAW_ARRAYS:
+			glDrawArrays(command.draw.mode, 0, command.draw.count);
+			gl_has_errors();
+			break;
+		case RENDER_OP::END_FRAME:
+			stream.nextFrame();
+			break;
+		default:
+			assert(false && "unknown render op");
+			break;
+		}
+	}
+	gl_has_errors();
+}
+
+void NullRenderBackend::execute(const RenderCommandList &commands)
+{
+	for (const RenderCommand &command : commands.commands())
+	{
+		op_counts[(int)command.op]++;
+		if (command.op == RENDER_OP::END_FRAME)
+			frame_count++;
+	}
+
+	last_frame = commands.stats();
+	totals.program_binds += last_frame.program_binds;
+	totals.texture_binds += last_frame.texture_binds;
+	totals.buffer_binds += last_frame.buffer_binds;
+	totals.draw_calls += last_frame.draw_calls;
+	totals.upload_bytes += last_frame.upload_bytes;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "render_commands.hpp"
+#include "stream_buffer.hpp"
+
+#include <array>
+
+// Runs the command lists RenderSystem records, once per frame
+class RenderBackend
+{
+public:
+	virtual ~RenderBackend() = default;
+	virtual void execute(const RenderCommandList &commands) = 0;
+};
+
+// Issues the commands to the current GL context
+class GLRenderBackend : public RenderBackend
+{
+public:
+	// per-frame vertex data of every instanced path, grows if a frame needs more
+	static const GLsizeiptr STREAM_FRAME_BYTES = 1 << 20;
+
+	void init();
+	void destroy();
+
+	void execute(const RenderCommandList &commands) override;
+
+private:
+	void setUniform(const RenderCommand &command, const unsigned char *value);
+
+	StreamBuffer stream;
+	std::vector<GLintptr> stream_offsets; // offset of every stream slot of the frame being executed
+	GLuint array_buffer = 0;
+	std::array<GLuint, 2> unit_textures = {};
+};
+
+// Needs no context and draws nothing, it only keeps count of what the recorded frames would do.
+// Lets a scripted scene be rendered on a machine without a GPU to check its draw calls,
+// state changes and upload sizes.
+class NullRenderBackend : public RenderBackend
+{
+public:
+	void execute(const RenderCommandList &commands) override;
+
+	int frames() const { return frame_count; }
+	const RenderStats &lastFrame() const { return last_frame; }
+	const RenderStats &total() const { return totals; }
+	long long opCount(RENDER_OP op) const { return op_counts[(int)op]; }
+
+private:
+	int frame_count = 0;
+	RenderStats last_frame;
+	RenderStats totals;
+	std::array<long long, render_op_count> op_counts = {};
+};
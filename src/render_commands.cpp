@@ -0,0 +1,204 @@
+#include "render_commands.hpp"
+
+#include <cassert>
+#include <cstring>
+
+void RenderCommandList::clear()
+{
+	list.clear();
+	payload_bytes.clear();
+	stream_uploads = 0;
+	frame_stats = RenderStats();
+	pointer_buffer = 0;
+	pointer_slot = -1;
+}
+
+RenderCommand &RenderCommandList::push(RENDER_OP op)
+{
+	list.emplace_back();
+	RenderCommand &command = list.back();
+	command.op = op;
+	return command;
+}
+
+void RenderCommandList::copyPayload(RenderCommand &command, const void *data, GLsizeiptr size)
+{
+	command.payload_offset = (uint32_t)payload_bytes.size();
+	command.payload_size = (uint32_t)size;
+	if (data == nullptr || size == 0)
+	{
+		command.payload_size = 0;
+		return;
+	}
+	const unsigned char *bytes = (const unsigned char *)data;
+	payload_bytes.insert(payload_bytes.end(), bytes, bytes + size);
+}
+
+void RenderCommandList::beginPass(GLuint framebuffer, GLsizei width, GLsizei height, const vec4 &clear_color, float clear_depth, float depth_near, float depth_far)
+{
+	RenderCommand &command = push(RENDER_OP::BEGIN_PASS);
+	command.pass.framebuffer = framebuffer;
+	command.pass.width = width;
+	command.pass.height = height;
+	for (int i = 0; i < 4; i++)
+		command.pass.clear_color[i] = clear_color[i];
+	command.pass.clear_depth = clear_depth;
+	command.pass.depth_near = depth_near;
+	command.pass.depth_far = depth_far;
+}
+
+void RenderCommandList::setBlend(bool enabled)
+{
+	push(RENDER_OP::SET_BLEND).blend = enabled;
+}
+
+void RenderCommandList::useProgram(GLuint program)
+{
+	push(RENDER_OP::USE_PROGRAM).bind = {program, 0};
+	frame_stats.program_binds++;
+}
+
+void RenderCommandList::bindTexture(GLuint texture, GLint unit)
+{
+	push(RENDER_OP::BIND_TEXTURE).bind = {texture, unit};
+	frame_stats.texture_binds++;
+}
+
+void RenderCommandList::bindVertexArray(GLuint vao)
+{
+	push(RENDER_OP::BIND_VERTEX_ARRAY).bind = {vao, 0};
+	frame_stats.buffer_binds++;
+	pointer_buffer = 0;
+	pointer_slot = -1;
+}
+
+void RenderCommandList::pushUniform(const UniformHandle &handle, const void *value, GLsizeiptr size)
+{
+	RenderCommand &command = push(RENDER_OP::SET_UNIFORM);
+	command.uniform = {handle.location, handle.type};
+	copyPayload(command, value, size);
+}
+
+void RenderCommandList::setUniform(const UniformHandle &handle, float value)
+{
+	if (handle.location < 0)
+		return;
+	assert(handle.type == GL_FLOAT);
+	pushUniform(handle, &value, sizeof(value));
+}
+
+void RenderCommandList::setUniform(const UniformHandle &handle, int value)
+{
+	if (handle.location < 0)
+		return;
+	assert(handle.type == GL_INT || handle.type == GL_BOOL || handle.type == GL_SAMPLER_2D || handle.type == GL_UNSIGNED_INT_SAMPLER_2D);
+	pushUniform(handle, &value, sizeof(value));
+}
+
+void RenderCommandList::setUniform(const UniformHandle &handle, const vec2 &value)
+{
+	if (handle.location < 0)
+		return;
+	assert(handle.type == GL_FLOAT_VEC2);
+	pushUniform(handle, &value, sizeof(value));
+}
+
+void RenderCommandList::setUniform(const UniformHandle &handle, const vec3 &value)
+{
+	if (handle.location < 0)
+		return;
+	assert(handle.type == GL_FLOAT_VEC3);
+	pushUniform(handle, &value, sizeof(value));
+}
+
+void RenderCommandList::setUniform(const UniformHandle &handle, const mat3 &value)
+{
+	if (handle.location < 0)
+		return;
+	assert(handle.type == GL_FLOAT_MAT3);
+	pushUniform(handle, &value, sizeof(value));
+}
+
+void RenderCommandList::setUniform(const UniformHandle &handle, const mat4 &value)
+{
+	if (handle.location < 0)
+		return;
+	assert(handle.type == GL_FLOAT_MAT4);
+	pushUniform(handle, &value, sizeof(value));
+}
+
+int RenderCommandList::uploadStream(const void *data, GLsizeiptr size)
+{
+	RenderCommand &command = push(RENDER_OP::UPLOAD_STREAM);
+	command.upload = UploadArgs();
+	command.upload.stream_slot = stream_uploads;
+	copyPayload(command, data, size);
+	frame_stats.upload_bytes += size;
+	return stream_uploads++;
+}
+
+void RenderCommandList::uploadBuffer(GLuint buffer, GLintptr offset, const void *data, GLsizeiptr size, bool reallocate)
+{
+	RenderCommand &command = push(RENDER_OP::UPLOAD_BUFFER);
+	command.upload = UploadArgs();
+	command.upload.object = buffer;
+	command.upload.offset = offset;
+	command.upload.reallocate = reallocate;
+	command.upload.stream_slot = -1;
+	copyPayload(command, data, size);
+	frame_stats.upload_bytes += size;
+}
+
+void RenderCommandList::uploadTexture(GLuint texture, ivec2 position, ivec2 size, GLenum internal_format, GLenum format, const void *data, GLsizeiptr data_size, bool reallocate)
+{
+	RenderCommand &command = push(RENDER_OP::UPLOAD_TEXTURE);
+	command.upload = UploadArgs();
+	command.upload.object = texture;
+	command.upload.x = position.x;
+	command.upload.y = position.y;
+	command.upload.width = size.x;
+	command.upload.height = size.y;
+	command.upload.internal_format = internal_format;
+	command.upload.format = format;
+	command.upload.reallocate = reallocate;
+	command.upload.stream_slot = -1;
+	copyPayload(command, data, data_size);
+	frame_stats.upload_bytes += command.payload_size;
+}
+
+void RenderCommandList::attribPointer(GLuint location, GLint components, GLsizei stride, GLintptr offset, GLuint buffer)
+{
+	push(RENDER_OP::ATTRIB_POINTER).attrib = {location, components, stride, offset, buffer, -1};
+	if (buffer != pointer_buffer || pointer_slot != -1)
+		frame_stats.buffer_binds++;
+	pointer_buffer = buffer;
+	pointer_slot = -1;
+}
+
+void RenderCommandList::streamAttribPointer(GLuint location, GLint components, GLsizei stride, GLintptr offset, int stream_slot)
+{
+	assert(stream_slot >= 0 && stream_slot < stream_uploads);
+	push(RENDER_OP::ATTRIB_POINTER).attrib = {location, components, stride, offset, 0, stream_slot};
+	// every slot is in the same stream buffer
+	if (pointer_slot == -1)
+		frame_stats.buffer_binds++;
+	pointer_buffer = 0;
+	pointer_slot = stream_slot;
+}
+
+void RenderCommandList::drawElements(GLsizei count, GLsizei instances)
+{
+	push(RENDER_OP::DRAW_ELEMENTS).draw = {GL_TRIANGLES, count, instances};
+	frame_stats.draw_calls++;
+}
+
+void RenderCommandList::drawArrays(GLsizei count)
+{
+	push(RENDER_OP::DRAW_ARRAYS).draw = {GL_TRIANGLES, count, 0};
+	frame_stats.draw_calls++;
+}
+
+void RenderCommandList::endFrame()
+{
+	push(RENDER_OP::END_FRAME);
+}
@@ -0,0 +1,164 @@
+#pragma once
+
+#include "common.hpp"
+#include "effect_reflection.hpp"
+
+#include <cstdint>
+#include <vector>
+
+// GL state changes, draws and uploads of one frame, shown under the FPS counter
+struct RenderStats
+{
+	int program_binds = 0;
+	int texture_binds = 0;
+	int buffer_binds = 0;
+	int draw_calls = 0;
+	long long upload_bytes = 0;
+};
+
+enum class RENDER_OP : uint8_t
+{
+	BEGIN_PASS = 0,
+	SET_BLEND = BEGIN_PASS + 1,
+	USE_PROGRAM = SET_BLEND + 1,
+	BIND_TEXTURE = USE_PROGRAM + 1,
+	BIND_VERTEX_ARRAY = BIND_TEXTURE + 1,
+	SET_UNIFORM = BIND_VERTEX_ARRAY + 1,
+	UPLOAD_STREAM = SET_UNIFORM + 1,
+	UPLOAD_BUFFER = UPLOAD_STREAM + 1,
+	UPLOAD_TEXTURE = UPLOAD_BUFFER + 1,
+	ATTRIB_POINTER = UPLOAD_TEXTURE + 1,
+	DRAW_ELEMENTS = ATTRIB_POINTER + 1,
+	DRAW_ARRAYS = DRAW_ELEMENTS + 1,
+	END_FRAME = DRAW_ARRAYS + 1,
+	OP_COUNT = END_FRAME + 1
+};
+const int render_op_count = (int)RENDER_OP::OP_COUNT;
+
+// binds a framebuffer, sets the viewport and clears it
+struct PassArgs
+{
+	GLuint framebuffer;
+	GLsizei width;
+	GLsizei height;
+	float clear_color[4];
+	float clear_depth;
+	float depth_near;
+	float depth_far;
+};
+
+struct BindArgs
+{
+	GLuint object; // program, texture or vertex array
+	GLint unit;	   // texture unit, textures only
+};
+
+struct UniformArgs
+{
+	GLint location;
+	GLenum type;
+};
+
+struct UploadArgs
+{
+	GLuint object;		 // buffer or texture, unused for the stream
+	GLintptr offset;	 // byte offset into the buffer
+	GLint x, y;			 // texel rect of a texture upload
+	GLsizei width, height;
+	GLenum internal_format;
+	GLenum format;
+	bool reallocate; // glBufferData / glTexImage2D instead of the Sub variants
+	int stream_slot; // stream uploads are numbered in the order they were recorded
+};
+
+struct AttribArgs
+{
+	GLuint location;
+	GLint components;
+	GLsizei stride;
+	GLintptr offset;
+	GLuint buffer;	 // 0 when the data is in the stream
+	int stream_slot; // -1 when the data is in buffer
+};
+
+struct DrawArgs
+{
+	GLenum mode;
+	GLsizei count;
+	GLsizei instances; // 0 for a plain draw
+};
+
+struct RenderCommand
+{
+	RENDER_OP op;
+	union
+	{
+		PassArgs pass;
+		bool blend;
+		BindArgs bind;
+		UniformArgs uniform;
+		UploadArgs upload;
+		AttribArgs attrib;
+		DrawArgs draw;
+	};
+	// bytes of the uniform value or upload in the list's payload storage
+	uint32_t payload_offset = 0;
+	uint32_t payload_size = 0;
+};
+
+// One frame of rendering, recorded by RenderSystem and executed afterwards by a RenderBackend.
+// Recording never touches GL, so the same frame can be counted without a context.
+// Uniform values and uploaded data are copied into the list.
+class RenderCommandList
+{
+public:
+	void clear();
+
+	void beginPass(GLuint framebuffer, GLsizei width, GLsizei height, const vec4 &clear_color, float clear_depth, float depth_near, float depth_far);
+	// blending is always src alpha, one minus src alpha when on
+	void setBlend(bool enabled);
+	void useProgram(GLuint program);
+	void bindTexture(GLuint texture, GLint unit = 0);
+	void bindVertexArray(GLuint vao);
+
+	// uniforms the program doesn't have are not recorded, the setter has to match the glsl type
+	void setUniform(const UniformHandle &handle, float value);
+	void setUniform(const UniformHandle &handle, int value);
+	void setUniform(const UniformHandle &handle, const vec2 &value);
+	void setUniform(const UniformHandle &handle, const vec3 &value);
+	void setUniform(const UniformHandle &handle, const mat3 &value);
+	void setUniform(const UniformHandle &handle, const mat4 &value);
+
+	// per frame vertex data, placed in the backend's stream buffer, returns the slot for streamAttribPointer
+	int uploadStream(const void *data, GLsizeiptr size);
+	void uploadBuffer(GLuint buffer, GLintptr offset, const void *data, GLsizeiptr size, bool reallocate);
+	// data may be null when reallocating
+	void uploadTexture(GLuint texture, ivec2 position, ivec2 size, GLenum internal_format, GLenum format, const void *data, GLsizeiptr data_size, bool reallocate);
+
+	void attribPointer(GLuint location, GLint components, GLsizei stride, GLintptr offset, GLuint buffer);
+	void streamAttribPointer(GLuint location, GLint components, GLsizei stride, GLintptr offset, int stream_slot);
+
+	// indices are GL_UNSIGNED_SHORT from the bound vertex array
+	void drawElements(GLsizei count, GLsizei instances = 0);
+	void drawArrays(GLsizei count);
+
+	void endFrame();
+
+	const std::vector<RenderCommand> &commands() const { return list; }
+	const unsigned char *payload(const RenderCommand &command) const { return payload_bytes.data() + command.payload_offset; }
+	int streamUploads() const { return stream_uploads; }
+	const RenderStats &stats() const { return frame_stats; }
+
+private:
+	RenderCommand &push(RENDER_OP op);
+	void copyPayload(RenderCommand &command, const void *data, GLsizeiptr size);
+	void pushUniform(const UniformHandle &handle, const void *value, GLsizeiptr size);
+
+	std::vector<RenderCommand> list;
+	std::vector<unsigned char> payload_bytes;
+	int stream_uploads = 0;
+	RenderStats frame_stats;
+	// counts an attribute buffer switch once per vertex array, like a glBindBuffer would be
+	GLuint pointer_buffer = 0;
+	int pointer_slot = -1;
+};
@@ -0,0 +1,65 @@
+#include "render_queue.hpp"
+
+#include <array>
+
+static_assert(texture_count <= 256 && effect_count <= 256 && geometry_count <= 256,
+	"render queue keys only have 8 bits for each asset id");
+
+void RenderQueue::clear()
+{
+	keys.clear();
+	entities.clear();
+}
+
+void RenderQueue::push(RENDER_LAYER layer, const RenderRequest& request, Entity entity)
+{
+	uint64_t key = (uint64_t)layer << 56;
+
+	// hud pieces overlap on purpose, keep them in submission order
+	if (layer != RENDER_LAYER::HUD)
+	{
+		key |= (uint64_t)request.used_effect << 48;
+		key |= (uint64_t)request.used_texture << 40;
+		key |= (uint64_t)request.used_geometry << 32;
+	}
+
+	key |= (uint64_t)entities.size();
+	keys.push_back(key);
+	entities.push_back(entity);
+}
+
+void RenderQueue::sort()
+{
+	const size_t n = keys.size();
+	if (n < 2)
+		return;
+
+	// one pass over the keys builds the histograms for all eight digits
+	std::array<std::array<uint32_t, 256>, 8> counts = {};
+	for (uint64_t key : keys)
+		for (int digit = 0; digit < 8; digit++)
+			counts[digit][(key >> (digit * 8)) & 0xff]++;
+
+	scratch.resize(n);
+	for (int digit = 0; digit < 8; digit++)
+	{
+		std::array<uint32_t, 256>& count = counts[digit];
+
+		// every key has the same byte here, the pass wouldn't move anything
+		const uint32_t first = (uint32_t)((keys[0] >> (digit * 8)) & 0xff);
+		if (count[first] == n)
+			continue;
+
+		uint32_t offset = 0;
+		for (uint32_t& c : count)
+		{
+			uint32_t bucket = c;
+			c = offset;
+			offset += bucket;
+		}
+
+		for (uint64_t key : keys)
+			scratch[count[(key >> (digit * 8)) & 0xff]++] = key;
+		keys.swap(scratch);
+	}
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "common.hpp"
+#include "tinyECS/components.hpp"
+#include "tinyECS/tiny_ecs.hpp"
+
+#include <cstdint>
+#include <vector>
+
+// Draw order buckets, lower layers are drawn first. Draws are only regrouped by GL state
+// within a layer, so anything that has to end up on top of something else needs a higher layer.
+enum class RENDER_LAYER
+{
+	GROUND = 0,
+	PICKUPS = GROUND + 1,
+	ENEMIES = PICKUPS + 1,
+	PLAYER = ENEMIES + 1,
+	WEAPONS = PLAYER + 1,
+	PROJECTILES = WEAPONS + 1,
+	EFFECTS = PROJECTILES + 1,
+	HUD = EFFECTS + 1,
+	LAYER_COUNT = HUD + 1
+};
+
+// One frame of draws, sorted so that draws sharing a program, texture and geometry are adjacent.
+// Key layout, most significant first:
+//   layer (8) | effect (8) | texture (8) | geometry (8) | submission index (32)
+// The index makes every key unique, so equal state keeps submission order.
+class RenderQueue
+{
+public:
+	void clear();
+
+	void push(RENDER_LAYER layer, const RenderRequest& request, Entity entity);
+
+	// LSD radix sort on the keys, bytes that are the same for every key are skipped
+	void sort();
+
+	size_t size() const { return keys.size(); }
+
+	// valid after sort(), in draw order
+	Entity entity(size_t i) const { return entities[(uint32_t)keys[i]]; }
+	// layer and GL state of the i-th draw, equal for draws that can share state
+	uint32_t state(size_t i) const { return (uint32_t)(keys[i] >> 32); }
+	RENDER_LAYER layer(size_t i) const { return (RENDER_LAYER)(keys[i] >> 56); }
+
+private:
+	std::vector<uint64_t> keys;
+	std::vector<uint64_t> scratch;
+	std::vector<Entity> entities;
+};
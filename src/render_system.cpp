@@ -3,6 +3,7 @@
 #include <iostream>
 #include <iomanip>
 #include <unordered_map>
+#include <cstddef>
 
 // internal
 #include "render_system.hpp"
@@ -11,6 +12,8 @@
 #include <sstream>
 #include <iomanip>
 #include "ui_system.hpp"
+#include "entity_pool.hpp"
+#include "bullet_patterns.hpp"
 
 void RenderSystem::updateFPS(float elapsed_ms)
 {
@@ -33,12 +36,49 @@ void RenderSystem::toggleFPSDisplay()
 	show_fps = !show_fps;
 }
 
+void RenderSystem::useProgram(GLuint program)
+{
+	if (program == bound_program)
+		return;
+	commands.useProgram(program);
+	bound_program = program;
+}
+
+void RenderSystem::bindTexture(GLuint texture)
+{
+	// everything draws from texture unit 0
+	if (texture == bound_texture)
+		return;
+	commands.bindTexture(texture);
+	bound_texture = texture;
+}
+
+void RenderSystem::bindVertexArray(GLuint vao)
+{
+	if (vao == bound_vao)
+		return;
+	commands.bindVertexArray(vao);
+	bound_vao = vao;
+}
+
+void RenderSystem::bindMesh(EFFECT_ASSET_ID effect, GEOMETRY_BUFFER_ID geometry)
+{
+	assert(geometry != GEOMETRY_BUFFER_ID::GEOMETRY_COUNT);
+	const GLuint vao = mesh_vaos[(GLuint)effect][(GLuint)geometry];
+	assert(vao != 0 && "effect reads vertex attributes the geometry doesn't have");
+	bindVertexArray(vao);
+}
+
+void RenderSystem::resetBoundState()
+{
+	bound_program = 0;
+	bound_texture = 0;
+	bound_vao = 0;
+}
+
 void RenderSystem::drawTexturedMesh(Entity entity,
 																		const mat3 &projection)
 {
-    glBindVertexArray(default_vao);
-    gl_has_errors();
-
 	assert(registry.renderRequests.has(entity));
 	const RenderRequest &render_request = registry.renderRequests.get(entity);
 
@@ -58,73 +98,35 @@ void RenderSystem::drawTexturedMesh(Entity entity,
 					"Type of render request not supported");
 
 	setUpDefaultProgram(entity, render_request, program);
+	const EffectReflection &effect_reflection = reflection(render_request.used_effect);
 
 	if (render_request.used_effect == EFFECT_ASSET_ID::MINI_MAP)
 	{
-		GLint map_width_uloc = glGetUniformLocation(program, "map_width");
-		GLint map_height_uloc = glGetUniformLocation(program, "map_height");
-		GLint player_grid_position_uloc = glGetUniformLocation(program, "player_grid_position");
-
-		glUniform1i(map_width_uloc, MAP_WIDTH);
-		glUniform1i(map_height_uloc, MAP_HEIGHT);
+		updateMiniMapTexture();
+		commands.setUniform(effect_reflection[UNIFORM_ID::MAP_WIDTH], mini_map_size.x);
+		commands.setUniform(effect_reflection[UNIFORM_ID::MAP_HEIGHT], mini_map_size.y);
 
 		// get player position
 		Player &player = registry.players.get(registry.players.entities[0]);
-		glUniform2fv(player_grid_position_uloc, 1, (float *)&player.grid_position);
-
-		// map array logic
-		GLint map_array_uloc = glGetUniformLocation(program, "map_array");
-		std::vector<std::vector<tileType>> map_array = registry.proceduralMaps.get(registry.proceduralMaps.entities[0]).map;
-		std::vector<int> flat_array;
-		flat_array.reserve(MAP_WIDTH * MAP_HEIGHT);
-
-		for (const auto &row : map_array)
-		{
-			for (const auto &tile : row)
-			{
-				flat_array.push_back(static_cast<int>(tile));
-			}
-		}
-		glUniform1iv(map_array_uloc, MAP_WIDTH * MAP_HEIGHT, flat_array.data());
-		glUniform2fv(player_grid_position_uloc, 1, (float *)&player.grid_position);
-
-		// PASS IN MINIMAP VISITED
-		GLint map_visited_array_uloc = glGetUniformLocation(program, "map_visited_array");
-		std::vector<std::vector<int>> map_visited_array = registry.miniMaps.get(registry.miniMaps.entities[0]).visited;
-		std::vector<int> flat_visited_array;
-		flat_visited_array.reserve(MAP_WIDTH * MAP_HEIGHT);
-
-		for (const auto &row : map_visited_array)
-		{
-			for (const auto &visited : row)
-			{
-				flat_visited_array.push_back(static_cast<int>(visited));
-			}
-		}
+		commands.setUniform(effect_reflection[UNIFORM_ID::PLAYER_GRID_POSITION], player.grid_position);
 
-		glUniform1iv(map_visited_array_uloc, MAP_WIDTH * MAP_HEIGHT, flat_visited_array.data());
+		// the cells are on unit 1, unit 0 keeps the sprite texture and its bind cache
+		commands.bindTexture(mini_map_texture, 1);
+		commands.setUniform(effect_reflection[UNIFORM_ID::MAP_TEXTURE], 1);
 	}
 
 	if (render_request.used_effect == EFFECT_ASSET_ID::HEALTH_BAR)
 	{
-		GLint max_health_loc = glGetUniformLocation(program, "max_health");
-		GLint health_loc = glGetUniformLocation(program, "current_health");
-		GLint health_texture_loc = glGetUniformLocation(program, "health_texture");
-
 		float max_health = 0.f;
 		float current_health = 0.f;
 
 		HealthBar &hb = registry.healthBars.get(entity);
 		if (hb.is_enemy_hp_bar)
 		{
-			for (Entity enemy : registry.enemies.entities)
-			{
-				Entity enemy_entity = hb.owner;
-				if (registry.enemies.has(enemy_entity)) {
-					Enemy &enemy = registry.enemies.get(enemy_entity);
-					max_health = (float)enemy.total_health;
-					current_health = (float)enemy.health;
-				}
+			if (registry.enemies.has(hb.owner)) {
+				Enemy &enemy = registry.enemies.get(hb.owner);
+				max_health = (float)enemy.total_health;
+				current_health = (float)enemy.health;
 			}
 		}
 		else
@@ -134,10 +136,9 @@ void RenderSystem::drawTexturedMesh(Entity entity,
 			current_health = player.current_health;
 		}
 
-		glUniform1f(max_health_loc, max_health);
-		glUniform1f(health_loc, current_health);
-		glUniform1i(health_texture_loc, 0);
-		gl_has_errors();
+		commands.setUniform(effect_reflection[UNIFORM_ID::MAX_HEALTH], max_health);
+		commands.setUniform(effect_reflection[UNIFORM_ID::CURRENT_HEALTH], current_health);
+		commands.setUniform(effect_reflection[UNIFORM_ID::HEALTH_TEXTURE], 0);
 	}
 
 
@@ -150,24 +151,16 @@ void RenderSystem::drawTexturedMesh(Entity entity,
 		// ULOCS TO PASS 
 		// uniform float max_danger;
 		// uniform float current_danger;
-		GLint max_danger_uloc = glGetUniformLocation(program, "max_danger");
-		glUniform1f(max_danger_uloc, (float)maxDangerLevel);
-		gl_has_errors();
-
-		GLint current_danger_uloc = glGetUniformLocation(program, "current_danger");
-		glUniform1f(current_danger_uloc, (float)current_danger_level);
-		gl_has_errors();
+		commands.setUniform(effect_reflection[UNIFORM_ID::MAX_DANGER], (float)maxDangerLevel);
+		commands.setUniform(effect_reflection[UNIFORM_ID::CURRENT_DANGER], (float)current_danger_level);
 	}
 
-	// Getting uniform locations for glUniform* calls
-	GLint color_uloc = glGetUniformLocation(program, "fcolor");
 	const vec3 color = registry.colors.has(entity) ? registry.colors.get(entity) : vec3(1);
-	glUniform3fv(color_uloc, 1, (float *)&color);
-	gl_has_errors();
+	commands.setUniform(effect_reflection[UNIFORM_ID::FCOLOR], color);
 
 	if (render_request.used_effect == EFFECT_ASSET_ID::SPRITE_SHEET || render_request.used_effect == EFFECT_ASSET_ID::TILE)
 	{
-		setUpSpriteSheetTexture(entity, program);
+		setUpSpriteSheetTexture(entity, effect_reflection);
 	}
 
 
@@ -175,29 +168,17 @@ void RenderSystem::drawTexturedMesh(Entity entity,
 	{
 		// also take vec2 camera position
 		Camera &camera = registry.cameras.get(registry.cameras.entities[0]);
-		vec2 cameraPos = camera.position;
-		GLint camera_position_uloc = glGetUniformLocation(program, "camera_position");
-		glUniform2fv(camera_position_uloc, 1, (float *)&cameraPos);
+		commands.setUniform(effect_reflection[UNIFORM_ID::CAMERA_POSITION], camera.position);
 	}
 
 	if (render_request.used_effect == EFFECT_ASSET_ID::WEAPON_COOLDOWN_INDICATOR) {
 		Gun &gun = registry.guns.get(registry.guns.entities[0]);
-		float ratio = 1.f - std::clamp(gun.cooldown_timer_ms / GUN_COOLDOWN_MS, 0.f, 1.f);
-		GLint ratio_uloc = glGetUniformLocation(program, "cooldown_ratio");
-		glUniform1f(ratio_uloc, ratio);
-		gl_has_errors();
+		float ratio = 1.f - std::clamp(gun.cooldown.remaining() / GUN_COOLDOWN_MS, 0.f, 1.f);
+		commands.setUniform(effect_reflection[UNIFORM_ID::COOLDOWN_RATIO], ratio);
 	}
 
 
-	// Get number of indices from index buffer, which has elements uint16_t
-	GLint size = 0;
-	glGetBufferParameteriv(GL_ELEMENT_ARRAY_BUFFER, GL_BUFFER_SIZE, &size);
-	gl_has_errors();
-
-	GLsizei num_indices = size / sizeof(uint16_t);
-
-	GLint currProgram;
-	glGetIntegerv(GL_CURRENT_PROGRAM, &currProgram);
+	GLsizei num_indices = index_counts[(GLuint)render_request.used_geometry];
 
 	if (registry.motions.has(entity))
 	{
@@ -211,80 +192,86 @@ void RenderSystem::drawTexturedMesh(Entity entity,
 		transform.rotate(radians(motion.angle));
 
 		// Setting uniform values to the currently bound program
-		GLuint transform_loc = glGetUniformLocation(currProgram, "transform");
-		glUniformMatrix3fv(transform_loc, 1, GL_FALSE, (float *)&transform.mat);
-		gl_has_errors();
+		commands.setUniform(effect_reflection[UNIFORM_ID::TRANSFORM], transform.mat);
 	}
 
-	GLuint projection_loc = glGetUniformLocation(currProgram, "projection");
-	glUniformMatrix3fv(projection_loc, 1, GL_FALSE, (float *)&projection);
-	gl_has_errors();
+	commands.setUniform(effect_reflection[UNIFORM_ID::PROJECTION], projection);
 
 	// Drawing of num_indices/3 triangles specified in the index buffer
-	glDrawElements(GL_TRIANGLES, num_indices, GL_UNSIGNED_SHORT, nullptr);
-	gl_has_errors();
+	commands.drawElements(num_indices);
 }
 
-void RenderSystem::setUpSpriteSheetTexture(Entity &entity, const GLuint program)
+void RenderSystem::updateMiniMapTexture()
+{
+	const ProceduralMap &map = registry.proceduralMaps.get(registry.proceduralMaps.entities[0]);
+	MiniMap &mini_map = registry.miniMaps.get(registry.miniMaps.entities[0]);
+
+	const ivec2 size = {map.map.empty() ? 0 : (int)map.map[0].size(), (int)map.map.size()};
+	if (size != mini_map_size)
+	{
+		// first use or a map of another size, (re)allocate and fill all of it
+		commands.uploadTexture(mini_map_texture, {0, 0}, size, GL_R8UI, GL_RED_INTEGER, nullptr, 0, true);
+		mini_map_size = size;
+		mini_map.upload_all = true;
+	}
+
+	ivec2 low = mini_map.changed_min;
+	ivec2 high = mini_map.changed_max;
+	if (mini_map.upload_all)
+	{
+		low = {0, 0};
+		high = size - 1;
+	}
+	else if (!mini_map.has_changes)
+		return;
+	mini_map.upload_all = false;
+	mini_map.has_changes = false;
+	if (size.x == 0 || size.y == 0)
+		return;
+
+	// visited cells can run past the map on its edge, only upload what is on it
+	low = glm::max(low, ivec2(0));
+	high = glm::min(high, size - 1);
+	if (high.x < low.x || high.y < low.y)
+		return;
+
+	const ivec2 extent = high - low + 1;
+	mini_map_texels.resize(extent.x * extent.y);
+	for (int row = 0; row < extent.y; row++)
+	{
+		for (int column = 0; column < extent.x; column++)
+		{
+			const int y = low.y + row;
+			const int x = low.x + column;
+			const bool visited = y < (int)mini_map.visited.size() && x < (int)mini_map.visited[y].size() && mini_map.visited[y][x] != 0;
+			mini_map_texels[row * extent.x + column] = (unsigned char)map.map[y][x] | (visited ? 0x80 : 0);
+		}
+	}
+
+	commands.uploadTexture(mini_map_texture, low, extent, GL_R8UI, GL_RED_INTEGER, mini_map_texels.data(), mini_map_texels.size(), false);
+}
+
+void RenderSystem::setUpSpriteSheetTexture(Entity &entity, const EffectReflection &effect_reflection)
 {
 	// SpriteSheet UNIFORMS see :
 	// 	int total_frames from SpriteSheetImage
 	// 	int current_frame from SpriteSheetImage
 	// 	int sprite size from sprite
-	GLint total_frames_uloc = glGetUniformLocation(program, "total_frames");
-	GLint current_frame_uloc = glGetUniformLocation(program, "current_frame");
-	GLint sprite_width_uloc = glGetUniformLocation(program, "sprite_width");
-	GLint sprite_height_uloc = glGetUniformLocation(program, "sprite_height");
-
 	SpriteSheetImage &spriteSheet = registry.spriteSheetImages.get(entity);
-	glUniform1i(total_frames_uloc, spriteSheet.total_frames);
-	glUniform1i(current_frame_uloc, spriteSheet.current_frame);
+	commands.setUniform(effect_reflection[UNIFORM_ID::TOTAL_FRAMES], spriteSheet.total_frames);
+	commands.setUniform(effect_reflection[UNIFORM_ID::CURRENT_FRAME], spriteSheet.current_frame);
 	SpriteSize &sprite = registry.spritesSizes.get(entity);
-	glUniform1i(sprite_width_uloc, sprite.width);
-	glUniform1i(sprite_height_uloc, sprite.height);
+	commands.setUniform(effect_reflection[UNIFORM_ID::SPRITE_WIDTH], sprite.width);
+	commands.setUniform(effect_reflection[UNIFORM_ID::SPRITE_HEIGHT], sprite.height);
 }
 
 void RenderSystem::setUpDefaultProgram(Entity &entity, const RenderRequest &render_request, const GLuint program)
 {
-	// Setting shaders
-	glUseProgram(program);
-	gl_has_errors();
-
-	assert(render_request.used_geometry != GEOMETRY_BUFFER_ID::GEOMETRY_COUNT);
-	const GLuint vbo = vertex_buffers[(GLuint)render_request.used_geometry];
-	const GLuint ibo = index_buffers[(GLuint)render_request.used_geometry];
-
-	// Setting vertex and index buffers
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
-	gl_has_errors();
-
-	GLint in_position_loc = glGetAttribLocation(program, "in_position");
-	GLint in_texcoord_loc = glGetAttribLocation(program, "in_texcoord");
-	gl_has_errors();
-	assert(in_texcoord_loc >= 0);
-
-	glEnableVertexAttribArray(in_position_loc);
-	glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE,
-												sizeof(TexturedVertex), (void *)0);
-	gl_has_errors();
-
-	glEnableVertexAttribArray(in_texcoord_loc);
-	glVertexAttribPointer(
-			in_texcoord_loc, 2, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex),
-			(void *)sizeof(
-					vec3)); // note the stride to skip the preceeding vertex position
-
-	// Enabling and binding texture to slot 0
-	glActiveTexture(GL_TEXTURE0);
-	gl_has_errors();
-
-	assert(registry.renderRequests.has(entity));
-	GLuint texture_id =
-			texture_gl_handles[(GLuint)registry.renderRequests.get(entity).used_texture];
-
-	glBindTexture(GL_TEXTURE_2D, texture_id);
-	gl_has_errors();
+	// Setting shaders, vertex array and the texture in slot 0,
+	// each only when it differs from the previous draw
+	useProgram(program);
+	bindMesh(render_request.used_effect, render_request.used_geometry);
+	bindTexture(texture_gl_handles[(GLuint)render_request.used_texture]);
 }
 
 // first draw to an intermediate texture,
@@ -292,120 +279,147 @@ void RenderSystem::setUpDefaultProgram(Entity &entity, const RenderRequest &rend
 // then draw the intermediate texture
 void RenderSystem::drawToScreen()
 {
-    glBindVertexArray(default_vao);
-    gl_has_errors();
-
 	// Setting shaders
 	// get the vignette texture, sprite mesh, and program
-	glUseProgram(effects[(GLuint)EFFECT_ASSET_ID::VIGNETTE]);
-	gl_has_errors();
+	useProgram(effects[(GLuint)EFFECT_ASSET_ID::VIGNETTE]);
 
 	// Clearing backbuffer
-	int w, h;
-	glfwGetFramebufferSize(window, &w, &h); // Note, this will be 2x the resolution given to glfwCreateWindow on retina displays
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
-	glViewport(0, 0, w, h);
-	glDepthRange(0, 10);
-	glClearColor(1.f, 0, 0, 1.0);
-	glClearDepth(1.f);
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-	gl_has_errors();
-	// Enabling alpha channel for textures
-	glDisable(GL_BLEND);
-	// glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-	glDisable(GL_DEPTH_TEST);
-
-	// Draw the screen texture on the quad geometry
-	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers[(GLuint)GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE]);
-	glBindBuffer(
-			GL_ELEMENT_ARRAY_BUFFER,
-			index_buffers[(GLuint)GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE]); // Note, GL_ELEMENT_ARRAY_BUFFER associates
-																																	 // indices to the bound GL_ARRAY_BUFFER
-	gl_has_errors();
+	const ivec2 size = framebufferSize(); // Note, this will be 2x the resolution given to glfwCreateWindow on retina displays
+	commands.beginPass(0, size.x, size.y, vec4(1.f, 0.f, 0.f, 1.f), 1.f, 0.f, 10.f);
+	// the screen texture already has its alpha applied
+	commands.setBlend(false);
+
+	// Draw the screen texture on the screen triangle, its VAO only has positions
+	bindMesh(EFFECT_ASSET_ID::VIGNETTE, GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE);
 
 	// add the "vignette" effect
-	const GLuint vignette_program = effects[(GLuint)EFFECT_ASSET_ID::VIGNETTE];
+	const EffectReflection &vignette = reflection(EFFECT_ASSET_ID::VIGNETTE);
 
 	// set clock
-	GLuint time_uloc = glGetUniformLocation(vignette_program, "time");
-	GLuint dead_timer_uloc = glGetUniformLocation(vignette_program, "darken_screen_factor");
-	GLuint vignette_timer_uloc = glGetUniformLocation(vignette_program, "vignette_screen_factor");
-
-	glUniform1f(time_uloc, (float)(glfwGetTime() * 10.0f));
+	commands.setUniform(vignette[UNIFORM_ID::TIME], (float)(glfwGetTime() * 10.0f));
 
 	ScreenState &screen = registry.screenStates.get(screen_state_entity);
 	// std::cout << "screen.darken_screen_factor: " << screen.darken_screen_factor << " entity id: " << screen_state_entity << std::endl;
-	glUniform1f(dead_timer_uloc, screen.darken_screen_factor);
-	glUniform1f(vignette_timer_uloc, screen.vignette_screen_factor);
-	gl_has_errors();
-
-	// Set the vertex position and vertex texture coordinates (both stored in the
-	// same VBO)
-	GLint in_position_loc = glGetAttribLocation(vignette_program, "in_position");
-	glEnableVertexAttribArray(in_position_loc);
-	glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE, sizeof(vec3), (void *)0);
-	gl_has_errors();
+	commands.setUniform(vignette[UNIFORM_ID::DARKEN_SCREEN_FACTOR], screen.darken_screen_factor);
+	commands.setUniform(vignette[UNIFORM_ID::VIGNETTE_SCREEN_FACTOR], screen.vignette_screen_factor);
 
 	// Bind our texture in Texture Unit 0
-	glActiveTexture(GL_TEXTURE0);
-
-	glBindTexture(GL_TEXTURE_2D, off_screen_render_buffer_color);
-	gl_has_errors();
+	bindTexture(off_screen_render_buffer_color);
 
 	// Draw
-	glDrawElements(
-			GL_TRIANGLES, 3, GL_UNSIGNED_SHORT,
-			nullptr); // one triangle = 3 vertices; nullptr indicates that there is
-								// no offset from the bound index buffer
-	gl_has_errors();
+	commands.drawElements(3); // one triangle = 3 vertices
+
+	// this is the last draw of every screen, so the frame ends here and is handed to the backend
+	commands.endFrame();
+	backend->execute(commands);
+	last_frame_stats = commands.stats();
+	commands.clear();
+	resetBoundState();
 }
 
-// Render our game world
-// http://www.opengl-tutorial.org/intermediate-tutorials/tutorial-14-render-to-texture/
-void RenderSystem::draw()
+ivec2 RenderSystem::framebufferSize() const
 {
-	// Getting size of window
+	if (window == nullptr)
+		return {WINDOW_WIDTH_PX, WINDOW_HEIGHT_PX};
 	int w, h;
-	glfwGetFramebufferSize(window, &w, &h); // Note, this will be 2x the resolution given to glfwCreateWindow on retina displays
+	glfwGetFramebufferSize(window, &w, &h);
+	return {w, h};
+}
 
-	// First render to the custom framebuffer
-	glBindFramebuffer(GL_FRAMEBUFFER, frame_buffer);
-	gl_has_errors();
+void RenderSystem::swapBuffers()
+{
+	// flicker-free display with a double buffer
+	if (window != nullptr)
+		glfwSwapBuffers(window);
+}
 
-	// clear backbuffer
-	glViewport(0, 0, w, h);
-	glDepthRange(0.00001, 10);
+RENDER_LAYER RenderSystem::renderLayer(Entity entity) const
+{
+	if (registry.uiElements.has(entity) || registry.healthBars.has(entity) || registry.buffUIs.has(entity) ||
+			registry.popupElements.has(entity) || registry.thermometers.has(entity) || registry.miniMaps.has(entity))
+		return RENDER_LAYER::HUD;
+	if (registry.effects.has(entity))
+		return RENDER_LAYER::EFFECTS;
+	if (registry.projectiles.has(entity))
+		return RENDER_LAYER::PROJECTILES;
+	if (registry.guns.has(entity))
+		return RENDER_LAYER::WEAPONS;
+	if (registry.players.has(entity))
+		return RENDER_LAYER::PLAYER;
+	if (registry.enemies.has(entity))
+		return RENDER_LAYER::ENEMIES;
+	if (registry.buffs.has(entity) || registry.keys.has(entity) || registry.chests.has(entity))
+		return RENDER_LAYER::PICKUPS;
+	return RENDER_LAYER::GROUND;
+}
 
-	// white background
-	glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+void RenderSystem::cullWorld()
+{
+	// same view rectangle as createProjectionMatrix
+	Camera &camera = registry.cameras.get(registry.cameras.entities[0]);
+	view_min = camera.position - vec2(WINDOW_WIDTH_PX, WINDOW_HEIGHT_PX) * 0.5f;
+	view_max = view_min + vec2(WINDOW_WIDTH_PX, WINDOW_HEIGHT_PX);
 
-	glClearDepth(10.f);
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-	glDisable(GL_DEPTH_TEST); // native OpenGL does not work with a depth buffer
-														// and alpha blending, one would have to sort
-														// sprites back to front
-	gl_has_errors();
+	visibility_grid.clear();
+	unculled_entities.clear();
+	for (size_t i = 0; i < registry.renderRequests.size(); i++)
+	{
+		// parked in an entity pool
+		if (!registry.renderRequests.components[i].visible)
+			continue;
 
-	mat3 projection_2D = createProjectionMatrix();
+		Entity entity = registry.renderRequests.entities[i];
+		// the tile layer culls its own rows
+		if (registry.tiles.has(entity))
+			continue;
 
-	// Draw all tiles first
-	drawInstancedTiles(projection_2D);
+		// hud pieces and anything without a motion have no world bounds, always draw them,
+		// enemy health bars are drawn with the hud but hang over their enemy in the world
+		const bool enemy_hp_bar = registry.healthBars.has(entity) && registry.healthBars.get(entity).is_enemy_hp_bar;
+		if (!registry.motions.has(entity) || (renderLayer(entity) == RENDER_LAYER::HUD && !enemy_hp_bar))
+		{
+			unculled_entities.push_back(entity);
+			continue;
+		}
 
-	// draw portal
-	for (Entity entity : registry.portals.entities)
-	{
-		if (registry.renderRequests.has(entity))
-			drawTexturedMesh(entity, projection_2D);
+		// bounds of the rotated quad
+		const Motion &motion = registry.motions.get(entity);
+		const float angle = radians(motion.angle);
+		const vec2 half = abs(motion.scale) * 0.5f;
+		const float c = fabs(cos(angle));
+		const float s = fabs(sin(angle));
+		const vec2 extent = {half.x * c + half.y * s, half.x * s + half.y * c};
+		visibility_grid.insert(entity, motion.position - extent, motion.position + extent);
 	}
+	visibility_grid.build();
+	visibility_grid.query(view_min, view_max, visible_entities);
 
-	for (Entity entity : registry.renderRequests.entities)
-	{
-		// Skip entities that have a Particle component, Particles are drawn using instancing
-		if (registry.particles.has(entity))
-			continue;
+	cull_stats.visible = (int)visible_entities.size();
+	cull_stats.culled = (int)(visibility_grid.size() - visible_entities.size());
+	visible_entities.insert(visible_entities.end(), unculled_entities.begin(), unculled_entities.end());
+}
+
+// Render our game world
+// http://www.opengl-tutorial.org/intermediate-tutorials/tutorial-14-render-to-texture/
+void RenderSystem::draw()
+{
+	// Getting size of window
+	const ivec2 size = framebufferSize(); // Note, this will be 2x the resolution given to glfwCreateWindow on retina displays
 
+	// First render to the custom framebuffer, white background
+	commands.beginPass(frame_buffer, size.x, size.y, vec4(1.f), 10.f, 0.00001f, 10.f);
+	commands.setBlend(true);
+
+	mat3 projection_2D = createProjectionMatrix();
+
+	// Draw all tiles first, portals included
+	drawInstancedTiles(projection_2D);
+
+	// collect the world pass from what the camera sees, then draw it sorted by layer and GL state
+	cullWorld();
+	render_queue.clear();
+	for (Entity entity : visible_entities)
+	{
 		if (registry.tiles.has(entity))
 			continue;
 
@@ -416,7 +430,7 @@ void RenderSystem::draw()
 
 		if (registry.keys.has(entity) || registry.chests.has(entity))
 		{
-			drawHexagon(entity, projection_2D);
+			render_queue.push(renderLayer(entity), registry.renderRequests.get(entity), entity);
 		}
 		else if ((registry.motions.has(entity) 
 				|| !registry.spriteSheetImages.has(entity)) 
@@ -428,8 +442,47 @@ void RenderSystem::draw()
 				&& !registry.shops.has(entity)
 				&& !registry.overs.has(entity))
 		{
-			drawTexturedMesh(entity, projection_2D);
+			render_queue.push(renderLayer(entity), registry.renderRequests.get(entity), entity);
+		}
+	}
+
+	render_queue.sort();
+	// enemy and boss bullets live outside the registry, they go in at the end of the projectile layer
+	bool bullets_drawn = false;
+	size_t i = 0;
+	while (i < render_queue.size())
+	{
+		if (!bullets_drawn && render_queue.layer(i) > RENDER_LAYER::PROJECTILES)
+		{
+			drawBullets(projection_2D);
+			bullets_drawn = true;
+		}
+
+		Entity entity = render_queue.entity(i);
+		if (isBatchableSprite(entity))
+		{
+			// take the whole run of sprites in this layer that sample the same texture,
+			// textures packed on the same atlas page count as the same one
+			const RENDER_LAYER layer = render_queue.layer(i);
+			const GLuint texture = spriteBatchTexture(registry.renderRequests.get(entity).used_texture);
+			sprite_instances.clear();
+			while (i < render_queue.size() && render_queue.layer(i) == layer)
+			{
+				Entity next = render_queue.entity(i);
+				if (!isBatchableSprite(next) || spriteBatchTexture(registry.renderRequests.get(next).used_texture) != texture)
+					break;
+				sprite_instances.push_back(spriteInstance(next));
+				i++;
+			}
+			drawSpriteBatch(texture, projection_2D);
+			continue;
 		}
+
+		if (registry.keys.has(entity) || registry.chests.has(entity))
+			drawHexagon(entity, projection_2D);
+		else
+			drawTexturedMesh(entity, projection_2D);
+		i++;
 	}
 
 	// // draw gun
@@ -449,6 +502,9 @@ void RenderSystem::draw()
     // 	}
 	// }
 
+	if (!bullets_drawn)
+		drawBullets(projection_2D);
+
 	for (Entity entity : registry.bossArrows.entities)
 	{
 		BossArrow &arrow = registry.bossArrows.get(entity);
@@ -482,6 +538,8 @@ void RenderSystem::draw()
 		Motion& motion = registry.motions.get(entity);
 		renderText(text.text, motion.position.x, motion.position.y, motion.scale.x, text.color); 
 	}
+	// text goes over the world and the ui elements, particles go over the text
+	drawTextBatch();
 
 	// INSTANCING: Draw instanced particles
 	drawInstancedParticles();
@@ -489,10 +547,7 @@ void RenderSystem::draw()
 	// draw framebuffer to screen
 	// adding "vignette" effect when applied
 	drawToScreen();
-
-	// flicker-free display with a double buffer
-	glfwSwapBuffers(window);
-	gl_has_errors();
+	swapBuffers();
 }
 
 vec2 worldToScreen(vec2 world_pos) {
@@ -612,6 +667,8 @@ void RenderSystem::drawShopText() {
         screen_pos_text.y -= 65.f;
         renderText(buffName, screen_pos_text.x, screen_pos_text.y, .3f, vec3(0.f, 0.f, 0.f));
     }
+    // the germoney icon goes over the buff labels
+    drawTextBatch();
 
     Motion motion;
     for (auto entity : registry.uiElements.entities) {
@@ -646,6 +703,41 @@ void RenderSystem::drawFPSText() {
     std::ostringstream fps_stream;
 	fps_stream << std::fixed << std::setprecision(2) << current_fps;
 	renderText("FPS: " + fps_stream.str(), WINDOW_WIDTH_PX * .89f, WINDOW_HEIGHT_PX * .9625f, .35f, vec3(1.f, 1.f, 1.f));
+
+	// binds of the previous frame, this one is still being drawn
+	std::ostringstream binds_stream;
+	binds_stream << "prog " << last_frame_stats.program_binds
+				 << " tex " << last_frame_stats.texture_binds
+				 << " buf " << last_frame_stats.buffer_binds
+				 << " draws " << last_frame_stats.draw_calls
+				 << " up " << last_frame_stats.upload_bytes / 1024 << "k";
+	renderText(binds_stream.str(), WINDOW_WIDTH_PX * .79f, WINDOW_HEIGHT_PX * .9325f, .3f, vec3(1.f, 1.f, 1.f));
+
+	std::ostringstream cull_stream;
+	cull_stream << "visible " << cull_stats.visible << " culled " << cull_stats.culled << " particles " << cull_stats.particles;
+	renderText(cull_stream.str(), WINDOW_WIDTH_PX * .79f, WINDOW_HEIGHT_PX * .9025f, .3f, vec3(1.f, 1.f, 1.f));
+
+	std::ostringstream particle_stream;
+	particle_stream << "live " << particle_stats.live
+					<< " +" << particle_stats.spawned
+					<< " -" << particle_stats.expired
+					<< " evict " << particle_stats.evicted
+					<< " drop " << particle_stats.dropped;
+	renderText(particle_stream.str(), WINDOW_WIDTH_PX * .79f, WINDOW_HEIGHT_PX * .8725f, .3f, vec3(1.f, 1.f, 1.f));
+
+	// reused / newly built since the run started
+	int projectile_hits = 0;
+	int projectile_misses = 0;
+	for (const EntityPool &pool : projectile_pools)
+	{
+		projectile_hits += pool.hits;
+		projectile_misses += pool.misses;
+	}
+	std::ostringstream pool_stream;
+	pool_stream << "pool proj " << projectile_hits << "/" << projectile_misses
+				<< " fx " << effect_pool.hits << "/" << effect_pool.misses
+				<< " bullets " << enemy_bullets.size();
+	renderText(pool_stream.str(), WINDOW_WIDTH_PX * .79f, WINDOW_HEIGHT_PX * .8425f, .3f, vec3(1.f, 1.f, 1.f));
 }
 
 mat3 RenderSystem::createProjectionMatrix()
@@ -717,26 +809,11 @@ void RenderSystem::drawScreenAndButtons(
 		ScreenType screenType,
 		const std::vector<ButtonType> &buttonTypes)
 {
-    glBindVertexArray(default_vao);
-    gl_has_errors();
-
-	int w, h;
-	glfwGetFramebufferSize(window, &w, &h);
-	glBindFramebuffer(GL_FRAMEBUFFER, frame_buffer);
-	gl_has_errors();
-
-	glViewport(0, 0, w, h);
-	glDepthRange(0.00001, 10);
-
-	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-	glClearDepth(10.f);
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-	glDisable(GL_DEPTH_TEST);
+	const ivec2 size = framebufferSize();
+	commands.beginPass(frame_buffer, size.x, size.y, vec4(0.f, 0.f, 0.f, 1.f), 10.f, 0.00001f, 10.f);
+	commands.setBlend(true);
 
-	gl_has_errors();
 
 	mat3 projection_matrix = createProjectionMatrix();
 
@@ -797,6 +874,7 @@ void RenderSystem::drawScreenAndButtons(
 		}
 
         drawShopText();
+        drawTextBatch();
 	}
 
 	if (screenType == ScreenType::INFO) {
@@ -809,6 +887,8 @@ void RenderSystem::drawScreenAndButtons(
 			}
 		}
 		drawInfoText();
+		// the buttons go over the text
+		drawTextBatch();
 	}
 
 	if (buttonTypes.size() != 0)
@@ -832,29 +912,15 @@ void RenderSystem::drawScreenAndButtons(
 	}
 
 	drawToScreen();
-	glfwSwapBuffers(window);
-	gl_has_errors();
+	swapBuffers();
 }
 
 void RenderSystem::drawCutScreneAnimation()
 {
-	int w, h;
-	glfwGetFramebufferSize(window, &w, &h);
-	glBindFramebuffer(GL_FRAMEBUFFER, frame_buffer);
-	gl_has_errors();
-
-	glViewport(0, 0, w, h);
-	glDepthRange(0.00001, 10);
-
-	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-	glClearDepth(10.f);
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	const ivec2 size = framebufferSize();
+	commands.beginPass(frame_buffer, size.x, size.y, vec4(0.f, 0.f, 0.f, 1.f), 10.f, 0.00001f, 10.f);
+	commands.setBlend(true);
 
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-	glDisable(GL_DEPTH_TEST);
-
-	gl_has_errors();
 
 	mat3 projection_matrix = createProjectionMatrix();
 
@@ -864,8 +930,7 @@ void RenderSystem::drawCutScreneAnimation()
 	}
 
 	drawToScreen();
-	glfwSwapBuffers(window);
-	gl_has_errors();
+	swapBuffers();
 }
 
 void RenderSystem::drawUI(Entity entity, const mat3 &projection)
@@ -879,47 +944,19 @@ void RenderSystem::drawUI(Entity entity, const mat3 &projection)
 	const RenderRequest &render_request = registry.renderRequests.get(entity);
 
 	GLuint program = effects[(GLuint)render_request.used_effect];
-	glUseProgram(program);
-	gl_has_errors();
-
-	GLuint vbo = vertex_buffers[(GLuint)render_request.used_geometry];
-	GLuint ibo = index_buffers[(GLuint)render_request.used_geometry];
-
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
-	gl_has_errors();
-
-	GLint in_position_loc = glGetAttribLocation(program, "in_position");
-	GLint in_texcoord_loc = glGetAttribLocation(program, "in_texcoord");
-	glEnableVertexAttribArray(in_position_loc);
-	glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex), (void *)0);
-	glEnableVertexAttribArray(in_texcoord_loc);
-	glVertexAttribPointer(in_texcoord_loc, 2, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex), (void *)sizeof(vec3));
-
-	glActiveTexture(GL_TEXTURE0);
-	GLuint texture_id = texture_gl_handles[(GLuint)registry.renderRequests.get(entity).used_texture];
-	glBindTexture(GL_TEXTURE_2D, texture_id);
-	gl_has_errors();
-
-	GLuint transform_loc = glGetUniformLocation(program, "transform");
-	glUniformMatrix3fv(transform_loc, 1, GL_FALSE, (float *)&transform.mat);
-	gl_has_errors();
-
-	GLuint projection_loc = glGetUniformLocation(program, "projection");
-	glUniformMatrix3fv(projection_loc, 1, GL_FALSE, (float *)&projection);
-	gl_has_errors();
-
-	GLint size = 0;
-	glGetBufferParameteriv(GL_ELEMENT_ARRAY_BUFFER, GL_BUFFER_SIZE, &size);
-	GLsizei num_indices = size / sizeof(uint16_t);
-	glDrawElements(GL_TRIANGLES, num_indices, GL_UNSIGNED_SHORT, nullptr);
-	gl_has_errors();
+	useProgram(program);
+	bindMesh(render_request.used_effect, render_request.used_geometry);
+	bindTexture(texture_gl_handles[(GLuint)render_request.used_texture]);
+
+	const EffectReflection &effect_reflection = reflection(render_request.used_effect);
+	commands.setUniform(effect_reflection[UNIFORM_ID::TRANSFORM], transform.mat);
+	commands.setUniform(effect_reflection[UNIFORM_ID::PROJECTION], projection);
+
+	commands.drawElements(index_counts[(GLuint)render_request.used_geometry]);
 }
 
 void RenderSystem::drawUIElements()
 {
-    glBindVertexArray(default_vao);
-    gl_has_errors();
 
 	if (registry.uiElements.size() == 0)
 		return;
@@ -932,13 +969,11 @@ void RenderSystem::drawUIElements()
 	}
 
 	drawToScreen();
-	glfwSwapBuffers(window);
+	swapBuffers();
 }
 
 void RenderSystem::drawHexagon(Entity entity, const mat3 &projection)
 {
-    glBindVertexArray(default_vao);
-    gl_has_errors();
 
 	if (!registry.keys.has(entity) && !registry.chests.has(entity))
 	{
@@ -952,30 +987,9 @@ void RenderSystem::drawHexagon(Entity entity, const mat3 &projection)
 
 	RenderRequest &render_request = registry.renderRequests.get(entity);
 	GLuint program = effects[(GLuint)render_request.used_effect];
-	glUseProgram(program);
-	gl_has_errors();
-
-	GLuint vbo = vertex_buffers[(GLuint)render_request.used_geometry];
-	GLuint ibo = index_buffers[(GLuint)render_request.used_geometry];
-
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
-	gl_has_errors();
-
-	GLint in_position_loc = glGetAttribLocation(program, "in_position");
-	GLint in_texcoord_loc = glGetAttribLocation(program, "in_texcoord");
-
-	glEnableVertexAttribArray(in_position_loc);
-	glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex), (void *)0);
-
-	glEnableVertexAttribArray(in_texcoord_loc);
-	glVertexAttribPointer(in_texcoord_loc, 2, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex), (void *)sizeof(vec3));
-	gl_has_errors();
-
-	glActiveTexture(GL_TEXTURE0);
-	GLuint texture_id = texture_gl_handles[(GLuint)render_request.used_texture];
-	glBindTexture(GL_TEXTURE_2D, texture_id);
-	gl_has_errors();
+	useProgram(program);
+	bindMesh(render_request.used_effect, render_request.used_geometry);
+	bindTexture(texture_gl_handles[(GLuint)render_request.used_texture]);
 
 	if (!registry.motions.has(entity))
 	{
@@ -988,24 +1002,15 @@ void RenderSystem::drawHexagon(Entity entity, const mat3 &projection)
 	transform.translate(motion.position);
 	transform.scale(motion.scale);
 
-	GLuint transform_loc = glGetUniformLocation(program, "transform");
-	glUniformMatrix3fv(transform_loc, 1, GL_FALSE, (float *)&transform.mat);
-	gl_has_errors();
+	const EffectReflection &effect_reflection = reflection(render_request.used_effect);
+	commands.setUniform(effect_reflection[UNIFORM_ID::TRANSFORM], transform.mat);
+	commands.setUniform(effect_reflection[UNIFORM_ID::PROJECTION], projection);
 
-	GLuint projection_loc = glGetUniformLocation(program, "projection");
-	glUniformMatrix3fv(projection_loc, 1, GL_FALSE, (float *)&projection);
-	gl_has_errors();
-
-	GLint size = 0;
-	glGetBufferParameteriv(GL_ELEMENT_ARRAY_BUFFER, GL_BUFFER_SIZE, &size);
-	GLsizei num_indices = size / sizeof(uint16_t);
-	glDrawElements(GL_TRIANGLES, num_indices, GL_UNSIGNED_SHORT, nullptr);
+	commands.drawElements(index_counts[(GLuint)render_request.used_geometry]);
 }
 
 void RenderSystem::drawDashRecharge(const mat3 &projection)
 {
-    glBindVertexArray(default_vao);
-    gl_has_errors();
 
 	if (registry.dashes.size() == 0)
 	{
@@ -1032,49 +1037,20 @@ void RenderSystem::drawDashRecharge(const mat3 &projection)
 		const RenderRequest &render_request = registry.renderRequests.get(entity);
 		GLuint program = effects[(GLuint)render_request.used_effect];
 
-		glUseProgram(program);
-		gl_has_errors();
-
-		GLuint vbo = vertex_buffers[(GLuint)render_request.used_geometry];
-		GLuint ibo = index_buffers[(GLuint)render_request.used_geometry];
+		useProgram(program);
+		bindMesh(render_request.used_effect, render_request.used_geometry);
+		bindTexture(texture_gl_handles[(GLuint)render_request.used_texture]);
 
-		glBindBuffer(GL_ARRAY_BUFFER, vbo);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
-		gl_has_errors();
+		const EffectReflection &effect_reflection = reflection(render_request.used_effect);
+		commands.setUniform(effect_reflection[UNIFORM_ID::TRANSFORM], transform.mat);
+		commands.setUniform(effect_reflection[UNIFORM_ID::PROJECTION], projection);
 
-		GLint in_position_loc = glGetAttribLocation(program, "in_position");
-		GLint in_texcoord_loc = glGetAttribLocation(program, "in_texcoord");
-
-		glEnableVertexAttribArray(in_position_loc);
-		glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex), (void *)0);
-		glEnableVertexAttribArray(in_texcoord_loc);
-		glVertexAttribPointer(in_texcoord_loc, 2, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex), (void *)sizeof(vec3));
-
-		glActiveTexture(GL_TEXTURE0);
-		GLuint texture_id = texture_gl_handles[(GLuint)render_request.used_texture];
-		glBindTexture(GL_TEXTURE_2D, texture_id);
-		gl_has_errors();
-
-		GLint transform_loc = glGetUniformLocation(program, "transform");
-		glUniformMatrix3fv(transform_loc, 1, GL_FALSE, (float *)&transform.mat);
-		gl_has_errors();
-
-		GLint projection_loc = glGetUniformLocation(program, "projection");
-		glUniformMatrix3fv(projection_loc, 1, GL_FALSE, (float *)&projection);
-		gl_has_errors();
-
-		GLint size = 0;
-		glGetBufferParameteriv(GL_ELEMENT_ARRAY_BUFFER, GL_BUFFER_SIZE, &size);
-		GLsizei num_indices = size / sizeof(uint16_t);
-		glDrawElements(GL_TRIANGLES, num_indices, GL_UNSIGNED_SHORT, nullptr);
-		gl_has_errors();
+		commands.drawElements(index_counts[(GLuint)render_request.used_geometry]);
 	}
 }
 
 void RenderSystem::drawBuffUI()
 {
-    glBindVertexArray(default_vao);
-    gl_has_errors();
 
 	if (registry.buffUIs.size() == 0)
 		return;
@@ -1087,306 +1063,262 @@ void RenderSystem::drawBuffUI()
 	}
 
 	drawToScreen();
-	glfwSwapBuffers(window);
+	swapBuffers();
 }
 
 // M3 Feature : Instance Rendering on Particles
 // INSTANCING: Draw instanced particles
 void RenderSystem::drawInstancedParticles()
 {
-    drawParticlesByTexture(TEXTURE_ASSET_ID::DEATH_PARTICLE);
-    drawParticlesByTexture(TEXTURE_ASSET_ID::PIXEL_PARTICLE);
+    cull_stats.particles = 0;
+    drawParticlesByTexture(PARTICLE_TYPE::DEATH_PARTICLE, TEXTURE_ASSET_ID::DEATH_PARTICLE);
+    drawParticlesByTexture(PARTICLE_TYPE::RIPPLE_PARTICLE, TEXTURE_ASSET_ID::PIXEL_PARTICLE);
 }
 
-void RenderSystem::drawParticlesByTexture(TEXTURE_ASSET_ID texture_id)
+void RenderSystem::drawParticlesByTexture(PARTICLE_TYPE type, TEXTURE_ASSET_ID texture_id)
 {
-    glBindVertexArray(default_vao);
-    gl_has_errors();
-    
-	// for debugging purposes, check for errors
-	while (glGetError() != GL_NO_ERROR)
-	{ /* clear errors */
-	}
-
-    if (registry.particles.size() == 0)
+    const ParticleBucket &bucket = particle_pool.bucket(type);
+    if (bucket.size() == 0)
         return;
     
-    std::vector<mat3> instanceTransforms;
-	std::vector<float> instanceAlphas;
+    particle_transforms.clear();
+    particle_alphas.clear();
 	
-    for (uint i = 0; i < registry.particles.size(); i++)
+    // particles are never rotated, so the transform is only a scale and a translation
+    for (int i = 0; i < bucket.size(); i++)
     {
-        Entity entity = registry.particles.entities[i];
-		
-		if (registry.renderRequests.has(entity)) {
-            RenderRequest& request = registry.renderRequests.get(entity);
-            if (request.used_texture != texture_id) {
-                continue;
-            }
-        } else {
-            continue; 
-        }
+        const vec2 position = {bucket.position_x[i], bucket.position_y[i]};
+        const vec2 scale = {bucket.scale_x[i], bucket.scale_y[i]};
+        const vec2 half = abs(scale) * 0.5f;
+        if (position.x + half.x < view_min.x || position.x - half.x > view_max.x ||
+            position.y + half.y < view_min.y || position.y - half.y > view_max.y)
+            continue;
 
-        Motion &motion = registry.motions.get(entity);
-        Transform transform;
-        transform.translate(motion.position);
-        transform.scale(motion.scale);
-        transform.rotate(radians(motion.angle));
-        instanceTransforms.push_back(transform.mat);
-
-		float alpha = 1.0f;
-        if (registry.particles.has(entity)) {
-            Particle& particle = registry.particles.get(entity);
-            if (particle.type == PARTICLE_TYPE::RIPPLE_PARTICLE) {
-                alpha = particle.lifetime_ms / particle.max_lifetime_ms;
-            }
-        }
-        instanceAlphas.push_back(alpha);
+        particle_transforms.push_back(mat3({scale.x, 0.f, 0.f}, {0.f, scale.y, 0.f}, {position.x, position.y, 1.f}));
+
+        particle_alphas.push_back(bucket.alpha[i]);
     }
     
-	// for debugging purposes
-    // std::cout << "[Particle Debug] Instance transforms count: " << instanceTransforms.size() << std::endl;
-		
-    if (instanceTransforms.empty())
+    if (particle_transforms.empty())
         return;
+    cull_stats.particles += (int)particle_transforms.size();
     
-    // bind the default VAO
-    glBindVertexArray(default_vao);
+    // use the particle shader and the sprite geometry VAO, its instance attributes are already enabled
+    const GLuint program = effects[(uint)EFFECT_ASSET_ID::PARTICLE_EFFECT];
+    useProgram(program);
+    bindMesh(EFFECT_ASSET_ID::PARTICLE_EFFECT, GEOMETRY_BUFFER_ID::SPRITE);
     
-    // bind the sprite geometry (base VBO) for particles
-    glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers[(uint)GEOMETRY_BUFFER_ID::SPRITE]);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffers[(uint)GEOMETRY_BUFFER_ID::SPRITE]);
-    // set base vertex attrib pointers expected by particle_textured.vs.glsl:
-    glEnableVertexAttribArray(0); // in_position
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex), (void*)0);
-    glEnableVertexAttribArray(1); // in_texcoord
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex), (void*)sizeof(vec3));
+    //  stream the transforms and alphas, both live in the instance stream
+    int transforms_slot = commands.uploadStream(particle_transforms.data(), particle_transforms.size() * sizeof(mat3));
+    int alphas_slot = commands.uploadStream(particle_alphas.data(), particle_alphas.size() * sizeof(float));
     
-    //  bind the instance VBO and update it
-    glBindBuffer(GL_ARRAY_BUFFER, particle_instance_vbo);
-    glBufferData(GL_ARRAY_BUFFER, instanceTransforms.size() * sizeof(mat3),
-                 instanceTransforms.data(), GL_DYNAMIC_DRAW);
-    
-    // setup instanced vertex attrib pointers for the mat3 (at locations 2, 3, and 4.)
+    // point the instanced mat3 (at locations 2, 3, and 4.) and the alpha (5) at this frame's data
     for (int i = 0; i < 3; i++) {
         GLuint attrib_location = 2 + i;
-        glEnableVertexAttribArray(attrib_location);
-        glVertexAttribPointer(attrib_location, 3, GL_FLOAT, GL_FALSE,
-                              sizeof(mat3), (void*)(sizeof(vec3) * i));
-        glVertexAttribDivisor(attrib_location, 1); // advance once per instance (super IMPORTANTT)
+        commands.streamAttribPointer(attrib_location, 3, sizeof(mat3), sizeof(vec3) * i, transforms_slot);
     }
-
-    GLuint alpha_vbo;
-    glGenBuffers(1, &alpha_vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, alpha_vbo);
-    glBufferData(GL_ARRAY_BUFFER, instanceAlphas.size() * sizeof(float),
-                 instanceAlphas.data(), GL_DYNAMIC_DRAW);
-    glEnableVertexAttribArray(5);
-    glVertexAttribPointer(5, 1, GL_FLOAT, GL_FALSE, sizeof(float), (void*)0);
-    glVertexAttribDivisor(5, 1); 
+    commands.streamAttribPointer(5, 1, sizeof(float), 0, alphas_slot);
     
-    glActiveTexture(GL_TEXTURE0);
-	GLuint gl_texture_id = texture_gl_handles[(uint)texture_id];
-    glBindTexture(GL_TEXTURE_2D, gl_texture_id);
-    
-    // use the particle shader
-    glUseProgram(effects[(uint)EFFECT_ASSET_ID::PARTICLE_EFFECT]);
+    bindTexture(texture_gl_handles[(uint)texture_id]);
     
     mat3 projection = createProjectionMatrix();
-    GLuint proj_loc = glGetUniformLocation(effects[(uint)EFFECT_ASSET_ID::PARTICLE_EFFECT], "projection");
-    glUniformMatrix3fv(proj_loc, 1, GL_FALSE, (float *)&projection);
+    commands.setUniform(reflection(EFFECT_ASSET_ID::PARTICLE_EFFECT)[UNIFORM_ID::PROJECTION], projection);
     
     // ise the stored sprite_index_count
     GLsizei num_indices = sprite_index_count;
     
 	// draw the instanced particles as a set
-	glDrawElementsInstanced(GL_TRIANGLES, num_indices,
-													GL_UNSIGNED_SHORT, nullptr, instanceTransforms.size());
+	commands.drawElements(num_indices, (GLsizei)particle_transforms.size());
+}
 
-	// disable instanced attributes
-	for (int i = 0; i < 3; i++)
-	{
-		glDisableVertexAttribArray(2 + i);
-	}
+bool RenderSystem::isBatchableSprite(Entity entity) const
+{
+	const RenderRequest &request = registry.renderRequests.get(entity);
+	if (request.used_geometry != GEOMETRY_BUFFER_ID::SPRITE)
+		return false;
+	// sprites without a motion have no transform of their own
+	if (!registry.motions.has(entity))
+		return false;
+	if (request.used_effect == EFFECT_ASSET_ID::TEXTURED)
+		return true;
+	return request.used_effect == EFFECT_ASSET_ID::SPRITE_SHEET && registry.spriteSheetImages.has(entity);
+}
+
+SpriteInstance RenderSystem::spriteInstance(Entity entity) const
+{
+	// same transform order as drawTexturedMesh
+	const Motion &motion = registry.motions.get(entity);
+	Transform transform;
+	transform.translate(motion.position);
+	transform.scale(motion.scale);
+	transform.rotate(radians(motion.angle));
 
-	// for debugging purposes, check for errors
-	while (glGetError() != GL_NO_ERROR)
-	{ /* clear any errors */
+	SpriteInstance instance;
+	instance.transform = transform.mat;
+	instance.frame = {1.f, 0.f};
+	if (registry.renderRequests.get(entity).used_effect == EFFECT_ASSET_ID::SPRITE_SHEET)
+	{
+		const SpriteSheetImage &sprite_sheet = registry.spriteSheetImages.get(entity);
+		instance.frame = {float(sprite_sheet.total_frames), float(sprite_sheet.current_frame)};
 	}
+	instance.tint = registry.colors.has(entity) ? registry.colors.get(entity) : vec3(1);
+
+	const TEXTURE_ASSET_ID texture_id = registry.renderRequests.get(entity).used_texture;
+	if (texture_atlas_rects[(GLuint)texture_id].page >= 0)
+		instance.uv_rect = texture_atlas_uvs[(GLuint)texture_id];
+	else
+		instance.uv_rect = {0.f, 0.f, 1.f, 1.f};
+	return instance;
 }
 
-// Structure for tile instance data (put here so it is visible to the shader for later changes)
-struct TileInstance
+GLuint RenderSystem::spriteBatchTexture(TEXTURE_ASSET_ID texture_id) const
 {
-	mat3 transform;
-	vec4 params; // x: total_frames, y: current_frame, z: sprite_width, w: sprite_height
-};
+	const AtlasRect &rect = texture_atlas_rects[(GLuint)texture_id];
+	if (rect.page >= 0)
+		return atlas_pages[rect.page];
+	return texture_gl_handles[(GLuint)texture_id];
+}
 
-void RenderSystem::drawInstancedTiles(const mat3 &projection)
+// INSTANCING: draw the sprites staged in sprite_instances with one instanced call
+void RenderSystem::drawSpriteBatch(GLuint texture, const mat3 &projection)
 {
-    glBindVertexArray(default_vao);
-    gl_has_errors();
+	if (sprite_instances.empty())
+		return;
 
-	// group tile instances by texture used.
-	std::unordered_map<GLuint, std::vector<TileInstance>> groups;
+	const GLuint program = effects[(GLuint)EFFECT_ASSET_ID::SPRITE_INSTANCED];
+	useProgram(program);
+	bindMesh(EFFECT_ASSET_ID::SPRITE_INSTANCED, GEOMETRY_BUFFER_ID::SPRITE);
+	bindTexture(texture);
 
-	for (Entity entity : registry.tiles.entities)
+	const int slot = commands.uploadStream(sprite_instances.data(), sprite_instances.size() * sizeof(SpriteInstance));
+
+	// transform at locations 2, 3, 4, frame at 5, tint at 6, uv rect at 7, enabled in the VAO
+	for (int i = 0; i < 3; i++)
 	{
-		if (!registry.motions.has(entity) ||
-				!registry.renderRequests.has(entity) ||
-				!registry.spriteSheetImages.has(entity) ||
-				!registry.spritesSizes.has(entity))
-			continue;
-		RenderRequest &req = registry.renderRequests.get(entity);
-		if (req.used_effect != EFFECT_ASSET_ID::TILE)
-			continue;
-		//build instance transform from motion.
-		Motion &motion = registry.motions.get(entity);
-		Transform transform;
-		transform.translate(motion.position);
-		transform.scale(motion.scale);
-		transform.rotate(radians(motion.angle));
+		GLuint attrib_location = 2 + i;
+		commands.streamAttribPointer(attrib_location, 3, sizeof(SpriteInstance), offsetof(SpriteInstance, transform) + sizeof(vec3) * i, slot);
+	}
+	commands.streamAttribPointer(5, 2, sizeof(SpriteInstance), offsetof(SpriteInstance, frame), slot);
+	commands.streamAttribPointer(6, 3, sizeof(SpriteInstance), offsetof(SpriteInstance, tint), slot);
+	commands.streamAttribPointer(7, 4, sizeof(SpriteInstance), offsetof(SpriteInstance, uv_rect), slot);
 
-		SpriteSheetImage &spriteSheet = registry.spriteSheetImages.get(entity);
-		SpriteSize &sprite = registry.spritesSizes.get(entity);
-
-		TileInstance instance;
-		instance.transform = transform.mat;
-		instance.params = {float(spriteSheet.total_frames),
-											 float(spriteSheet.current_frame),
-											 float(sprite.width),
-											 float(sprite.height)};
-		GLuint texture = texture_gl_handles[(uint)req.used_texture];
-		groups[texture].push_back(instance);
+	commands.setUniform(reflection(EFFECT_ASSET_ID::SPRITE_INSTANCED)[UNIFORM_ID::PROJECTION], projection);
+
+	commands.drawElements(sprite_index_count, (GLsizei)sprite_instances.size());
+}
+
+void RenderSystem::drawBullets(const mat3 &projection)
+{
+	for (int k = 0; k < bullet_kind_count; k++)
+	{
+		const TEXTURE_ASSET_ID texture_id = enemy_bullets.kinds[k].texture;
+		vec4 uv_rect = {0.f, 0.f, 1.f, 1.f};
+		if (texture_atlas_rects[(GLuint)texture_id].page >= 0)
+			uv_rect = texture_atlas_uvs[(GLuint)texture_id];
+
+		// bullets are never rotated either, see drawParticlesByTexture
+		sprite_instances.clear();
+		for (int i = 0; i < enemy_bullets.size(); i++)
+		{
+			if ((int)enemy_bullets.kind[i] != k)
+				continue;
+			const vec2 position = {enemy_bullets.position_x[i], enemy_bullets.position_y[i]};
+			const vec2 scale = {enemy_bullets.scale_x[i], enemy_bullets.scale_y[i]};
+			const vec2 half = abs(scale) * 0.5f;
+			if (position.x + half.x < view_min.x || position.x - half.x > view_max.x ||
+				position.y + half.y < view_min.y || position.y - half.y > view_max.y)
+				continue;
+
+			SpriteInstance instance;
+			instance.transform = mat3({scale.x, 0.f, 0.f}, {0.f, scale.y, 0.f}, {position.x, position.y, 1.f});
+			instance.frame = {1.f, 0.f};
+			instance.tint = vec3(1);
+			instance.uv_rect = uv_rect;
+			sprite_instances.push_back(instance);
+		}
+		drawSpriteBatch(spriteBatchTexture(texture_id), projection);
 	}
+}
+
+void RenderSystem::drawInstancedTiles(const mat3 &projection)
+{
 
-	// for each texture group, render the batch 
-	for (auto &group : groups)
+	if (tile_layer.needsRebuild())
+		tile_layer.rebuild(commands);
+	tile_layer.updateAnimated(commands);
+
+	// only the rows inside the view are drawn
+	Camera &camera = registry.cameras.get(registry.cameras.entities[0]);
+	const float view_top = camera.position.y - WINDOW_HEIGHT_PX * 0.5f;
+	const float view_bottom = view_top + WINDOW_HEIGHT_PX;
+
+	GLuint program = effects[(uint)EFFECT_ASSET_ID::TILE];
+	const EffectReflection &tile_reflection = reflection(EFFECT_ASSET_ID::TILE);
+	for (const TileBatch &batch : tile_layer.batches())
 	{
-		GLuint texture = group.first;
-		std::vector<TileInstance> &instances = group.second;
-		if (instances.empty())
+		GLint first;
+		GLsizei count;
+		tile_layer.visibleRange(batch, view_top, view_bottom, first, count);
+		if (count == 0)
 			continue;
 
-		GLuint program = effects[(uint)EFFECT_ASSET_ID::TILE];
-		glUseProgram(program);
-		gl_has_errors();
-
-		// bind common geometry buffer
-		GLuint vbo = vertex_buffers[(uint)GEOMETRY_BUFFER_ID::SPRITE];
-		GLuint ibo = index_buffers[(uint)GEOMETRY_BUFFER_ID::SPRITE];
-		glBindBuffer(GL_ARRAY_BUFFER, vbo);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+		useProgram(program);
 
-		// aet up base vertex attribute pointers
-		GLint in_position_loc = glGetAttribLocation(program, "in_position");
-		GLint in_texcoord_loc = glGetAttribLocation(program, "in_texcoord");
-		glEnableVertexAttribArray(in_position_loc);
-		glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex), (void *)0);
-		glEnableVertexAttribArray(in_texcoord_loc);
-		glVertexAttribPointer(in_texcoord_loc, 2, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex), (void *)sizeof(vec3));
+		// the VAO has the sprite quad and the instance attributes enabled
+		bindMesh(EFFECT_ASSET_ID::TILE, GEOMETRY_BUFFER_ID::SPRITE);
 
-		// bindd and update tile instance VB
-		glBindBuffer(GL_ARRAY_BUFFER, tile_instance_vbo);
-		glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(TileInstance), instances.data(), GL_DYNAMIC_DRAW);
+		// GL 3.3 has no base instance, start the instance attributes at the first visible tile instead
+		const GLintptr base = first * sizeof(TileInstance);
 
 		// aetup instance attributes for the matrix (locations 2, 3, 4)
 		for (int i = 0; i < 3; i++)
 		{
 			GLuint attrib_location = 2 + i;
-			glEnableVertexAttribArray(attrib_location);
-			glVertexAttribPointer(attrib_location, 3, GL_FLOAT, GL_FALSE, sizeof(TileInstance), (void *)(sizeof(vec3) * i));
-			glVertexAttribDivisor(attrib_location, 1); // one per instance
+			commands.attribPointer(attrib_location, 3, sizeof(TileInstance), base + sizeof(vec3) * i, tile_layer.buffer());
 		}
 		// aetup instance attribute for tile parameters at location 5
 		GLuint tile_params_loc = 5;
-		glEnableVertexAttribArray(tile_params_loc);
-		glVertexAttribPointer(tile_params_loc, 4, GL_FLOAT, GL_FALSE, sizeof(TileInstance), (void *)sizeof(mat3));
-		glVertexAttribDivisor(tile_params_loc, 1);
+		commands.attribPointer(tile_params_loc, 4, sizeof(TileInstance), base + offsetof(TileInstance, params), tile_layer.buffer());
 
 		// set shader uniforms.
-		glUniformMatrix3fv(glGetUniformLocation(program, "projection"), 1, GL_FALSE, (float *)&projection);
-		Camera &camera = registry.cameras.get(registry.cameras.entities[0]);
-		glUniform2fv(glGetUniformLocation(program, "camera_position"), 1, (float *)&camera.position);
+		commands.setUniform(tile_reflection[UNIFORM_ID::PROJECTION], projection);
+		commands.setUniform(tile_reflection[UNIFORM_ID::CAMERA_POSITION], camera.position);
 
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, texture);
-		glUniform1i(glGetUniformLocation(program, "sampler0"), 0);
+		bindTexture(texture_gl_handles[(uint)batch.texture]);
+		commands.setUniform(tile_reflection[UNIFORM_ID::SAMPLER0], 0);
 
 		// draw instanced
-		GLint iboSize = 0;
-		glGetBufferParameteriv(GL_ELEMENT_ARRAY_BUFFER, GL_BUFFER_SIZE, &iboSize);
-		GLsizei num_indices = iboSize / sizeof(uint16_t);
-		glDrawElementsInstanced(GL_TRIANGLES, num_indices, GL_UNSIGNED_SHORT, nullptr, instances.size());
-		gl_has_errors();
-
-		// dsable instanced attributes
-		for (int i = 2; i <= 5; i++)
-		{
-			glDisableVertexAttribArray(i);
-		}
+		commands.drawElements(sprite_index_count, count);
 	}
 }
 
-void RenderSystem::renderText(std::string text, float x, float y, float scale, const glm::vec3& color)
+void RenderSystem::renderText(const std::string& text, float x, float y, float scale, const glm::vec3& color)
 {
-    glm::mat4 trans = glm::mat4(1.0f);
+    glyph_atlas.append(text, x, y, scale, color, text_vertices);
+}
+
+void RenderSystem::drawTextBatch()
+{
+    if (text_vertices.empty())
+        return;
 
     // ENABLE BLENDING
-    glEnable(GL_BLEND);
+    commands.setBlend(true);
 
     // activate corresponding render state
-    glUseProgram(m_font_shaderProgram);
-
-    GLint textColor_location = glGetUniformLocation(m_font_shaderProgram, "textColor");
-    assert(textColor_location > -1);
-    // std::cout << "textColor_location: " << textColor_location << std::endl;
-    glUniform3f(textColor_location, color.x, color.y, color.z);
-
-    auto transformLoc = glGetUniformLocation(m_font_shaderProgram, "transform");
-    // std::cout << "transformLoc: " << transformLoc << std::endl;
-    assert(transformLoc > -1);
-    glUniformMatrix4fv(transformLoc, 1, GL_FALSE, glm::value_ptr(trans));
-
-    glBindVertexArray(m_font_VAO);
+    useProgram(m_font_shaderProgram);
+    assert(font_reflection[UNIFORM_ID::TRANSFORM].location > -1);
+    commands.setUniform(font_reflection[UNIFORM_ID::TRANSFORM], glm::mat4(1.0f));
 
-    // iterate through each character
-    std::string::const_iterator c;
-    for (c = text.begin(); c != text.end(); c++)
-    {
-        Character ch = m_ftCharacters[*c];
-
-        float xpos = x + ch.Bearing.x * scale;
-        float ypos = y - (ch.Size.y - ch.Bearing.y) * scale;
-
-        float w = ch.Size.x * scale;
-        float h = ch.Size.y * scale;
-
-        float vertices[6][4] = {
-            { xpos,     ypos + h,   0.0f, 0.0f },
-            { xpos,     ypos,       0.0f, 1.0f },
-            { xpos + w, ypos,       1.0f, 1.0f },
+    bindVertexArray(m_font_VAO);
+    bindTexture(glyph_atlas.texture());
 
-            { xpos,     ypos + h,   0.0f, 0.0f },
-            { xpos + w, ypos,       1.0f, 1.0f },
-            { xpos + w, ypos + h,   1.0f, 0.0f }
-        };
+    // every string of the frame in one upload and one draw
+    const int slot = commands.uploadStream(text_vertices.data(), text_vertices.size() * sizeof(TextVertex));
+    commands.streamAttribPointer(0, 4, sizeof(TextVertex), offsetof(TextVertex, position), slot);
+    commands.streamAttribPointer(1, 3, sizeof(TextVertex), offsetof(TextVertex, color), slot);
 
-        // render glyph texture over quad
-        glBindTexture(GL_TEXTURE_2D, ch.TextureID);
-        // std::cout << "binding texture: " << ch.character << " = " << ch.TextureID << std::endl;
+    commands.drawArrays((GLsizei)text_vertices.size());
 
-        // update content of VBO memory
-        glBindBuffer(GL_ARRAY_BUFFER, m_font_VBO);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-        // render quad
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-
-        // advance to next glyph (note that advance is number of 1/64 pixels)
-        x += (ch.Advance >> 6) * scale; // bitshift by 6 to get value in pixels (2^6 = 64)
-    }
-    glBindVertexArray(0);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    text_vertices.clear();
 }
\ No newline at end of file
@@ -4,22 +4,36 @@
 #include <utility>
 
 #include "common.hpp"
+#include "effect_reflection.hpp"
+#include "glyph_atlas.hpp"
+#include "particle_pool.hpp"
+#include "render_queue.hpp"
+#include "texture_atlas.hpp"
+#include "render_backend.hpp"
+#include "tile_layer.hpp"
+#include "visibility_grid.hpp"
 #include "tinyECS/components.hpp"
 #include "tinyECS/tiny_ecs.hpp"
 
 // fonts
-#include <ft2build.h>
-#include FT_FREETYPE_H
 #include <map>
 #include <glm/gtc/type_ptr.hpp>
 
-// fonts
-struct Character {
-	unsigned int TextureID;  // ID handle of the glyph texture
-	glm::ivec2   Size;       // Size of glyph
-	glm::ivec2   Bearing;    // Offset from baseline to left/top of glyph
-	unsigned int Advance;    // Offset to advance to next glyph
-	char character;
+// Result of the last culling pass in draw(), only entities that can be culled are counted
+struct CullStats
+{
+	int visible = 0;
+	int culled = 0;
+	int particles = 0; // drawn out of the pool
+};
+
+// Per-instance data of the sprite batcher, matches the attributes of sprite_instanced.vs.glsl
+struct SpriteInstance
+{
+	mat3 transform;
+	vec2 frame; // x: total_frames, y: current_frame
+	vec3 tint;
+	vec4 uv_rect; // where the texture sits in the bound texture, (u0, v0, u1, v1)
 };
 
 // System responsible for setting up OpenGL and for rendering all the
@@ -36,6 +50,12 @@ class RenderSystem
 	std::array<GLuint, texture_count> texture_gl_handles;
 	std::array<ivec2, texture_count> texture_dimensions;
 
+	// Every texture is also packed into a few atlas pages so the sprite batcher can draw
+	// different textures without rebinding. Rects with page -1 didn't fit and use their own texture.
+	std::vector<GLuint> atlas_pages;
+	std::array<AtlasRect, texture_count> texture_atlas_rects;
+	std::array<vec4, texture_count> texture_atlas_uvs;
+
 	// Make sure these paths remain in sync with the associated enumerators.
 	// Associated id with .obj path
 	// const std::vector<std::pair<GEOMETRY_BUFFER_ID, std::string>> mesh_paths = {
@@ -127,6 +147,8 @@ class RenderSystem
 		textures_path("enemies/finalBoss/brainBoss.png")
 	};
 	std::array<GLuint, effect_count> effects;
+	// uniform and attribute locations of every effect, filled once in initializeGlEffects
+	std::array<EffectReflection, effect_count> effect_reflections;
 	// Make sure these paths remain in sync with the associated enumerators.
 	const std::array<std::string, effect_count> effect_paths = {
 		shader_path("coloured"),
@@ -143,22 +165,33 @@ class RenderSystem
 		shader_path("particle_textured"),
         shader_path("font"),
 		shader_path("thermometer"),
-		shader_path("weapon_cooldown_indicator")
+		shader_path("weapon_cooldown_indicator"),
+		shader_path("sprite_instanced")
 	};
 
 	std::array<GLuint, geometry_count> vertex_buffers;
 	std::array<GLuint, geometry_count> index_buffers;
 	std::array<Mesh, geometry_count> meshes;
+	std::array<GLsizei, geometry_count> index_counts = {};
+
+	// one VAO per effect and geometry with the vertex (and instance) attributes already enabled,
+	// 0 where the effect reads attributes the geometry doesn't have
+	std::array<std::array<GLuint, geometry_count>, effect_count> mesh_vaos = {};
 
 public:
 	// Initialize the window
 	bool init(GLFWwindow *window);
+	// Without a window or GL context, for counting what frames would draw. GL handles are
+	// stand-in names and frames go to the given backend, usually a NullRenderBackend.
+	bool initHeadless(RenderBackend *backend);
 
 	template <class T>
 	void bindVBOandIBO(GEOMETRY_BUFFER_ID gid, std::vector<T> vertices, std::vector<uint16_t> indices);
 
 	void initializeGlTextures();
 
+	void initializeTextureAtlas(const std::array<unsigned char *, texture_count> &pixels);
+
 	void initializeGlEffects();
 
 	void initializeGlMeshes();
@@ -174,6 +207,7 @@ public:
 	};
 
 	void initializeGlGeometryBuffers();
+	void initializeGlVertexArrays();
 	std::vector<TexturedVertex> loadMeshVertices(const std::string &filename);
 
 	// Initialize the screen texture used as intermediate render target
@@ -199,6 +233,7 @@ public:
 	// FPS counter related methods
 	void updateFPS(float elapsed_ms);
 	void toggleFPSDisplay();
+	void setParticleStats(const ParticleStats &stats) { particle_stats = stats; }
 
 	Entity get_screen_state_entity()
 	{
@@ -215,11 +250,13 @@ public:
 
 	// INSTANCING: instanced particle drawing
 	void drawInstancedParticles();
-	void drawParticlesByTexture(TEXTURE_ASSET_ID texture_id);
+	void drawParticlesByTexture(PARTICLE_TYPE type, TEXTURE_ASSET_ID texture_id);
 
 
 	// INSTANCING: instanced tile drawing
 	void drawInstancedTiles(const mat3 &projection);
+	// the map was tiled again, rebuild the cached tile instances
+	void invalidateTileLayer() { tile_layer.invalidate(); }
 
     void drawShopText();
 
@@ -228,14 +265,46 @@ private:
 	void drawTexturedMesh(Entity entity, const mat3 &projection);
 	void drawSpriteSheetTexturedMesh(Entity entity, const mat3 &projection);
 	void drawToScreen();
+	// deletes what init created, the destructor skips it when headless
+	void releaseGlResources();
 
 	void setUpDefaultProgram(Entity &entity, const RenderRequest &render_request, const GLuint program);
-	void setUpSpriteSheetTexture(Entity &entity, const GLuint program);
+	void setUpSpriteSheetTexture(Entity &entity, const EffectReflection &reflection);
+	// uploads the mini map cells changed since the last frame into mini_map_texture
+	void updateMiniMapTexture();
+
+	const EffectReflection &reflection(EFFECT_ASSET_ID id) const { return effect_reflections[(int)id]; }
+
+	// bind through the cache below so consecutive draws with the same state skip the GL calls
+	void useProgram(GLuint program);
+	void bindTexture(GLuint texture);
+	void bindVertexArray(GLuint vao);
+	// the VAO of this effect and geometry
+	void bindMesh(EFFECT_ASSET_ID effect, GEOMETRY_BUFFER_ID geometry);
+	// forget everything bound, for the start of a frame
+	void resetBoundState();
+
+	RENDER_LAYER renderLayer(Entity entity) const;
+	// fills visible_entities for the current camera view
+	void cullWorld();
+
+	// INSTANCING: textured and sprite sheet sprites are drawn in one call per texture run
+	bool isBatchableSprite(Entity entity) const;
+	SpriteInstance spriteInstance(Entity entity) const;
+	// texture the batcher binds for this id, the atlas page when it was packed
+	GLuint spriteBatchTexture(TEXTURE_ASSET_ID texture_id) const;
+	void drawSpriteBatch(GLuint texture, const mat3 &projection);
+	// enemy_bullets, one sprite batch per bullet kind
+	void drawBullets(const mat3 &projection);
 
 	void drawScreenAndButtons(ScreenType screenType, const std::vector<ButtonType> &buttonTypes);
 
+	// window framebuffer size, the window size when headless
+	ivec2 framebufferSize() const;
+	void swapBuffers();
+
 	// Window handle
-	GLFWwindow *window;
+	GLFWwindow *window = nullptr;
 
 	// Screen texture handles
 	GLuint frame_buffer;
@@ -249,25 +318,60 @@ private:
 	int frame_count = 0;
 	float current_fps = 0.0f;
 	bool show_fps = false; // Start with FPS display enabled
+	ParticleStats particle_stats;
+
+	// sorted draw list for the world pass in draw()
+	RenderQueue render_queue;
+
+	// what is currently bound, 0 when unknown
+	GLuint bound_program = 0;
+	GLuint bound_texture = 0;
+	GLuint bound_vao = 0;
+
+	// a frame is recorded here and run by the backend at the end of drawToScreen
+	RenderCommandList commands;
+	GLRenderBackend gl_backend;
+	RenderBackend *backend = &gl_backend;
+	RenderStats last_frame_stats;
+
+	// camera culling, world entities are bucketed by their motion bounds every frame
+	VisibilityGrid visibility_grid;
+	std::vector<Entity> visible_entities; // in submission order, followed by the ones that are never culled
+	// view rectangle of the last cullWorld, particles are culled against it while drawing
+	vec2 view_min = {0.f, 0.f};
+	vec2 view_max = {0.f, 0.f};
+	// instance data of one particle draw, kept to not reallocate every frame
+	std::vector<mat3> particle_transforms;
+	std::vector<float> particle_alphas;
+	std::vector<Entity> unculled_entities;
+	CullStats cull_stats;
 
 	// INSTANCING: Particle effect shader
 	GLuint particle_effect;
 
-	// INSTANCING instance buffer to hold per-particle transform matrices
-	GLuint particle_instance_vbo;
-
 	// INSTANCING: Default VAO for rendering
 	GLuint default_vao;
 
 	// INSTANCING: Store the sprite index count
 	GLsizei sprite_index_count;
 
-	// INSTANCING: Instance VBO for tiles
-	GLuint tile_instance_vbo;
+	// INSTANCING: tile instances, uploaded once per map
+	TileLayer tile_layer;
+
+	// INSTANCING: staging for the sprite batcher
+	std::vector<SpriteInstance> sprite_instances;
+
+	// mini map cells, one R8UI texel per map cell
+	GLuint mini_map_texture = 0;
+	ivec2 mini_map_size = {0, 0};
+	std::vector<unsigned char> mini_map_texels;
 
     // freetype font rendering
     bool fontInit(GLFWwindow& window, const std::string& font_filename, unsigned int font_default_size);
-    void renderText(std::string text, float x, float y, float scale, const glm::vec3& color);
+    // queues the text, everything queued since the last flush is drawn by drawTextBatch in one call;
+    // callers flush where the text has to sit in the draw order
+    void renderText(const std::string& text, float x, float y, float scale, const glm::vec3& color);
+    void drawTextBatch();
     void drawText();
     void drawBuffCountText();
     void drawDangerFactorText();
@@ -276,10 +380,11 @@ private:
     void drawFPSText();
     
     // freetype font rendering
-	std::map<char, Character> m_ftCharacters;
+	GlyphAtlas glyph_atlas;
+	std::vector<TextVertex> text_vertices;
 	GLuint m_font_shaderProgram;
+	EffectReflection font_reflection;
 	GLuint m_font_VAO;
-	GLuint m_font_VBO;
 };
 
 bool loadEffectFromFile(
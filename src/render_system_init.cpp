@@ -1,3 +1,7 @@
+// the GL function pointers are defined here, next to the gl3w_init that loads them
+#define GL3W_IMPLEMENTATION
+#include <gl3w.h>
+
 // stdlib
 #include <iostream>
 #include <sstream>
@@ -48,8 +52,8 @@ bool RenderSystem::init(GLFWwindow *window_arg)
 	// code to use OpenGL 4.3 (not suported on mac) and add additional .h and .cpp
 	// glDebugMessageCallback((GLDEBUGPROC)errorCallback, nullptr);
 
-	// We are not really using VAO's but without at least one bound we will crash in
-	// some systems.
+	// Drawing goes through the per effect and geometry VAOs made in initializeGlVertexArrays,
+	// this one is only bound while setting up.
 	glGenVertexArrays(1, &default_vao);
 	glBindVertexArray(default_vao);
 	gl_has_errors();
@@ -58,6 +62,7 @@ bool RenderSystem::init(GLFWwindow *window_arg)
 	initializeGlTextures();
 	initializeGlEffects();
 	initializeGlGeometryBuffers();
+	initializeGlVertexArrays();
 
     // init font
     std::string font_filename = PROJECT_SOURCE_DIR + std::string("data/fonts/PixelifySans-Regular.ttf");
@@ -67,10 +72,48 @@ bool RenderSystem::init(GLFWwindow *window_arg)
 	return true;
 }
 
+bool RenderSystem::initHeadless(RenderBackend *backend_arg)
+{
+	assert(backend_arg != nullptr);
+	window = nullptr;
+	backend = backend_arg;
+
+	registry.screenStates.emplace(screen_state_entity);
+
+	// nothing is created, every object just needs a distinct nonzero name so the recorded
+	// binds look like the real ones; uniforms aren't reflected so none are recorded
+	GLuint name = 1;
+	frame_buffer = name++;
+	off_screen_render_buffer_color = name++;
+	off_screen_render_buffer_depth = name++;
+	mini_map_texture = name++;
+	default_vao = name++;
+	for (uint i = 0; i < effect_count; i++)
+		effects[i] = name++;
+	for (uint i = 0; i < texture_count; i++)
+	{
+		texture_gl_handles[i] = name++;
+		texture_dimensions[i] = {1, 1};
+	}
+	for (auto &geometry_vaos : mesh_vaos)
+		for (GLuint &vao : geometry_vaos)
+			vao = name++;
+
+	// the quads and the screen triangle are built in, meshes from files draw nothing
+	sprite_index_count = 6;
+	index_counts[(int)GEOMETRY_BUFFER_ID::SPRITE] = 6;
+	index_counts[(int)GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE] = 3;
+
+	return true;
+}
+
 void RenderSystem::initializeGlTextures()
 {
 	glGenTextures((GLsizei)texture_gl_handles.size(), texture_gl_handles.data());
 
+	// keep the pixels around until the atlas pages are built
+	std::array<stbi_uc *, texture_count> pixels;
+
 	for (uint i = 0; i < texture_paths.size(); i++)
 	{
 		const std::string &path = texture_paths[i];
@@ -90,9 +133,60 @@ void RenderSystem::initializeGlTextures()
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 		gl_has_errors();
-		stbi_image_free(data);
+		pixels[i] = data;
 	}
 	gl_has_errors();
+
+	initializeTextureAtlas(pixels);
+
+	for (stbi_uc *data : pixels)
+		stbi_image_free(data);
+
+	// the mini map's storage is allocated by the first frame that knows the map size
+	glGenTextures(1, &mini_map_texture);
+	glBindTexture(GL_TEXTURE_2D, mini_map_texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	gl_has_errors();
+}
+
+void RenderSystem::initializeTextureAtlas(const std::array<unsigned char *, texture_count> &pixels)
+{
+	std::vector<AtlasRect> rects(texture_count);
+	for (uint i = 0; i < texture_count; i++)
+	{
+		if (pixels[i] != NULL)
+			rects[i].size = texture_dimensions[i];
+	}
+
+	AtlasReport report = packAtlas(rects);
+	std::cout << "Texture atlas: " << report.images << "/" << texture_count << " textures in " << report.pages
+			  << " page(s) of " << TEXTURE_ATLAS_PAGE_SIZE << "x" << TEXTURE_ATLAS_PAGE_SIZE
+			  << ", " << (int)(report.efficiency() * 100.f + 0.5f) << "% used" << std::endl;
+
+	std::vector<std::vector<unsigned char>> pages(report.pages, std::vector<unsigned char>(4 * TEXTURE_ATLAS_PAGE_SIZE * TEXTURE_ATLAS_PAGE_SIZE, 0));
+	for (uint i = 0; i < texture_count; i++)
+	{
+		texture_atlas_rects[i] = rects[i];
+		if (rects[i].page < 0)
+			continue;
+		blitToAtlasPage(pages[rects[i].page], TEXTURE_ATLAS_PAGE_SIZE, rects[i], pixels[i]);
+		texture_atlas_uvs[i] = atlasUV(rects[i]);
+	}
+
+	atlas_pages.resize(report.pages);
+	glGenTextures((GLsizei)atlas_pages.size(), atlas_pages.data());
+	for (uint page = 0; page < atlas_pages.size(); page++)
+	{
+		glBindTexture(GL_TEXTURE_2D, atlas_pages[page]);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, TEXTURE_ATLAS_PAGE_SIZE, TEXTURE_ATLAS_PAGE_SIZE, 0, GL_RGBA, GL_UNSIGNED_BYTE, pages[page].data());
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		gl_has_errors();
+	}
 }
 
 void RenderSystem::initializeGlEffects()
@@ -107,9 +201,67 @@ void RenderSystem::initializeGlEffects()
 
 		bool is_valid = loadEffectFromFile(vertex_shader_name, fragment_shader_name, effects[i]);
 		assert(is_valid && (GLuint)effects[i] != 0);
+
+		effect_reflections[i] = reflectProgram(effects[i]);
 	}
 }
 
+void RenderSystem::initializeGlVertexArrays()
+{
+	for (uint effect = 0; effect < effect_count; effect++)
+	{
+		const EffectReflection &effect_reflection = effect_reflections[effect];
+		for (uint geometry = 0; geometry < geometry_count; geometry++)
+		{
+			GLuint &vao = mesh_vaos[effect][geometry];
+			vao = 0;
+
+			// vertex layout of the geometry, see bindVBOandIBO calls
+			const GEOMETRY_BUFFER_ID id = (GEOMETRY_BUFFER_ID)geometry;
+			const bool is_textured = id == GEOMETRY_BUFFER_ID::SPRITE || id == GEOMETRY_BUFFER_ID::HEXAGON;
+			const bool is_coloured = id == GEOMETRY_BUFFER_ID::LINE || id == GEOMETRY_BUFFER_ID::DEBUG_LINE;
+			if (effect_reflection.in_position < 0 ||
+					(effect_reflection.in_texcoord >= 0 && !is_textured) ||
+					(effect_reflection.in_color >= 0 && !is_coloured))
+				continue;
+
+			GLsizei stride = sizeof(vec3);
+			if (is_textured)
+				stride = sizeof(TexturedVertex);
+			else if (is_coloured)
+				stride = sizeof(ColoredVertex);
+
+			glGenVertexArrays(1, &vao);
+			glBindVertexArray(vao);
+			glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers[geometry]);
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffers[geometry]);
+
+			glEnableVertexAttribArray(effect_reflection.in_position);
+			glVertexAttribPointer(effect_reflection.in_position, 3, GL_FLOAT, GL_FALSE, stride, (void *)0);
+			if (effect_reflection.in_texcoord >= 0)
+			{
+				glEnableVertexAttribArray(effect_reflection.in_texcoord);
+				glVertexAttribPointer(effect_reflection.in_texcoord, 2, GL_FLOAT, GL_FALSE, stride, (void *)sizeof(vec3));
+			}
+			if (effect_reflection.in_color >= 0)
+			{
+				glEnableVertexAttribArray(effect_reflection.in_color);
+				glVertexAttribPointer(effect_reflection.in_color, 3, GL_FLOAT, GL_FALSE, stride, (void *)sizeof(vec3));
+			}
+
+			// INSTANCING: the instance buffer moves every draw so only the pointers are left to the draw
+			for (GLint location : effect_reflection.instance_locations)
+			{
+				glEnableVertexAttribArray(location);
+				glVertexAttribDivisor(location, 1);
+			}
+			gl_has_errors();
+		}
+	}
+
+	glBindVertexArray(default_vao);
+}
+
 // One could merge the following two functions as a template function...
 template <class T>
 void RenderSystem::bindVBOandIBO(GEOMETRY_BUFFER_ID gid, std::vector<T> vertices, std::vector<uint16_t> indices)
@@ -123,6 +275,7 @@ void RenderSystem::bindVBOandIBO(GEOMETRY_BUFFER_ID gid, std::vector<T> vertices
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER,
 							 sizeof(indices[0]) * indices.size(), indices.data(), GL_STATIC_DRAW);
 	gl_has_errors();
+	index_counts[(uint)gid] = (GLsizei)indices.size();
 }
 
 void RenderSystem::initializeGlMeshes()
@@ -211,10 +364,10 @@ void RenderSystem::initializeGlGeometryBuffers()
 	// Index Buffer creation.
 	glGenBuffers((GLsizei)index_buffers.size(), index_buffers.data());
 
-	// INSTANCING: generate the particle instance VBO for instanced rendering.
-	glGenBuffers(1, &particle_instance_vbo);
-	// INSTANCING: generate VBO for tile instancing
-	glGenBuffers(1, &tile_instance_vbo);
+	// INSTANCING: the backend's streamed buffer holds the instance data of particles, text and sprite batches
+	gl_backend.init();
+	// INSTANCING: the tile instances only change when the map is tiled
+	tile_layer.init();
 
 	// Index and Vertex buffer data initialization.
 	initializeGlMeshes();
@@ -368,12 +521,32 @@ void RenderSystem::initializeGlGeometryBuffers()
 }
 
 RenderSystem::~RenderSystem()
+{
+	// a headless renderer only has stand-in names
+	if (window != nullptr)
+		releaseGlResources();
+
+	// remove all entities created by the render system
+	while (registry.renderRequests.entities.size() > 0)
+		registry.remove_all_components_of(registry.renderRequests.entities.back());
+}
+
+void RenderSystem::releaseGlResources()
 {
 	// Don't need to free gl resources since they last for as long as the program,
 	// but it's polite to clean after yourself.
 	glDeleteBuffers((GLsizei)vertex_buffers.size(), vertex_buffers.data());
 	glDeleteBuffers((GLsizei)index_buffers.size(), index_buffers.data());
+	for (auto &geometry_vaos : mesh_vaos)
+		glDeleteVertexArrays((GLsizei)geometry_vaos.size(), geometry_vaos.data());
+	gl_backend.destroy();
+	tile_layer.destroy();
+	glyph_atlas.destroy();
+	glDeleteVertexArrays(1, &m_font_VAO);
+	glDeleteProgram(m_font_shaderProgram);
 	glDeleteTextures((GLsizei)texture_gl_handles.size(), texture_gl_handles.data());
+	glDeleteTextures((GLsizei)atlas_pages.size(), atlas_pages.data());
+	glDeleteTextures(1, &mini_map_texture);
 	glDeleteTextures(1, &off_screen_render_buffer_color);
 	glDeleteRenderbuffers(1, &off_screen_render_buffer_depth);
 	gl_has_errors();
@@ -385,10 +558,6 @@ RenderSystem::~RenderSystem()
 	// delete allocated resources
 	glDeleteFramebuffers(1, &frame_buffer);
 	gl_has_errors();
-
-	// remove all entities created by the render system
-	while (registry.renderRequests.entities.size() > 0)
-		registry.remove_all_components_of(registry.renderRequests.entities.back());
 }
 
 // Initialize the screen texture from a standard sprite
@@ -575,7 +744,6 @@ bool RenderSystem::fontInit(GLFWwindow& window, const std::string& font_filename
 
     // font buffer setup
     glGenVertexArrays(1, &m_font_VAO);
-    glGenBuffers(1, &m_font_VBO);
 
     // font vertex shader
     unsigned int font_vertexShader;
@@ -607,98 +775,28 @@ bool RenderSystem::fontInit(GLFWwindow& window, const std::string& font_filename
 
     // apply projection matrix for font
     glUseProgram(m_font_shaderProgram);
+    font_reflection = reflectProgram(m_font_shaderProgram);
     glm::mat4 projection = glm::ortho(0.0f, static_cast<float>(WINDOW_WIDTH_PX), 0.0f, static_cast<float>(WINDOW_HEIGHT_PX));
-    GLint project_location = glGetUniformLocation(m_font_shaderProgram, "projection");
-    assert(project_location > -1);
-    // std::cout << "project_location: " << project_location << std::endl;
-    glUniformMatrix4fv(project_location, 1, GL_FALSE, glm::value_ptr(projection));
+    assert(font_reflection[UNIFORM_ID::PROJECTION].location > -1);
+    font_reflection[UNIFORM_ID::PROJECTION].set(projection);
 
     // clean up shaders
     glDeleteShader(font_vertexShader);
     glDeleteShader(font_fragmentShader);
 
-    // init FreeType fonts
-    FT_Library ft;
-    if (FT_Init_FreeType(&ft))
+    // bake the font into one texture, the smaller size keeps the HUD text from being shrunk from 48px
+    if (!glyph_atlas.init(font_filename, font_default_size, {font_default_size, font_default_size / 2}))
     {
-        std::cerr << "ERROR::FREETYPE: Could not init FreeType Library" << std::endl;
+        std::cerr << "ERROR::FREETYPE: glyph atlas is incomplete for font: " << font_filename << std::endl;
         return false;
     }
 
-    FT_Face face;
-    if (FT_New_Face(ft, font_filename.c_str(), 0, &face))
-    {
-        std::cerr << "ERROR::FREETYPE: Failed to load font: " << font_filename << std::endl;
-        return false;
-    }
-
-    // extract a default size
-    FT_Set_Pixel_Sizes(face, 0, font_default_size);
-
-    // disable byte-alignment restriction in OpenGL
-    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-
-    // load each of the chars - note only first 128 ASCII chars
-    for (unsigned char c = (unsigned char)0; c < (unsigned char)128; c++)
-    {
-        // load character glyph 
-        if (FT_Load_Char(face, c, FT_LOAD_RENDER))
-        {
-            std::cerr << "ERROR::FREETYTPE: Failed to load Glyph " << c << std::endl;
-            continue;
-        }
-
-        // generate texture
-        unsigned int texture;
-        glGenTextures(1, &texture);
-        glBindTexture(GL_TEXTURE_2D, texture);
-
-        // std::cout << "texture: " << c << " = " << texture << std::endl;
-
-        glTexImage2D(
-            GL_TEXTURE_2D,
-            0,
-            GL_RED,
-            face->glyph->bitmap.width,
-            face->glyph->bitmap.rows,
-            0,
-            GL_RED,
-            GL_UNSIGNED_BYTE,
-            face->glyph->bitmap.buffer
-        );
-
-        // set texture options
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        // now store character for later use
-        Character character = {
-            texture,
-            glm::ivec2(face->glyph->bitmap.width, face->glyph->bitmap.rows),
-            glm::ivec2(face->glyph->bitmap_left, face->glyph->bitmap_top),
-            static_cast<unsigned int>(face->glyph->advance.x),
-            (char)c
-        };
-        m_ftCharacters.insert(std::pair<char, Character>(c, character));
-    }
-    glBindTexture(GL_TEXTURE_2D, 0);
-
-    // clean up
-    FT_Done_Face(face);
-    FT_Done_FreeType(ft);
-
-    // bind buffers
+    // text vertices are streamed every frame, drawTextBatch sets the pointers
     glBindVertexArray(m_font_VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, m_font_VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 6 * 4, NULL, GL_DYNAMIC_DRAW);
     glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), 0);
-
-    // release buffers
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glEnableVertexAttribArray(1);
     glBindVertexArray(0);
+    gl_has_errors();
 
     return true;
 }
\ No newline at end of file
@@ -0,0 +1,149 @@
+#include "stream_buffer.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+// attribute offsets stay aligned for any vertex type we stream
+static const GLsizeiptr STREAM_ALIGNMENT = 16;
+
+static bool hasBufferStorage()
+{
+	// gl3w leaves the pointer null when the driver doesn't export it (macOS tops out at 4.1)
+	if (!glBufferStorage)
+		return false;
+
+	GLint major = 0, minor = 0;
+	glGetIntegerv(GL_MAJOR_VERSION, &major);
+	glGetIntegerv(GL_MINOR_VERSION, &minor);
+	if (major > 4 || (major == 4 && minor >= 4))
+		return true;
+
+	GLint extension_count = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &extension_count);
+	for (GLint i = 0; i < extension_count; i++)
+	{
+		const char *extension = (const char *)glGetStringi(GL_EXTENSIONS, i);
+		if (extension && strcmp(extension, "GL_ARB_buffer_storage") == 0)
+			return true;
+	}
+	return false;
+}
+
+void StreamBuffer::init(GLsizeiptr frame_capacity)
+{
+	use_persistent = hasBufferStorage();
+	allocate(frame_capacity);
+}
+
+void StreamBuffer::destroy()
+{
+	for (GLsync &fence : fences)
+	{
+		if (fence)
+			glDeleteSync(fence);
+		fence = nullptr;
+	}
+	if (mapped)
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, vbo);
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+		mapped = nullptr;
+	}
+	if (vbo)
+		glDeleteBuffers(1, &vbo);
+	vbo = 0;
+}
+
+void StreamBuffer::allocate(GLsizeiptr frame_capacity)
+{
+	// draws already issued keep the old buffer alive until the GPU is done with it
+	destroy();
+
+	capacity = frame_capacity;
+	region = 0;
+	head = 0;
+
+	glGenBuffers(1, &vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+
+	if (use_persistent)
+	{
+		const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_ARRAY_BUFFER, capacity * FRAMES_IN_FLIGHT, nullptr, flags);
+		mapped = (unsigned char *)glMapBufferRange(GL_ARRAY_BUFFER, 0, capacity * FRAMES_IN_FLIGHT, flags);
+		if (mapped)
+			return;
+
+		// storage is immutable, start over with a regular buffer
+		std::cerr << "StreamBuffer: persistent mapping failed, falling back to orphaning" << std::endl;
+		use_persistent = false;
+		glDeleteBuffers(1, &vbo);
+		glGenBuffers(1, &vbo);
+		glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	}
+
+	// orphaning gives every frame fresh storage, one region is enough
+	glBufferData(GL_ARRAY_BUFFER, capacity, nullptr, GL_STREAM_DRAW);
+	gl_has_errors();
+}
+
+GLintptr StreamBuffer::write(const void *data, GLsizeiptr size)
+{
+	GLsizeiptr offset = (head + STREAM_ALIGNMENT - 1) & ~(STREAM_ALIGNMENT - 1);
+	if (offset + size > capacity)
+	{
+		// rare, the buffer settles at the largest frame seen
+		allocate(std::max(capacity * 2, (size + STREAM_ALIGNMENT - 1) & ~(STREAM_ALIGNMENT - 1)));
+		grows++;
+		offset = 0;
+	}
+	head = offset + size;
+
+	if (mapped)
+	{
+		const GLintptr start = region * capacity + offset;
+		memcpy(mapped + start, data, size);
+		return start;
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	glBufferSubData(GL_ARRAY_BUFFER, offset, size, data);
+	return offset;
+}
+
+void StreamBuffer::nextFrame()
+{
+	// nothing was streamed, the region is still free
+	if (head == 0)
+		return;
+	head = 0;
+
+	if (!mapped)
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, vbo);
+		glBufferData(GL_ARRAY_BUFFER, capacity, nullptr, GL_STREAM_DRAW);
+		return;
+	}
+
+	fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	region = (region + 1) % FRAMES_IN_FLIGHT;
+	waitForRegion(region);
+}
+
+void StreamBuffer::waitForRegion(int index)
+{
+	GLsync &fence = fences[index];
+	if (!fence)
+		return;
+
+	// only blocks when the CPU is FRAMES_IN_FLIGHT frames ahead of the GPU
+	while (true)
+	{
+		GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+		if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED || result == GL_WAIT_FAILED)
+			break;
+	}
+	glDeleteSync(fence);
+	fence = nullptr;
+}
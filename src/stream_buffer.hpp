@@ -0,0 +1,45 @@
+#pragma once
+
+#include "common.hpp"
+
+#include <array>
+
+// Ring buffer for vertex data that is rewritten every frame (instance transforms and such).
+// The buffer is split into one region per frame in flight. Every write appends to the region
+// of the current frame and returns the byte offset to point the vertex attributes at.
+//
+// With GL_ARB_buffer_storage the whole buffer is mapped once, persistently, and a fence per
+// region keeps the CPU from writing over data the GPU hasn't read yet. Without it, the
+// region is orphaned at the start of each frame and filled with glBufferSubData.
+class StreamBuffer
+{
+public:
+	static const int FRAMES_IN_FLIGHT = 3;
+
+	void init(GLsizeiptr frame_capacity);
+	void destroy();
+
+	// copies size bytes into the current frame and returns their offset in buffer()
+	GLintptr write(const void *data, GLsizeiptr size);
+
+	// fences the frame that was just drawn and moves on to the next region
+	void nextFrame();
+
+	GLuint buffer() const { return vbo; }
+	bool isPersistent() const { return mapped != nullptr; }
+	// how often a frame didn't fit and the buffer had to be recreated larger
+	int growCount() const { return grows; }
+
+private:
+	void allocate(GLsizeiptr frame_capacity);
+	void waitForRegion(int index);
+
+	GLuint vbo = 0;
+	GLsizeiptr capacity = 0; // bytes per region
+	int region = 0;
+	GLsizeiptr head = 0; // bytes written into the current region
+	unsigned char *mapped = nullptr;
+	bool use_persistent = false;
+	std::array<GLsync, FRAMES_IN_FLIGHT> fences = {};
+	int grows = 0;
+};
@@ -0,0 +1,152 @@
+#include "texture_atlas.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <numeric>
+
+// top edge of the packed area, as horizontal segments from left to right
+struct SkylineSegment
+{
+	int x;
+	int y;
+	int width;
+};
+
+// lowest y a w wide rect can sit at with its left edge on segment i, INT_MAX if it doesn't fit
+static int skylineFit(const std::vector<SkylineSegment>& skyline, size_t i, int w, int h, int page_size)
+{
+	int x = skyline[i].x;
+	if (x + w > page_size)
+		return INT_MAX;
+
+	int y = 0;
+	int remaining = w;
+	for (size_t j = i; remaining > 0; j++)
+	{
+		if (j == skyline.size())
+			return INT_MAX;
+		y = std::max(y, skyline[j].y);
+		remaining -= skyline[j].width;
+	}
+	return y + h <= page_size ? y : INT_MAX;
+}
+
+static void skylineInsert(std::vector<SkylineSegment>& skyline, size_t i, int w, int h, int y)
+{
+	const int x = skyline[i].x;
+	skyline.insert(skyline.begin() + i, {x, y + h, w});
+
+	// trim or drop the segments the new one now covers
+	for (size_t j = i + 1; j < skyline.size();)
+	{
+		SkylineSegment& segment = skyline[j];
+		const int covered = x + w - segment.x;
+		if (covered <= 0)
+			break;
+		if (covered < segment.width)
+		{
+			segment.x += covered;
+			segment.width -= covered;
+			break;
+		}
+		skyline.erase(skyline.begin() + j);
+	}
+
+	// neighbours at the same height are one segment
+	for (size_t j = 0; j + 1 < skyline.size();)
+	{
+		if (skyline[j].y == skyline[j + 1].y)
+		{
+			skyline[j].width += skyline[j + 1].width;
+			skyline.erase(skyline.begin() + j + 1);
+		}
+		else
+			j++;
+	}
+}
+
+AtlasReport packAtlas(std::vector<AtlasRect>& rects, int page_size, int padding)
+{
+	AtlasReport report;
+
+	// tallest first keeps the skyline flat, ties go to the wider one
+	std::vector<size_t> order(rects.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&rects](size_t a, size_t b) {
+		if (rects[a].size.y != rects[b].size.y)
+			return rects[a].size.y > rects[b].size.y;
+		return rects[a].size.x > rects[b].size.x;
+	});
+
+	std::vector<std::vector<SkylineSegment>> pages;
+	for (size_t index : order)
+	{
+		AtlasRect& rect = rects[index];
+		rect.page = -1;
+		const int w = rect.size.x + 2 * padding;
+		const int h = rect.size.y + 2 * padding;
+		if (rect.size.x <= 0 || rect.size.y <= 0 || w > page_size || h > page_size)
+			continue;
+
+		bool placed = false;
+		for (size_t page = 0; page <= pages.size() && !placed; page++)
+		{
+			if (page == pages.size())
+				pages.push_back({{0, 0, page_size}});
+			std::vector<SkylineSegment>& skyline = pages[page];
+
+			// lowest spot, then leftmost
+			size_t best = skyline.size();
+			int best_y = INT_MAX;
+			for (size_t i = 0; i < skyline.size(); i++)
+			{
+				int y = skylineFit(skyline, i, w, h, page_size);
+				if (y < best_y)
+				{
+					best_y = y;
+					best = i;
+				}
+			}
+			if (best == skyline.size())
+				continue;
+
+			rect.page = (int)page;
+			rect.position = {skyline[best].x + padding, best_y + padding};
+			skylineInsert(skyline, best, w, h, best_y);
+			placed = true;
+
+			report.images++;
+			report.image_texels += (long long)rect.size.x * rect.size.y;
+		}
+	}
+
+	report.pages = (int)pages.size();
+	report.page_texels = (long long)report.pages * page_size * page_size;
+	return report;
+}
+
+void blitToAtlasPage(std::vector<unsigned char>& page, int page_size, const AtlasRect& rect, const unsigned char* rgba, int padding)
+{
+	// every destination texel in the padded rect reads the nearest image texel
+	for (int y = -padding; y < rect.size.y + padding; y++)
+	{
+		const int src_y = std::clamp(y, 0, rect.size.y - 1);
+		for (int x = -padding; x < rect.size.x + padding; x++)
+		{
+			const int src_x = std::clamp(x, 0, rect.size.x - 1);
+			const unsigned char* src = rgba + 4 * (src_y * rect.size.x + src_x);
+			unsigned char* dst = page.data() + 4 * ((rect.position.y + y) * page_size + rect.position.x + x);
+			std::copy(src, src + 4, dst);
+		}
+	}
+}
+
+glm::vec4 atlasUV(const AtlasRect& rect, int page_size)
+{
+	const float scale = 1.f / (float)page_size;
+	return {
+		rect.position.x * scale,
+		rect.position.y * scale,
+		(rect.position.x + rect.size.x) * scale,
+		(rect.position.y + rect.size.y) * scale};
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+// Only glm here, the offline atlas_packer tool builds this without OpenGL
+#include <glm/ext/vector_int2.hpp>
+#include <glm/vec4.hpp>
+
+#include <vector>
+
+// Pages are square, 2048 is supported everywhere GL 3.3 is
+const int TEXTURE_ATLAS_PAGE_SIZE = 2048;
+// texels repeated around every image so nearest sampling at the border never picks up a neighbour
+const int TEXTURE_ATLAS_PADDING = 1;
+
+struct AtlasRect
+{
+	glm::ivec2 size = {0, 0};		// image size, without padding
+	int page = -1;					// -1 until packed, or when the image doesn't fit on a page
+	glm::ivec2 position = {0, 0};	// top-left texel of the image inside its page
+};
+
+struct AtlasReport
+{
+	int images = 0;
+	int pages = 0;
+	long long image_texels = 0;		// texels covered by images
+	long long page_texels = 0;		// texels of all pages together
+	float efficiency() const { return page_texels > 0 ? (float)image_texels / (float)page_texels : 0.f; }
+};
+
+// Skyline bottom-left packing of the rects into as few pages as possible. Rects are placed
+// tallest first, each at the lowest then leftmost spot of the first page it fits on.
+// Rects larger than a page keep page -1 and are left out of the report.
+AtlasReport packAtlas(std::vector<AtlasRect>& rects, int page_size = TEXTURE_ATLAS_PAGE_SIZE, int padding = TEXTURE_ATLAS_PADDING);
+
+// Copies an RGBA image into an RGBA page at rect.position and extrudes its edges into the padding
+void blitToAtlasPage(std::vector<unsigned char>& page, int page_size, const AtlasRect& rect, const unsigned char* rgba, int padding = TEXTURE_ATLAS_PADDING);
+
+// (u0, v0, u1, v1) of the rect in page texture coordinates
+glm::vec4 atlasUV(const AtlasRect& rect, int page_size = TEXTURE_ATLAS_PAGE_SIZE);
@@ -0,0 +1,135 @@
+#include "thread_pool.hpp"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(unsigned int worker_count)
+{
+	if (worker_count == 0)
+	{
+		unsigned int hw = std::thread::hardware_concurrency();
+		worker_count = hw > 1 ? hw - 1 : 1;
+	}
+	this->worker_count = worker_count;
+
+	queues.reserve(worker_count);
+	for (unsigned int i = 0; i < worker_count; i++)
+		queues.push_back(std::make_unique<WorkerQueue>());
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(wake_mutex);
+		stopping = true;
+	}
+	wake_cv.notify_all();
+	for (std::thread& worker : workers)
+		worker.join();
+}
+
+void ThreadPool::enqueue(std::function<void()> job)
+{
+	std::call_once(started, [this]() { start(); });
+
+	WorkerQueue& queue = *queues[next_queue++ % worker_count];
+	{
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.jobs.push_back(std::move(job));
+	}
+	// counted only once it is in a queue, so a worker that saw the count always finds a job
+	{
+		std::lock_guard<std::mutex> lock(wake_mutex);
+		queued++;
+	}
+	wake_cv.notify_one();
+}
+
+void ThreadPool::start()
+{
+	workers.reserve(worker_count);
+	for (unsigned int i = 0; i < worker_count; i++)
+		workers.emplace_back(&ThreadPool::workerLoop, this, i);
+}
+
+bool ThreadPool::takeJob(unsigned int index, std::function<void()>& job)
+{
+	for (unsigned int k = 0; k < worker_count; k++)
+	{
+		WorkerQueue& queue = *queues[(index + k) % worker_count];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (queue.jobs.empty())
+			continue;
+		job = std::move(queue.jobs.front());
+		queue.jobs.pop_front();
+		return true;
+	}
+	return false;
+}
+
+void ThreadPool::workerLoop(unsigned int index)
+{
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(wake_mutex);
+			wake_cv.wait(lock, [this]() { return stopping || queued > 0; });
+			// drain whatever is left before exiting so pending futures still resolve
+			if (queued == 0)
+				return;
+			// claim one job, it is in some queue even if another worker takes the one we look at first
+			queued--;
+		}
+
+		std::function<void()> job;
+		while (!takeJob(index, job))
+			std::this_thread::yield();
+		job();
+	}
+}
+
+namespace
+{
+	// shared with the helper jobs, which may only start after parallelFor has returned
+	struct ParallelFor
+	{
+		std::function<void(int)> chunk;
+		int chunk_count = 0;
+		std::atomic<int> next_chunk{0};
+		std::atomic<int> done_chunks{0};
+		std::mutex done_mutex;
+		std::condition_variable done_cv;
+
+		void run()
+		{
+			for (int i = next_chunk++; i < chunk_count; i = next_chunk++)
+			{
+				chunk(i);
+				if (++done_chunks == chunk_count)
+				{
+					std::lock_guard<std::mutex> lock(done_mutex);
+					done_cv.notify_all();
+				}
+			}
+		}
+	};
+}
+
+void ThreadPool::parallelFor(int chunk_count, const std::function<void(int)>& chunk)
+{
+	if (chunk_count <= 0)
+		return;
+
+	auto state = std::make_shared<ParallelFor>();
+	state->chunk = chunk;
+	state->chunk_count = chunk_count;
+
+	// one helper per chunk beyond the caller's, up to the worker count; a helper that starts late finds nothing left
+	const int helpers = std::min((int)worker_count, chunk_count - 1);
+	for (int i = 0; i < helpers; i++)
+		enqueue([state]() { state->run(); });
+
+	state->run();
+
+	std::unique_lock<std::mutex> lock(state->done_mutex);
+	state->done_cv.wait(lock, [&state]() { return state->done_chunks == state->chunk_count; });
+}
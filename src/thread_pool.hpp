@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Small fixed-size worker pool for background jobs (path planning, AI archetypes, particle chunks)
+// Workers are only spawned on the first submit, so systems that never queue work cost nothing.
+// Every worker has its own queue, jobs are dealt out round robin and a worker whose queue is
+// empty steals the oldest job of another, so one long job doesn't hold up the ones queued behind it.
+class ThreadPool
+{
+public:
+	// worker_count of 0 picks a count based on the hardware, leaving a core for the main thread
+	explicit ThreadPool(unsigned int worker_count = 0);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// queue a job and get a future for its result
+	template <typename F>
+	auto submit(F&& job) -> std::future<decltype(job())>
+	{
+		using Result = decltype(job());
+		auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(job));
+		std::future<Result> result = task->get_future();
+		enqueue([task]() { (*task)(); });
+		return result;
+	}
+
+	// Runs chunk(i) for every i in [0, chunk_count) and returns once all are done. The calling
+	// thread claims chunks too, so this never waits on a worker busy with something else.
+	// Which thread runs a chunk varies, chunks must only write their own data.
+	void parallelFor(int chunk_count, const std::function<void(int)>& chunk);
+
+	unsigned int workerCount() const { return worker_count; }
+
+private:
+	struct WorkerQueue
+	{
+		std::deque<std::function<void()>> jobs;
+		std::mutex mutex;
+	};
+
+	void enqueue(std::function<void()> job);
+	void start();
+	void workerLoop(unsigned int index);
+	// own queue first, then the others, oldest job first
+	bool takeJob(unsigned int index, std::function<void()>& job);
+
+	unsigned int worker_count;
+	std::vector<std::thread> workers;
+	std::vector<std::unique_ptr<WorkerQueue>> queues;
+	std::atomic<unsigned int> next_queue{0};
+
+	// queued counts jobs in any queue, guarded by wake_mutex so a sleeping worker can't miss one
+	std::once_flag started;
+	std::mutex wake_mutex;
+	std::condition_variable wake_cv;
+	int queued = 0;
+	bool stopping = false;
+};
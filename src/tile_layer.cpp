@@ -0,0 +1,134 @@
+#include "tile_layer.hpp"
+#include "tinyECS/registry.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <glm/trigonometric.hpp>
+
+void TileLayer::init()
+{
+	glGenBuffers(1, &vbo);
+}
+
+void TileLayer::destroy()
+{
+	glDeleteBuffers(1, &vbo);
+	vbo = 0;
+}
+
+bool TileLayer::needsRebuild() const
+{
+	return dirty || registry.tiles.size() != tile_count;
+}
+
+void TileLayer::rebuild(RenderCommandList &commands)
+{
+	struct Pending
+	{
+		Entity entity;
+		TileInstance instance;
+		TEXTURE_ASSET_ID texture;
+		bool animated;
+		float y;
+		float x;
+	};
+
+	std::vector<Pending> pending;
+	for (Entity entity : registry.tiles.entities)
+	{
+		if (!registry.motions.has(entity) ||
+				!registry.renderRequests.has(entity) ||
+				!registry.spriteSheetImages.has(entity) ||
+				!registry.spritesSizes.has(entity))
+			continue;
+
+		const RenderRequest &request = registry.renderRequests.get(entity);
+		const bool is_animated = registry.animations.has(entity);
+		if (request.used_effect != EFFECT_ASSET_ID::TILE && !is_animated)
+			continue;
+
+		const Motion &motion = registry.motions.get(entity);
+		Transform transform;
+		transform.translate(motion.position);
+		transform.scale(motion.scale);
+		transform.rotate(radians(motion.angle));
+
+		const SpriteSheetImage &sprite_sheet = registry.spriteSheetImages.get(entity);
+		const SpriteSize &sprite = registry.spritesSizes.get(entity);
+
+		Pending tile;
+		tile.entity = entity;
+		tile.instance.transform = transform.mat;
+		tile.instance.params = {float(sprite_sheet.total_frames),
+								float(sprite_sheet.current_frame),
+								float(sprite.width),
+								request.used_effect == EFFECT_ASSET_ID::TILE ? 1.f : 0.f};
+		tile.texture = request.used_texture;
+		tile.animated = is_animated;
+		tile.y = motion.position.y;
+		tile.x = motion.position.x;
+		pending.push_back(tile);
+	}
+
+	// animated tiles last so they draw over the ground, then by texture, then row by row
+	std::sort(pending.begin(), pending.end(), [](const Pending &a, const Pending &b) {
+		if (a.animated != b.animated)
+			return b.animated;
+		if (a.texture != b.texture)
+			return a.texture < b.texture;
+		if (a.y != b.y)
+			return a.y < b.y;
+		return a.x < b.x;
+	});
+
+	instances.clear();
+	instance_y.clear();
+	tile_batches.clear();
+	animated.clear();
+	for (size_t i = 0; i < pending.size(); i++)
+	{
+		const Pending &tile = pending[i];
+		if (i == 0 || tile.texture != pending[i - 1].texture || tile.animated != pending[i - 1].animated)
+			tile_batches.push_back({tile.texture, (GLint)i, 0});
+		tile_batches.back().count++;
+
+		instances.push_back(tile.instance);
+		instance_y.push_back(tile.y);
+		if (tile.animated)
+			animated.push_back({tile.entity, (GLint)i, (int)tile.instance.params.y});
+	}
+
+	commands.uploadBuffer(vbo, 0, instances.data(), instances.size() * sizeof(TileInstance), true);
+
+	tile_count = registry.tiles.size();
+	dirty = false;
+}
+
+void TileLayer::updateAnimated(RenderCommandList &commands)
+{
+	for (AnimatedTile &tile : animated)
+	{
+		if (!registry.spriteSheetImages.has(tile.entity))
+			continue;
+		const int frame = registry.spriteSheetImages.get(tile.entity).current_frame;
+		if (frame == tile.frame)
+			continue;
+		tile.frame = frame;
+
+		TileInstance &instance = instances[tile.index];
+		instance.params.y = float(frame);
+		commands.uploadBuffer(vbo, tile.index * sizeof(TileInstance) + offsetof(TileInstance, params), &instance.params, sizeof(vec4), false);
+	}
+}
+
+void TileLayer::visibleRange(const TileBatch &batch, float top, float bottom, GLint &first, GLsizei &count) const
+{
+	// tile centres within half a tile of the view still reach into it
+	const float margin = GRID_CELL_HEIGHT_PX;
+	auto begin = instance_y.begin() + batch.first;
+	auto end = begin + batch.count;
+	auto low = std::lower_bound(begin, end, top - margin);
+	auto high = std::upper_bound(low, end, bottom + margin);
+	first = (GLint)(low - instance_y.begin());
+	count = (GLsizei)(high - low);
+}
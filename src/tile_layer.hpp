@@ -0,0 +1,63 @@
+#pragma once
+
+#include "common.hpp"
+#include "render_commands.hpp"
+#include "tinyECS/components.hpp"
+#include "tinyECS/tiny_ecs.hpp"
+
+#include <vector>
+
+struct TileInstance
+{
+	mat3 transform;
+	vec4 params; // x: total_frames, y: current_frame, z: sprite_width, w: 1 when the frames are parallax layers
+};
+
+// Tiles drawn with one texture. Instances are sorted top to bottom so any band of rows
+// is a contiguous instance range.
+struct TileBatch
+{
+	TEXTURE_ASSET_ID texture;
+	GLint first;	// first instance in the tile layer buffer
+	GLsizei count;
+};
+
+// The map tiles only change when a level is tiled, so their instances are uploaded once and
+// kept on the GPU. Animated tiles (portals) sit at the end of the buffer and only the
+// instances whose frame changed are re-uploaded.
+class TileLayer
+{
+public:
+	void init();
+	void destroy();
+
+	// the tiles were recreated, rebuild on the next draw even if the count is the same
+	void invalidate() { dirty = true; }
+	bool needsRebuild() const;
+	void rebuild(RenderCommandList &commands);
+
+	// pushes the frames of animated tiles that changed since the last call
+	void updateAnimated(RenderCommandList &commands);
+
+	// instances of the batch that overlap the rows between top and bottom (world y)
+	void visibleRange(const TileBatch &batch, float top, float bottom, GLint &first, GLsizei &count) const;
+
+	GLuint buffer() const { return vbo; }
+	const std::vector<TileBatch> &batches() const { return tile_batches; }
+
+private:
+	struct AnimatedTile
+	{
+		Entity entity;
+		GLint index;
+		int frame;
+	};
+
+	GLuint vbo = 0;
+	std::vector<TileInstance> instances;
+	std::vector<float> instance_y; // centre y of each instance, sorted within a batch
+	std::vector<TileBatch> tile_batches;
+	std::vector<AnimatedTile> animated;
+	size_t tile_count = 0;
+	bool dirty = true;
+};
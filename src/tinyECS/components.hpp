@@ -1,7 +1,9 @@
 #pragma once
 #include "common.hpp"
+#include "game_time.hpp"
 #include <vector>
 #include <unordered_map>
+#include <future>
 #include "../ext/stb_image/stb_image.h"
 #include "../ext/json/json.hpp"
 
@@ -102,14 +104,14 @@ struct Player
 	int speed = PLAYER_SPEED;
 	int dash_damage = PLAYER_DASH_DAMAGE;
 	float healing_rate = PLAYER_BASE_HEALING_RATE;
-	float healing_timer_ms = PLAYER_DEFAULT_HEALING_TIMER_MS;
+	Deadline next_heal; // started by createPlayer
 	float default_healing_timer = PLAYER_DEFAULT_HEALING_TIMER_MS;
 
 	// Active cooldown timer and the default cooldown time
 	int dash_count = DASH_RECHARGE_COUNT;
 	int max_dash_count = DASH_RECHARGE_COUNT;
 	
-	int dash_cooldown_timer_ms = 0;
+	Deadline dash_recharge;
 	int dash_cooldown_ms = PLAYER_DASH_COOLDOWN_MS;
 	float dash_speed = PLAYER_DASH_SPEED;
 	float dash_range = PLAYER_DASH_RANGE;
@@ -130,7 +132,8 @@ struct Player
 	// Detection range for enemies
 	float detection_range = 1.0f;
 
-	float knockback_duration = 0.0f;
+	// movement input is ignored until it runs out
+	Deadline knockback;
 
 	vec2 grid_position = {0, 0};
 	// std::vector<int> buffsCollected;
@@ -150,7 +153,7 @@ struct Dashing
 {
 	vec2 velocity = { 0, 0 };
 	float angle_deg = 0.0f;
-	float timer_ms = 700.0f;
+	Deadline end;
 };
 
 struct SpriteSize
@@ -204,6 +207,19 @@ struct Portal {
 struct MiniMap {
 	std::vector<std::vector<int>> visited;
 	int dummy = 0;
+
+	// cells changed since the renderer last uploaded them, as an inclusive (column, row) rect
+	bool upload_all = true;
+	bool has_changes = false;
+	ivec2 changed_min = {0, 0};
+	ivec2 changed_max = {0, 0};
+
+	void markChanged(int row, int column) {
+		const ivec2 cell = {column, row};
+		changed_min = has_changes ? glm::min(changed_min, cell) : cell;
+		changed_max = has_changes ? glm::max(changed_max, cell) : cell;
+		has_changes = true;
+	}
 };
 
 struct Camera
@@ -221,15 +237,23 @@ struct Enemy
 };
 
 // Projectile
-struct Projectile 
+// which factory made a projectile, it is parked in that factory's pool when it dies
+enum class PROJECTILE_ARCHETYPE
 {
-	int damage;
-	float ms_until_despawn = PROJECTILE_TTL_MS;
-	bool from_enemy = true;
+	PLAIN = 0,
+	BACTERIOPHAGE = PLAIN + 1,
+	FINAL_BOSS_EYEBALL = BACTERIOPHAGE + 1,
+	PROJECTILE_ARCHETYPE_COUNT
 };
+const int projectile_archetype_count = (int)PROJECTILE_ARCHETYPE::PROJECTILE_ARCHETYPE_COUNT;
 
-struct SpiralProjectile
+struct Projectile 
 {
+	int damage;
+	bool from_enemy = true;
+	// false while parked in projectile_pools, collisions skip it
+	bool active = true;
+	PROJECTILE_ARCHETYPE archetype = PROJECTILE_ARCHETYPE::PLAIN;
 };
 
 struct FollowingProjectile
@@ -240,7 +264,6 @@ struct BacteriophageProjectile {
 	int dummy = 0;
 };
 
-struct BossProjectile {};
 struct FinalBossProjectile {};
 
 // used for Entities that cause damage
@@ -290,7 +313,7 @@ struct ScreenState
 {
 	float darken_screen_factor = -1.f;
 	float vignette_screen_factor = 0.f;
-    float vignette_timer_ms = 0.f;
+    Deadline vignette_hold; // the vignette only starts fading once due
 };
 
 // A struct to refer to debugging graphics in the ECS
@@ -462,7 +485,7 @@ struct InfoBox
 };
 
 struct Gun {
-    float cooldown_timer_ms = 0.0f;
+    Deadline cooldown;
 };
 
 struct BossArrow {
@@ -470,8 +493,8 @@ struct BossArrow {
 	bool draw = false;
 };
 
+// one-shot sprite sheet effects, removed by their NO_LOOP animation
 struct Effect {
-    float death_timer_ms;
 };
 
 /**
@@ -600,7 +623,8 @@ enum class EFFECT_ASSET_ID
     FONT = PARTICLE_EFFECT + 1,
     THERMOMETER_EFFECT = FONT + 1,
 	WEAPON_COOLDOWN_INDICATOR = THERMOMETER_EFFECT + 1,
-    EFFECT_COUNT = WEAPON_COOLDOWN_INDICATOR + 1,
+	SPRITE_INSTANCED = WEAPON_COOLDOWN_INDICATOR + 1,
+    EFFECT_COUNT = SPRITE_INSTANCED + 1,
 
 };
 const int effect_count = (int)EFFECT_ASSET_ID::EFFECT_COUNT;
@@ -622,6 +646,8 @@ struct RenderRequest
 	TEXTURE_ASSET_ID used_texture = TEXTURE_ASSET_ID::TEXTURE_COUNT;
 	EFFECT_ASSET_ID used_effect = EFFECT_ASSET_ID::EFFECT_COUNT;
 	GEOMETRY_BUFFER_ID used_geometry = GEOMETRY_BUFFER_ID::GEOMETRY_COUNT;
+	// pooled entities keep their request while parked, the renderer skips hidden ones
+	bool visible = true;
 };
 
 enum class ANIM_LOOP_TYPES
@@ -640,12 +666,9 @@ struct SpriteSheetImage
 // Animation frame
 struct Animation
 {
-	int start_frame = 0;
-	int end_frame = 0;
-	float time_since_last_frame = 0.0f;
-	float time_per_frame = 0.0f;
-	ANIM_LOOP_TYPES loop = ANIM_LOOP_TYPES::NO_LOOP;
-	bool forwards = true;
+	int clip = 0;          // id in animation_clips, see animation_system.hpp
+	float time_ms = 0.0f;  // since the clip started, wrapped for looping clips
+	int frame = -1;        // last frame written to the SpriteSheetImage
 };
 
 enum class PLAYER_FRAMES
@@ -694,8 +717,15 @@ struct EnemyAI
 	vec2 patrolOrigin = { 0, 0 };     // origin of patrol
 	float patrolRange = SPIKE_ENEMY_PATROL_RANGE;     // range of patrol
 	float patrolTime = ENEMY_PATROL_TIME_MS / 2;
-    float knockbackTimer = 0.f;
+    Deadline knockback;
     float bombTimer = SPIKE_ENEMY_BOMB_TIMER;
+	// time skipped by the AI LOD scheduler, handed to the next update
+	float lodPendingMs = 0.f;
+
+	// position in the archetype's behaviour table (data/ai/behaviours.json), -1 until first update
+	int behaviourState = -1;
+	Deadline behaviourTimer;
+	Deadline behaviourRepeatTimer;
 };
 
 enum class SpikeEnemyState
@@ -742,6 +772,8 @@ struct BacteriophageAI
 	float time_since_shoot_ms = 0.0f;
 	bool can_shoot = false;
 	int placement_index = 0;
+	// time skipped by the AI LOD scheduler, handed to the next update
+	float lodPendingMs = 0.f;
 };
 
 enum class DenderiteState
@@ -756,14 +788,14 @@ struct DenderiteAI : EnemyAI
 	// store whole path to follow 
 	std::vector<ivec2> path;
 	bool isCharging = false;
-	float chargeTime = 100.0f;
-	float chargeDuration = 500.0f;
-	float shootCoolDown = 200.0f;
 	int currentNodeIndex = 0;
 	DenderiteState state = DenderiteState::HUNT;
 
 	float timeSinceLastRecalc = 0.f;
     float recalcTimeThreshold = DENDERITE_RECALC_DURATION;
+
+	// replan running on the path planner workers, invalid when nothing is in flight
+	std::shared_future<std::vector<ivec2>> pending_path;
 };
 
 enum class BossState
@@ -789,19 +821,11 @@ struct BossAI : EnemyAI
 {
 	BossState state = BossState::INITIAL;
 	int stage = 0;
-	float cool_down;
-	float shoot_cool_down;
 
-	// RUMBLE-specific state
-	float rumble_charge_time = 1500.f;  // time before rushing
-	float rumble_duration = 1000.f;     // time spent rushing
-	bool is_charging = true;
+	// winding up a RUMBLE dash, collisions only hurt once it's moving
+	bool is_charging = false;
 	vec2 projectile_size = BOSS_PROJECTILE;
 
-	float flee_duration = 1000.f;    // Arbitrary duration in ms
-	float flee_timer = 0.f;
-	bool is_fleeing = false;
-
 	Entity associatedArrow;
 };
 
@@ -809,11 +833,12 @@ struct FinalBossAI : EnemyAI
 {
 	FinalBossState state = FinalBossState::INITIAL;
 	unsigned int phase = 1;
-	float cool_down = FINAL_BOSS_BASE_COOLDOWN;
+	Deadline cool_down; // how long it stays TIRED
 	bool has_spawned = false;
 
-	float shoot_cool_down = FINAL_BOSS_BASE_SHOOT_COOLDOWN;
-	float spiral_duration = FINAL_BOSS_SHOOT_DURATION; 
+	// both started on entering SPIRAL_SHOOT_1
+	Deadline shoot_cool_down;
+	Deadline spiral_duration;
 
 	Entity associatedArrow;
 };
@@ -825,6 +850,7 @@ enum class PARTICLE_TYPE
 	RIPPLE_PARTICLE = 1,
     PARTICLE_TYPE_COUNT
 };
+const int particle_type_count = (int)PARTICLE_TYPE::PARTICLE_TYPE_COUNT;
 
 enum class PARTICLE_STATE 
 {
@@ -833,17 +859,6 @@ enum class PARTICLE_STATE
     FADE = 2,   
 };
 
-// Particle component for particle system
-struct Particle 
-{
-    PARTICLE_TYPE type;
-    PARTICLE_STATE state = PARTICLE_STATE::BURST;
-    float lifetime_ms = 2000.0f;
-    float max_lifetime_ms = 2000.0f;
-    float state_timer_ms = 0.0f;
-    float speed_factor = 100.0f;
-};
-
 //biomes
 enum class Biome {
   RED = 0,
@@ -858,10 +873,10 @@ struct PopupWithImage {
 	Entity text;
 	Entity description;
 	Entity image;
-	float duration;
 
-	PopupWithImage(const Entity& text, const Entity& description, const Entity& image, float duration)
-		: text(text), description(description), image(image), duration(duration) {}
+	// removed after POPUP_DURATION, see createBuffPopup
+	PopupWithImage(const Entity& text, const Entity& description, const Entity& image)
+		: text(text), description(description), image(image) {}
 };
 
 struct PopupElement {};
@@ -914,11 +929,11 @@ NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(Player,
 	speed,
 	dash_damage,
 	healing_rate,
-	healing_timer_ms,
+	next_heal,
 	default_healing_timer,
 	dash_count,
 	max_dash_count,
-	dash_cooldown_timer_ms,
+	dash_recharge,
 	dash_cooldown_ms,
 	dash_speed,
 	dash_range,
@@ -931,7 +946,7 @@ NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(Player,
 	bulletSpeed,
 	extra_lives,
 	detection_range,
-	knockback_duration,
+	knockback,
 	grid_position,
 	buffsCollected,
 	germoney_count,
@@ -941,7 +956,7 @@ NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(Player,
 NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(Dashing,
 	velocity,
 	angle_deg,
-	timer_ms
+	end
 )
 
 NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(SpriteSize,
@@ -993,8 +1008,7 @@ NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(Enemy,
 )
 
 NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(Projectile,
-	damage,
-	ms_until_despawn
+	damage
 )
 
 NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(BacteriophageProjectile,
@@ -1154,12 +1168,9 @@ NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(SpriteSheetImage,
 )
 
 NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(Animation,
-	start_frame,
-	end_frame,
-	time_since_last_frame,
-	time_per_frame,
-	loop,
-	forwards
+	clip,
+	time_ms,
+	frame
 )
 
 NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(DamageCooldown,
@@ -1192,15 +1203,6 @@ NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(BacteriophageAI,
 	placement_index
 )
 
-NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(Particle,
-	type,
-	state,
-	lifetime_ms,
-	max_lifetime_ms,
-	state_timer_ms,
-	speed_factor
-)
-
 NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(Progression,
 	buffsFromLastRun,
 	pickedInNucleus,
@@ -1208,7 +1210,3 @@ NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(Progression,
 	germoney_savings
 )
 
-NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(Effect,
-	death_timer_ms
-)
-
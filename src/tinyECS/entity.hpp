@@ -25,7 +25,7 @@ public:
     {
     }
 
-    operator unsigned int() { return m_id; } // enables automatic casting to int
+    operator unsigned int() const { return m_id; } // enables automatic casting to int
 
-    unsigned int id() { return m_id; }
+    unsigned int id() const { return m_id; }
 };
\ No newline at end of file
@@ -29,7 +29,6 @@ public:
 	ComponentContainer<Enemy> enemies;
 	ComponentContainer<Projectile> projectiles;
 	ComponentContainer<BacteriophageProjectile> bacteriophageProjectiles;
-	ComponentContainer<BossProjectile> bossProjectiles;
 	ComponentContainer<FinalBossProjectile> finalBossProjectiles;
     ComponentContainer<Portal> portals;
 
@@ -81,12 +80,8 @@ public:
 	ComponentContainer<BossAI> bossAIs;
 	ComponentContainer<FinalBossAI> finalBossAIs;
 	ComponentContainer<BossArrow> bossArrows;
-	ComponentContainer<SpiralProjectile> spiralProjectiles;
 	ComponentContainer<FollowingProjectile> followingProjectiles;
 
-	// particle
-	ComponentContainer<Particle> particles;
-
     ComponentContainer<Gun> guns;
 	// NUCLEUS MENU SLOT
 	ComponentContainer<Slot> slots;
@@ -146,9 +141,7 @@ public:
 		registry_list.push_back(&spikeEnemyAIs);
 		registry_list.push_back(&rbcEnemyAIs);
 		registry_list.push_back(&bacteriophageAIs);
-		registry_list.push_back(&particles);
 		registry_list.push_back(&bossAIs);
-		registry_list.push_back(&bossProjectiles);
         registry_list.push_back(&guns);
 		registry_list.push_back(&slots);
         registry_list.push_back(&clickableBuffs);
@@ -156,7 +149,6 @@ public:
 		registry_list.push_back(&thermometers);
 		registry_list.push_back(&finalBossAIs);
 		registry_list.push_back(&finalBossProjectiles);
-		registry_list.push_back(&spiralProjectiles);
 		registry_list.push_back(&followingProjectiles);
 		registry_list.push_back(&denderiteAIs);
 		registry_list.push_back(&texts);
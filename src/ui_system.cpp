@@ -1,5 +1,6 @@
 #include "ui_system.hpp"
 #include "world_init.hpp"
+#include "animation_system.hpp"
 #include "tinyECS/registry.hpp"
 #include <random>
 #include <iostream>
@@ -179,11 +180,7 @@ Entity createShopKeeper() {
 	m.position = {WORLD_ORIGIN.x + WINDOW_WIDTH_PX/4, WORLD_ORIGIN.y};
 		
 	Animation &animation = registry.animations.emplace(shopKeeper);
-	
-	animation.time_per_frame = 100.0;
-	animation.start_frame = 0;
-	animation.end_frame = 0;
-	animation.loop = ANIM_LOOP_TYPES::LOOP;
+	animation.clip = animation_clips.clipId({ 0, 0, 100.0, ANIM_LOOP_TYPES::LOOP });
 	 
 	SpriteSheetImage &spriteSheet = registry.spriteSheetImages.emplace(shopKeeper);
 	spriteSheet.total_frames = 3;
@@ -532,10 +529,7 @@ Entity createEndingWinScene() {
 	);
 
 	Animation &animation = registry.animations.emplace(winScreenEntity);
-	animation.time_per_frame = WIN_CUTSCENE_DURATION_MS / 4;
-	animation.start_frame = 0;
-	animation.end_frame = 4;
-	animation.loop = ANIM_LOOP_TYPES::LOOP;
+	animation.clip = animation_clips.clipId({ 0, 4, WIN_CUTSCENE_DURATION_MS / 4, ANIM_LOOP_TYPES::LOOP });
 
 	SpriteSheetImage &spriteSheet = registry.spriteSheetImages.emplace(winScreenEntity);
 	spriteSheet.total_frames = 4;
@@ -566,10 +560,7 @@ Entity createCutSceneBackGround()
 		 EFFECT_ASSET_ID::SPRITE_SHEET,
 		 GEOMETRY_BUFFER_ID::SPRITE});
 
-	Animation &animation = registry.animations.emplace(backGroundEntity);
-	animation.time_per_frame = INTRO_CUTSCENE_DURATION_MS / 8;
-	animation.start_frame = 0;
-	animation.end_frame = 8;
+	playAnimation(backGroundEntity, animation_clips.clipId({ 0, 8, INTRO_CUTSCENE_DURATION_MS / 8, ANIM_LOOP_TYPES::NO_LOOP }));
 
 	SpriteSheetImage &spriteSheet = registry.spriteSheetImages.emplace(backGroundEntity);
 	spriteSheet.total_frames = 8;
@@ -676,10 +667,7 @@ Entity createEnteringNucleus()
 		 EFFECT_ASSET_ID::SPRITE_SHEET,
 		 GEOMETRY_BUFFER_ID::SPRITE});
 
-	Animation &animation = registry.animations.emplace(nucleusEntity);
-	animation.time_per_frame = INTRO_CUTSCENE_DURATION_MS / 8;
-	animation.start_frame = 0;
-	animation.end_frame = 8;
+	playAnimation(nucleusEntity, animation_clips.clipId({ 0, 8, INTRO_CUTSCENE_DURATION_MS / 8, ANIM_LOOP_TYPES::NO_LOOP }));
 
 	SpriteSheetImage &spriteSheet = registry.spriteSheetImages.emplace(nucleusEntity);
 	spriteSheet.total_frames = 8;
@@ -968,10 +956,7 @@ void createDashRecharge()
 		Entity dash = Entity();
 
 		Animation &a = registry.animations.emplace(dash);
-		a.start_frame = 1;
-		a.end_frame = 3;
-		a.time_per_frame = 300.0f;
-		a.loop = ANIM_LOOP_TYPES::PING_PONG;
+		a.clip = animation_clips.clipId({ 1, 3, 300.0f, ANIM_LOOP_TYPES::PING_PONG });
 
 		SpriteSheetImage &spriteSheet = registry.spriteSheetImages.emplace(dash);
 		spriteSheet.total_frames = 3;
@@ -1058,10 +1043,7 @@ Entity createBuffUI(vec2 position, BUFF_TYPE type, vec2 scale)
         );
 
         Animation& a = registry.animations.emplace(buffUI);
-        a.start_frame = 0;
-        a.end_frame = 7;
-        a.time_per_frame = 100.0f;
-        a.loop = ANIM_LOOP_TYPES::LOOP;
+        a.clip = animation_clips.clipId({ 0, 7, 100.0f, ANIM_LOOP_TYPES::LOOP });
 
         SpriteSheetImage& spriteSheet = registry.spriteSheetImages.emplace(buffUI);
         spriteSheet.total_frames = 7;
@@ -1081,10 +1063,7 @@ Entity createBuffUI(vec2 position, BUFF_TYPE type, vec2 scale)
         );
 
         Animation& a = registry.animations.emplace(buffUI);
-        a.start_frame = 0;
-        a.end_frame = 10;
-        a.time_per_frame = 100.0f;
-        a.loop = ANIM_LOOP_TYPES::PING_PONG;
+        a.clip = animation_clips.clipId({ 0, 10, 100.0f, ANIM_LOOP_TYPES::PING_PONG });
 
         SpriteSheetImage& spriteSheet = registry.spriteSheetImages.emplace(buffUI);
         spriteSheet.total_frames = 14;
@@ -1354,16 +1333,6 @@ void updateHuds()
 
 }
 
-void updatePopups(float elapsed_ms_since_last_update)
-{
-	removePopups([&](Entity& entity)
-		{
-			PopupWithImage& popup = registry.imagePopups.get(entity);
-			popup.duration -= elapsed_ms_since_last_update;
-			return popup.duration < 0;
-		});
-}
-
 void removePopups(std::function<bool(Entity&)> shouldRemove)
 {
 	std::vector<Entity> removals;
@@ -1415,10 +1384,12 @@ Entity createBuffPopup(BUFF_TYPE type)
 		PopupWithImage(
 			createText(buff_test.first, imageCoordToTextCoord(buffImageMotion.position) + vec2(buffImageMotion.scale.x, 0) + vec2(BUFF_POPUP_GAP, 0), { 1.0f, 1.0f, 1.0f }, 0.5),
 			createText(buff_test.second, imageCoordToTextCoord(buffImageMotion.position) + vec2(buffImageMotion.scale.x, 0) + vec2(BUFF_POPUP_GAP, -25), { 1.0f, 1.0f, 1.0f }, 0.3),
-			buffImage,
-			POPUP_DURATION
+			buffImage
 		)
 	);
+	ui_expiries.schedule(buffPopup, POPUP_DURATION, [](Entity e) {
+		removePopups([e](Entity& entity) { return entity == e; });
+	});
 
 	return buffPopup;
 }
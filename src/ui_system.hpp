@@ -62,7 +62,6 @@ Entity createShopBox();
 Entity createShopPlate(vec2 pos);
 Entity createClickableShopBuff(vec2 position, BUFF_TYPE buffType);
 
-void updatePopups(float elapsed_ms_since_last_update);
 void removePopups(std::function<bool(Entity&)> shouldRemove);
 Entity createBuffPopup(BUFF_TYPE type);
 vec2 imageCoordToTextCoord(vec2 imageCoord);
\ No newline at end of file
@@ -0,0 +1,108 @@
+#include "visibility_grid.hpp"
+
+#include <algorithm>
+#include <cfloat>
+
+// cells are at least this big, smaller ones only add bucket overhead
+static const float MIN_CELL_SIZE_PX = 4 * GRID_CELL_WIDTH_PX;
+// cap on cells per axis, bounds the memory of very spread out levels
+static const int MAX_CELLS_PER_AXIS = 64;
+
+void VisibilityGrid::clear()
+{
+	items.clear();
+}
+
+void VisibilityGrid::insert(Entity entity, vec2 min, vec2 max)
+{
+	items.push_back({entity, min, max});
+}
+
+ivec2 VisibilityGrid::cellOf(vec2 position) const
+{
+	ivec2 cell = ivec2(floor((position - origin) / cell_size));
+	return clamp(cell, ivec2(0), cells - 1);
+}
+
+void VisibilityGrid::build()
+{
+	vec2 bounds_min = {FLT_MAX, FLT_MAX};
+	vec2 bounds_max = {-FLT_MAX, -FLT_MAX};
+	for (const Item &item : items)
+	{
+		bounds_min = glm::min(bounds_min, item.min);
+		bounds_max = glm::max(bounds_max, item.max);
+	}
+
+	if (items.empty())
+	{
+		bounds_min = {0.f, 0.f};
+		bounds_max = {0.f, 0.f};
+	}
+
+	const vec2 extent = bounds_max - bounds_min;
+	origin = bounds_min;
+	cell_size = std::max({MIN_CELL_SIZE_PX, extent.x / MAX_CELLS_PER_AXIS, extent.y / MAX_CELLS_PER_AXIS});
+	cells = glm::max(ivec2(ceil(extent / cell_size)), ivec2(1));
+
+	// counting sort of the items into their cells, an item spanning several cells is in each of them
+	cell_start.assign(cells.x * cells.y + 1, 0);
+	for (const Item &item : items)
+	{
+		ivec2 low = cellOf(item.min);
+		ivec2 high = cellOf(item.max);
+		for (int y = low.y; y <= high.y; y++)
+			for (int x = low.x; x <= high.x; x++)
+				cell_start[y * cells.x + x + 1]++;
+	}
+	for (size_t i = 1; i < cell_start.size(); i++)
+		cell_start[i] += cell_start[i - 1];
+
+	cell_items.resize(cell_start.back());
+	std::vector<uint32_t> fill(cell_start.begin(), cell_start.end() - 1);
+	for (uint32_t i = 0; i < items.size(); i++)
+	{
+		ivec2 low = cellOf(items[i].min);
+		ivec2 high = cellOf(items[i].max);
+		for (int y = low.y; y <= high.y; y++)
+			for (int x = low.x; x <= high.x; x++)
+				cell_items[fill[y * cells.x + x]++] = i;
+	}
+
+	item_stamp.assign(items.size(), 0);
+	stamp = 0;
+}
+
+void VisibilityGrid::query(vec2 min, vec2 max, std::vector<Entity> &entities)
+{
+	entities.clear();
+	found.clear();
+	stamp++;
+
+	ivec2 low = cellOf(min);
+	ivec2 high = cellOf(max);
+	for (int y = low.y; y <= high.y; y++)
+	{
+		for (int x = low.x; x <= high.x; x++)
+		{
+			const int cell = y * cells.x + x;
+			for (uint32_t slot = cell_start[cell]; slot < cell_start[cell + 1]; slot++)
+			{
+				const uint32_t i = cell_items[slot];
+				if (item_stamp[i] == stamp)
+					continue;
+				item_stamp[i] = stamp;
+
+				const Item &item = items[i];
+				if (item.max.x < min.x || item.min.x > max.x || item.max.y < min.y || item.min.y > max.y)
+					continue;
+				found.push_back(i);
+			}
+		}
+	}
+
+	// items are inserted in submission order, hand them back the same way
+	std::sort(found.begin(), found.end());
+	for (uint32_t i : found)
+		entities.push_back(items[i].entity);
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "common.hpp"
+#include "tinyECS/tiny_ecs.hpp"
+
+#include <cstdint>
+#include <vector>
+
+// Uniform grid over axis aligned boxes, rebuilt every frame by the renderer's culling pass.
+// Items are bucketed into the cells they overlap so a query only looks at the items
+// in the cells under the query rectangle.
+class VisibilityGrid
+{
+public:
+	void clear();
+
+	void insert(Entity entity, vec2 min, vec2 max);
+
+	// buckets the inserted items, call once after the last insert
+	void build();
+
+	// entities overlapping [min, max], each once and in insertion order
+	void query(vec2 min, vec2 max, std::vector<Entity> &entities);
+
+	size_t size() const { return items.size(); }
+
+private:
+	struct Item
+	{
+		Entity entity;
+		vec2 min;
+		vec2 max;
+	};
+
+	ivec2 cellOf(vec2 position) const;
+
+	std::vector<Item> items;
+	vec2 origin = {0.f, 0.f};
+	float cell_size = 1.f;
+	ivec2 cells = {0, 0};
+	std::vector<uint32_t> cell_start; // cells.x * cells.y + 1 offsets into cell_items
+	std::vector<uint32_t> cell_items;
+	std::vector<uint32_t> item_stamp; // last query that reported the item
+	uint32_t stamp = 0;
+	std::vector<uint32_t> found;
+};
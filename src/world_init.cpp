@@ -5,6 +5,7 @@
 #include <ctime>
 #include <queue>
 #include "animation_system.hpp"
+#include "entity_pool.hpp"
 #include "ui_system.hpp"
 
 void initializeProgression(){
@@ -59,10 +60,7 @@ Entity createRBCEnemy(RenderSystem* renderer, vec2 position)
 	);
 
 	Animation& a = registry.animations.emplace(entity);
-	a.start_frame = 0;
-	a.end_frame = 13;
-	a.time_per_frame = 100.0f;
-	a.loop = ANIM_LOOP_TYPES::LOOP;
+	a.clip = animation_clips.clipId({ 0, 13, 100.0f, ANIM_LOOP_TYPES::LOOP });
 
 	SpriteSheetImage& spriteSheet = registry.spriteSheetImages.emplace(entity);
 	spriteSheet.total_frames = 14;
@@ -97,10 +95,7 @@ Entity createSpikeEnemy(RenderSystem* renderer, vec2 position)
 	);
 
 	Animation& a = registry.animations.emplace(entity);
-	a.start_frame = 0;
-	a.end_frame = 6;
-	a.time_per_frame = 100.0f;
-	a.loop = ANIM_LOOP_TYPES::PING_PONG;
+	a.clip = animation_clips.clipId({ 0, 6, 100.0f, ANIM_LOOP_TYPES::PING_PONG });
 
 	SpriteSheetImage& spriteSheet = registry.spriteSheetImages.emplace(entity);
 	spriteSheet.total_frames = 13;
@@ -132,10 +127,7 @@ Entity createBacteriophage(RenderSystem* renderer, vec2 position, int placement_
 	);
 
 	Animation& a = registry.animations.emplace(entity);
-	a.start_frame = 0;
-	a.end_frame = 9;
-	a.time_per_frame = 100.0f;
-	a.loop = ANIM_LOOP_TYPES::PING_PONG;
+	a.clip = animation_clips.clipId({ 0, 9, 100.0f, ANIM_LOOP_TYPES::PING_PONG });
 
 	SpriteSheetImage& spriteSheet = registry.spriteSheetImages.emplace(entity);
 	spriteSheet.total_frames = 9;
@@ -169,10 +161,7 @@ Entity createDenderite(RenderSystem* renderer, vec2 position)
 	motion.scale = DENDERITE_SIZE;
 
 	Animation& a = registry.animations.emplace(entity);
-	a.start_frame = 0;
-	a.end_frame = 6;
-	a.time_per_frame = 100.0f;
-	a.loop = ANIM_LOOP_TYPES::PING_PONG;
+	a.clip = animation_clips.clipId({ 0, 6, 100.0f, ANIM_LOOP_TYPES::PING_PONG });
 
 	SpriteSheetImage& spriteSheet = registry.spriteSheetImages.emplace(entity);
 	spriteSheet.total_frames = 6;
@@ -194,7 +183,6 @@ Entity createBoss(RenderSystem* renderer, vec2 position, BossState state, int bo
 
 	BossAI& enemy_ai = registry.bossAIs.emplace(entity);
 	enemy_ai.state = state;
-	enemy_ai.cool_down = 2000.f;
 	enemy_ai.detectionRadius = BOSS_DETECTION_RADIUS;
 	enemy_ai.projectile_size = BOSS_PROJECTILE;
 	enemy_ai.stage = bossStage;
@@ -230,10 +218,12 @@ Entity createBoss(RenderSystem* renderer, vec2 position, BossState state, int bo
 	);
 
 	Animation& a = registry.animations.emplace(entity);
-	a.start_frame = 0;
-	a.end_frame = bossStage == 0 ? 7 : (bossStage == 1 ? 9 : 8);
-	a.time_per_frame = 100.0f;
-	a.loop = (bossStage <= 1) ? ANIM_LOOP_TYPES::LOOP : ANIM_LOOP_TYPES::PING_PONG;
+	a.clip = animation_clips.clipId({
+		0,
+		bossStage == 0 ? 7 : (bossStage == 1 ? 9 : 8),
+		100.0f,
+		(bossStage <= 1) ? ANIM_LOOP_TYPES::LOOP : ANIM_LOOP_TYPES::PING_PONG
+	});
 
 	SpriteSheetImage& spriteSheet = registry.spriteSheetImages.emplace(entity);
 	spriteSheet.total_frames = bossStage == 0 ? 7 : (bossStage == 1 ? 9 : 8);
@@ -271,6 +261,7 @@ Entity createPlayer(RenderSystem *renderer, vec2 position)
 
 	// new tower
 	auto &p = registry.players.emplace(entity);
+	p.next_heal.start(p.default_healing_timer);
 
 	// Store a reference to the potentially re-used mesh object (the value is stored in the resource cache)
 	Mesh &mesh = renderer->getMesh(GEOMETRY_BUFFER_ID::SPRITE);
@@ -297,7 +288,7 @@ Entity createPlayer(RenderSystem *renderer, vec2 position)
 	spriteSheet.total_frames = total_player_frames;
 
 	Animation &a = registry.animations.emplace(entity);
-	a.time_per_frame = MS_PER_S / total_player_frames;
+	a.clip = animation_clips.clipId({ player_idle_start, player_idle_end, MS_PER_S / total_player_frames, ANIM_LOOP_TYPES::PING_PONG });
 	toggleDashAnimation(entity, false);
 
 	SpriteSize &sprite = registry.spritesSizes.emplace(entity);
@@ -356,10 +347,7 @@ Entity createGun(RenderSystem *renderer, vec2 position) {
     );
 
 	Animation& a = registry.animations.emplace(entity);
-	a.start_frame = 0;
-	a.end_frame = 9;
-	a.time_per_frame = 100.0f;
-	a.loop = ANIM_LOOP_TYPES::LOOP;
+	a.clip = animation_clips.clipId({ 0, 9, 100.0f, ANIM_LOOP_TYPES::LOOP });
 
 	SpriteSheetImage& spriteSheet = registry.spriteSheetImages.emplace(entity);
 	spriteSheet.total_frames = 9;
@@ -373,94 +361,118 @@ Entity createGun(RenderSystem *renderer, vec2 position) {
     return entity;
 }
 
-Entity createProjectile(vec2 pos, vec2 size, vec2 velocity, float damage)
+// The components every projectile has, taken from the archetype's pool when one is parked there.
+// A reused projectile also still has its archetype's own components, reused tells the caller to skip those.
+static Entity spawnProjectile(PROJECTILE_ARCHETYPE archetype, vec2 pos, vec2 size, vec2 velocity, float damage, bool& reused)
 {
-	auto entity = Entity();
-	auto &p = registry.projectiles.emplace(entity);
+	Entity entity = projectile_pools[(int)archetype].acquire(reused);
+	if (!reused)
+	{
+		registry.projectiles.emplace(entity);
+		registry.motions.emplace(entity);
+		// registry.debugComponents.emplace(entity); // Causes it to not run kinda?
+		registry.deadlys.emplace(entity);
+		registry.renderRequests.emplace(entity);
+	}
+
+	Projectile &p = registry.projectiles.get(entity);
+	p = Projectile{};
 	p.damage = damage;
+	p.archetype = archetype;
 
 	// Mesh& mesh = renderer->getMesh(GEOMETRY_BUFFER_ID::SPRITE);
 	// registry.meshPtrs.emplace(entity, &mesh);
 
 	// Create motion
-	Motion &motion = registry.motions.emplace(entity);
-	motion.angle = 0.f;
-	motion.velocity = velocity; // velocity;
+	Motion &motion = registry.motions.get(entity);
+	motion = Motion{};
+	motion.velocity = velocity;
 	motion.position = pos;
 	motion.scale = size;
 
-	// registry.debugComponents.emplace(entity); // Causes it to not run kinda?
-	registry.deadlys.emplace(entity);
-
-	registry.renderRequests.insert(
-		entity,
+	registry.renderRequests.get(entity) =
 		{TEXTURE_ASSET_ID::PROJECTILE,
 		 EFFECT_ASSET_ID::TEXTURED,
-		 GEOMETRY_BUFFER_ID::SPRITE});
+		 GEOMETRY_BUFFER_ID::SPRITE};
+
+	despawnProjectileAfter(entity, PROJECTILE_TTL_MS);
 
 	return entity;
 }
 
+Entity createProjectile(vec2 pos, vec2 size, vec2 velocity, float damage)
+{
+	bool reused;
+	return spawnProjectile(PROJECTILE_ARCHETYPE::PLAIN, pos, size, velocity, damage, reused);
+}
+
+void despawnProjectileAfter(Entity projectile, float ms)
+{
+	world_expiries.schedule(projectile, ms, [](Entity e) {
+		if (registry.projectiles.has(e))
+			releaseProjectile(e);
+	});
+}
+
+void releaseProjectile(Entity projectile)
+{
+	Projectile &p = registry.projectiles.get(projectile);
+	// already parked, a projectile can hit more than one thing in a frame
+	if (!p.active)
+		return;
+
+	world_expiries.cancel(projectile);
+	if (!projectile_pools[(int)p.archetype].release(projectile))
+	{
+		registry.remove_all_components_of(projectile);
+		return;
+	}
+	p.active = false;
+	registry.motions.get(projectile).velocity = {0.f, 0.f};
+	registry.renderRequests.get(projectile).visible = false;
+}
+
 Entity createBacteriophageProjectile(Entity& bacteriophage)
 {
 	Motion& motion = registry.motions.get(bacteriophage);
 	vec2 direction = vec2(cosf((motion.angle - 90) * (M_PI / 180)), sinf((motion.angle - 90) * (M_PI / 180)));
 	vec2 projectile_pos = motion.position + (motion.scale * direction);
 	vec2 projectile_velocity = direction * PROJECTILE_SPEED;
-	Entity projectile = createProjectile(projectile_pos, { PROJECTILE_BB_WIDTH, PROJECTILE_BB_HEIGHT }, projectile_velocity, PROJECTILE_DAMAGE);;
-	registry.bacteriophageProjectiles.emplace(projectile);
+	bool reused;
+	Entity projectile = spawnProjectile(PROJECTILE_ARCHETYPE::BACTERIOPHAGE, projectile_pos, { PROJECTILE_BB_WIDTH, PROJECTILE_BB_HEIGHT }, projectile_velocity, PROJECTILE_DAMAGE, reused);
+	if (!reused)
+		registry.bacteriophageProjectiles.emplace(projectile);
 	return projectile;
 }
 
-Entity createBossProjectile(vec2 position, vec2 size, vec2 velocity)
+Entity createFinalBossProjectile(vec2 position, vec2 size, vec2 velocity)
 {
-	Entity projectile = createProjectile(position, size, velocity);
-	RenderRequest& render_request = registry.renderRequests.get(projectile);
-	render_request.used_texture = TEXTURE_ASSET_ID::BOSS_PROJECTILE;
-	Projectile& p = registry.projectiles.get(projectile);
-	p.damage = BOSS_PROJECTILE_DAMAGE;
-	registry.bossProjectiles.emplace(projectile);
-
-	return projectile;
-}
+	bool reused;
+	Entity projectile = spawnProjectile(PROJECTILE_ARCHETYPE::FINAL_BOSS_EYEBALL, position, size, velocity * 2.f, BOSS_PROJECTILE_DAMAGE, reused);
+	despawnProjectileAfter(projectile, 15000.f);
 
-Entity createFinalBossProjectile(vec2 position, vec2 size, vec2 velocity, int phase)
-{
-	Entity projectile = createProjectile(position, size, velocity);
 	RenderRequest& render_request = registry.renderRequests.get(projectile);
-	render_request.used_texture = TEXTURE_ASSET_ID::BOSS_PROJECTILE;
-	Projectile& p = registry.projectiles.get(projectile);
-	p.damage = BOSS_PROJECTILE_DAMAGE;
-	p.ms_until_despawn = 7500.f;
-
-	registry.finalBossProjectiles.emplace(projectile);
-
-	if (phase == 2) {
-		registry.spiralProjectiles.emplace(projectile);
-	} else if (phase == 3) {
-		p.ms_until_despawn = 15000.f;
-		Motion& motion = registry.motions.get(projectile);
-		motion.velocity *= 2.f;
+	render_request.used_texture = TEXTURE_ASSET_ID::EYE_BALL_PROJECTILE;
+	render_request.used_effect = EFFECT_ASSET_ID::SPRITE_SHEET;
 
+	if (!reused) {
+		registry.finalBossProjectiles.emplace(projectile);
 		registry.followingProjectiles.emplace(projectile);
-		render_request.used_texture = TEXTURE_ASSET_ID::EYE_BALL_PROJECTILE;
-		render_request.used_effect = EFFECT_ASSET_ID::SPRITE_SHEET;
-
-		Animation& a = registry.animations.emplace(projectile);
-		a.start_frame = 0;
-		a.end_frame = 8;
-		a.time_per_frame = 100.0f;
-		a.loop = ANIM_LOOP_TYPES::LOOP;
+		registry.animations.emplace(projectile);
 
 		SpriteSheetImage& spriteSheet = registry.spriteSheetImages.emplace(projectile);
 		spriteSheet.total_frames = 9;
-		spriteSheet.current_frame = 0;
 
 		SpriteSize& sprite = registry.spritesSizes.emplace(projectile);
 		sprite.width = 32.f;
 		sprite.height = 32.f;
 	}
 
+	Animation& a = registry.animations.get(projectile);
+	a = Animation{};
+	a.clip = animation_clips.clipId({ 0, 8, 100.0f, ANIM_LOOP_TYPES::LOOP });
+	registry.spriteSheetImages.get(projectile).current_frame = 0;
+
 	return projectile;
 }
 
@@ -530,10 +542,7 @@ Entity createFinalBoss(RenderSystem* renderer, vec2 position) {
 	);
 
 	Animation& a = registry.animations.emplace(entity);
-	a.start_frame = 8;
-	a.end_frame = 10;
-	a.time_per_frame = 100.0f;
-	a.loop = ANIM_LOOP_TYPES::LOOP;
+	a.clip = animation_clips.clipId({ 8, 10, 100.0f, ANIM_LOOP_TYPES::LOOP });
 
 	SpriteSheetImage& spriteSheet = registry.spriteSheetImages.emplace(entity);
 	spriteSheet.total_frames = 14;
@@ -622,7 +631,10 @@ void updateMiniMap(vec2 playerPos) {
 
 	for(int i = left; i < right; i++) {
 		for(int j = top; j < bottom; j++) {
-			m.visited[i][j] = 1;
+			if (m.visited[i][j] == 0) {
+				m.visited[i][j] = 1;
+				m.markChanged(i, j);
+			}
 		}
 	}
 }
@@ -634,6 +646,8 @@ void emptyMiniMap() {
 			m.visited[y][x] = 0;
 		}
 	}
+	// called whenever a new map is made, so the tiles need uploading too
+	m.upload_all = true;
 }
 
 Entity createProceduralMap(RenderSystem* renderer, vec2 size, bool tutorial_on, std::pair<int, int>& playerPosition) {
@@ -832,11 +846,7 @@ Entity addPortalTile(vec2 gridCoord) {
     portal.grid_y = gridCoord.y;
 
     Animation &a = registry.animations.emplace(tile);
-    a.time_per_frame = MS_PER_S / total_portal_frames;
-    a.loop = ANIM_LOOP_TYPES::LOOP;
-    a.start_frame = 0;
-    a.end_frame =
-     total_portal_frames;
+    a.clip = animation_clips.clipId({ 0, total_portal_frames, MS_PER_S / total_portal_frames, ANIM_LOOP_TYPES::LOOP });
 
     return tile;
 }
@@ -1143,34 +1153,46 @@ void damagePlayer(float damageAmount) {
 	}
 }
 
+// the end of an effect's animation, parks it for the next createEffect
+static void releaseEffect(Entity effect)
+{
+    // removed with everything else on a restart
+    if (!registry.effects.has(effect))
+        return;
+    if (!effect_pool.release(effect))
+    {
+        registry.remove_all_components_of(effect);
+        return;
+    }
+    registry.renderRequests.get(effect).visible = false;
+}
+
 Entity createEffect(TEXTURE_ASSET_ID texture, vec2 position, vec2 scale, int total_frames) {
-    Entity entity = Entity();
+    bool reused;
+    Entity entity = effect_pool.acquire(reused);
+    if (!reused) {
+        registry.motions.emplace(entity);
+        registry.renderRequests.emplace(entity);
+        registry.spriteSheetImages.emplace(entity);
+        registry.spritesSizes.emplace(entity);
+        registry.effects.emplace(entity);
+    }
 
-    Motion& motion = registry.motions.emplace(entity);
+    Motion& motion = registry.motions.get(entity);
+    motion = Motion{};
     motion.position = position;
     motion.scale = scale;
 
-    registry.renderRequests.insert(
-        entity,
+    registry.renderRequests.get(entity) =
         { texture, 
 		EFFECT_ASSET_ID::SPRITE_SHEET, 
-		GEOMETRY_BUFFER_ID::SPRITE});
+		GEOMETRY_BUFFER_ID::SPRITE};
 
-    Animation& animation = registry.animations.emplace(entity);
-    animation.start_frame = 0;
-    animation.end_frame = total_frames - 1;
-    animation.time_per_frame = 50.f;
-    animation.loop = ANIM_LOOP_TYPES::NO_LOOP;
+    playAnimation(entity, animation_clips.clipId({ 0, total_frames - 1, 50.f, ANIM_LOOP_TYPES::NO_LOOP }), releaseEffect);
 
-    SpriteSheetImage& spriteSheet = registry.spriteSheetImages.emplace(entity);
+    SpriteSheetImage& spriteSheet = registry.spriteSheetImages.get(entity);
     spriteSheet.total_frames = total_frames;
     spriteSheet.current_frame = 0;
 
-    SpriteSize& sprite = registry.spritesSizes.emplace(entity);
-
-	Effect& effect = registry.effects.emplace(entity);
-    effect.death_timer_ms = animation.time_per_frame * total_frames;
-
-
     return entity;
 }
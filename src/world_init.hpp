@@ -21,9 +21,13 @@ Entity createGun(RenderSystem *renderer, vec2 position);
 
 // projectile
 Entity createProjectile(vec2 pos, vec2 size, vec2 velocity, float damage = PROJECTILE_DAMAGE);
+// replaces the projectile's lifetime, createProjectile gives it PROJECTILE_TTL_MS of game time
+void despawnProjectileAfter(Entity projectile, float ms);
+// parks a dead projectile in its pool for the next create*Projectile, safe to call again in the same frame
+void releaseProjectile(Entity projectile);
 Entity createBacteriophageProjectile(Entity& bacteriophage);
-Entity createBossProjectile(vec2 position, vec2 size, vec2 velocity);
-Entity createFinalBossProjectile(vec2 position, vec2 size, vec2 velocity, int phase);
+// the final boss's homing eyeballs, its rings are enemy_bullets patterns (bullet_patterns.hpp)
+Entity createFinalBossProjectile(vec2 position, vec2 size, vec2 velocity);
 Entity createBossArrow(Entity Boss);
 
 Entity createCamera();
@@ -17,6 +17,8 @@
 #include "physics_system.hpp"
 #include "particle_system.hpp"
 #include "animation_system.hpp"
+#include "entity_pool.hpp"
+#include "bullet_patterns.hpp"
 #include "ui_system.hpp"
 
 
@@ -195,12 +197,13 @@ bool WorldSystem::start_and_load_sounds()
 }
 
 
-void WorldSystem::init(RenderSystem *renderer_arg)
+void WorldSystem::init(RenderSystem *renderer_arg, ParticleSystem *particle_system_arg)
 {
 	// Either load progression or create a progression entity
 	initializeProgression();
 
 	this->renderer = renderer_arg;
+	this->particle_system = particle_system_arg;
 
 	// // start playing background music indefinitely
 	// // std::cout << "Starting music..." << std::endl;
@@ -413,15 +416,21 @@ void WorldSystem::spawnEnemies(float elapsed_ms_since_last_update)
 
 void WorldSystem::handleProjectiles(float elapsed_ms_since_last_update)
 {
-	for (int i = 0; i < registry.projectiles.entities.size(); i++)
-	{
-		Projectile& projectile = registry.projectiles.get(registry.projectiles.entities[i]);
-		projectile.ms_until_despawn -= elapsed_ms_since_last_update * current_speed;
+	// despawn the projectiles whose time is up, see despawnProjectileAfter
+	world_expiries.advance(elapsed_ms_since_last_update * current_speed);
 
-		if (projectile.ms_until_despawn < 0.0f)
+	// boss rings and enemy shots, tested against the player here rather than in the physics pass
+	enemy_bullets.step(elapsed_ms_since_last_update * current_speed);
+	if (registry.players.size() != 0)
+	{
+		Motion& player_motion = registry.motions.get(registry.players.entities[0]);
+		bullet_hits.clear();
+		enemy_bullets.collide(player_motion.position, abs(player_motion.scale.x), bullet_hits);
+		for (const BulletHit& hit : bullet_hits)
 		{
-			
-			registry.remove_all_components_of(registry.projectiles.entities[i]);
+			createEffect(TEXTURE_ASSET_ID::BACTERIOPHAGE_ENEMY_PROJECTILE_EFFECT, hit.position, hit.size * 1.3f, 4);
+			damagePlayer(hit.damage);
+			Mix_PlayChannel(-1, damage_sound, 0);
 		}
 	}
 
@@ -497,6 +506,9 @@ bool WorldSystem::step(float elapsed_ms_since_last_update)
 	}
 
 
+	// every Deadline is measured against this, see game_time.hpp
+	advanceGameTime(elapsed_ms_since_last_update * current_speed);
+
 	// // std::cout << "Level : " << level << std::endl;
 	updateDangerLevel(elapsed_ms_since_last_update);
 	updateCamera(elapsed_ms_since_last_update);
@@ -504,7 +516,8 @@ bool WorldSystem::step(float elapsed_ms_since_last_update)
     updateMouseCoords(); 
 	updateHuds();
 
-	updatePopups(elapsed_ms_since_last_update);
+	// popups run on real time
+	ui_expiries.advance(elapsed_ms_since_last_update);
 
 	handlePlayerMovement(elapsed_ms_since_last_update);
 	handlePlayerHealth(elapsed_ms_since_last_update);
@@ -606,16 +619,6 @@ bool WorldSystem::step(float elapsed_ms_since_last_update)
 
     handleVignetteEffect(elapsed_ms_since_last_update);
 
-	// step the particle system only when its needed
-	// for optimaztion, we could only step the particles that are on screen
-	particle_system.step(elapsed_ms_since_last_update);
-
-    // update gun cooldown
-    Gun &gun = registry.guns.get(registry.guns.entities[0]);
-    if (gun.cooldown_timer_ms > 0.0f) {
-        gun.cooldown_timer_ms -= elapsed_ms_since_last_update;
-    }
-
     // update gun position to match player
     Motion &player_motion = registry.motions.get(registry.players.entities[0]);
     Motion &gun_motion = registry.motions.get(registry.guns.entities[0]);
@@ -635,8 +638,7 @@ void WorldSystem::handleVignetteEffect(float elapsed_ms_since_last_update) {
     Entity screen_state_entity = renderer->get_screen_state_entity();
     ScreenState &screen = registry.screenStates.get(screen_state_entity);
     if (screen.vignette_screen_factor > 0) {
-        screen.vignette_timer_ms -= elapsed_ms_since_last_update;
-        if (screen.vignette_timer_ms <= 0) {
+        if (screen.vignette_hold.due()) {
             screen.vignette_screen_factor -= elapsed_ms_since_last_update / 1000;
             if (screen.vignette_screen_factor < 0) {
                 screen.vignette_screen_factor = 0;
@@ -653,10 +655,9 @@ void WorldSystem::handlePlayerHealth(float elapsed_ms)
 
 	// handle regeneration
 	// heal every second
-	player.healing_timer_ms -= elapsed_ms;
-	if (player.healing_timer_ms <= 0 && player.current_health < player.max_health)
+	if (player.next_heal.due() && player.current_health < player.max_health)
 	{
-		player.healing_timer_ms = player.default_healing_timer;
+		player.next_heal.start(player.default_healing_timer);
 		player.current_health += player.max_health * player.healing_rate;
 		if (player.current_health > player.max_health)
 		{
@@ -697,7 +698,7 @@ void WorldSystem::handlePlayerMovement(float elapsed_ms_since_last_update) {
 	
 	Player &player = registry.players.get(registry.players.entities[0]);
 
-	if (player.knockback_duration > 0.0f) {
+	if (!player.knockback.due()) {
 		return;
 	}
 
@@ -824,6 +825,13 @@ void WorldSystem::restart_game()
 	// screen.darken_screen_factor = -1; // FLAG doesnt seem to help
 
 	registry.deathTimers.clear(); // this seems to work
+	// what was going to expire is removed below anyway
+	world_expiries.clear();
+	ui_expiries.clear();
+	clearEntityPools();
+	// particles and bullets aren't entities, they go separately
+	particle_system->clear();
+	enemy_bullets.clear();
 	// Remove all entities that we created
 	// All that have a motion, we could also iterate over all bug, eagles, ... but that would be more cumbersome
 	while (registry.motions.entities.size() > 0)
@@ -1071,7 +1079,7 @@ void WorldSystem::handle_collisions()
 						createBuffWithChanceToFail(vec2(enemy_position.x, enemy_position.y));
 					}
 					
-					particle_system.createParticles(PARTICLE_TYPE::DEATH_PARTICLE, enemy_position, 15); 
+					particle_system->createParticles(PARTICLE_TYPE::DEATH_PARTICLE, enemy_position); 
                     removals.push_back(entity2);
 
 					
@@ -1102,7 +1110,7 @@ void WorldSystem::handle_collisions()
                             SpikeEnemyAI &enemy_ai = registry.spikeEnemyAIs.get(entity2);
                             
                             enemy_ai.state = SpikeEnemyState::KNOCKBACK;
-                            enemy_ai.knockbackTimer = SPIKE_ENEMY_KNOCKBACK_TIMER;
+                            enemy_ai.knockback.start(SPIKE_ENEMY_KNOCKBACK_TIMER);
                             
                             vec2 knockback_direction = normalize(enemy_motion.position - player_motion.position);
                             enemy_motion.velocity = knockback_direction * SPIKE_ENEMY_KNOCKBACK_STRENGTH;
@@ -1121,7 +1129,7 @@ void WorldSystem::handle_collisions()
 							vec2 new_velocity = glm::length(playerMotion.velocity) > 0.1f ? playerMotion.velocity : vec2(0, 5.f);
 
 							playerMotion.velocity = -1.f * glm::normalize(new_velocity) * PLAYER_DASH_SPEED * 2.f;
-							player.knockback_duration = 500.f;
+							player.knockback.start(500.f);
 						}
 
 						if (registry.finalBossAIs.has(entity2)) {
@@ -1138,7 +1146,7 @@ void WorldSystem::handle_collisions()
 							vec2 new_velocity = glm::length(playerMotion.velocity) > 0.1f ? playerMotion.velocity : vec2(0, 5.f);
 
 							playerMotion.velocity = -1.f * glm::normalize(new_velocity) * PLAYER_DASH_SPEED * 2.f;
-							player.knockback_duration = 500.f;
+							player.knockback.start(500.f);
 						}
                     }
 				} 
@@ -1177,7 +1185,7 @@ void WorldSystem::handle_collisions()
                             Mix_PlayChannel(-1, damage_sound, 0);
 						}
 
-						if (player.knockback_duration > 0.f )
+						if (!player.knockback.due())
 						{
 							vec2 bossDirection = glm::length(bossMotion.velocity) > 0.0001f
 							? glm::normalize(bossMotion.velocity)
@@ -1252,7 +1260,7 @@ void WorldSystem::handle_collisions()
 					if (level != FINAL_BOSS_LEVEL) {
 						createBuff(vec2(enemy_position.x, enemy_position.y));
 					}
-                    particle_system.createParticles(PARTICLE_TYPE::DEATH_PARTICLE, enemy_position, 15);
+                    particle_system->createParticles(PARTICLE_TYPE::DEATH_PARTICLE, enemy_position);
                 } 
 			
 			}
@@ -1268,7 +1276,11 @@ void WorldSystem::handle_collisions()
     int size = removals.size();
 
     for (int i = 0; i < size; i ++) {
-        registry.remove_all_components_of(removals[i]);
+        // projectiles are parked for reuse instead
+        if (registry.projectiles.has(removals[i]))
+            releaseProjectile(removals[i]);
+        else
+            registry.remove_all_components_of(removals[i]);
     }
     
 	// Remove all collisions from this simulation step
@@ -1689,8 +1701,8 @@ void WorldSystem::shootGun() {
 
 	float base_angle_rad = glm::radians(180.f + gun_motion.angle);
 
-	if (gun.cooldown_timer_ms <= 0.0f) {
-        gun.cooldown_timer_ms = GUN_COOLDOWN_MS; // Reset cooldown
+	if (gun.cooldown.due()) {
+        gun.cooldown.start(GUN_COOLDOWN_MS); // Reset cooldown
 		Mix_PlayChannel(-1, player_shoot_sound, 0);
 
 		for(int i = 0; i < player.bulletsPerShot; i++) {
@@ -1983,13 +1995,13 @@ void WorldSystem::initiatePlayerDash()
 		player.dash_speed * cosf(angle_radians),
 		player.dash_speed * sinf(angle_radians)
 	};
-	d.timer_ms = DASH_DURATION_MS;
-	player.dash_cooldown_timer_ms = player.dash_cooldown_ms;
+	d.end.start(DASH_DURATION_MS);
+	player.dash_recharge.start(player.dash_cooldown_ms);
 
 	// Change animation frames
 	toggleDashAnimation(player_e, true);
 
-	particle_system.createParticles(PARTICLE_TYPE::RIPPLE_PARTICLE, player_motion.position, 4);
+	particle_system->createParticles(PARTICLE_TYPE::RIPPLE_PARTICLE, player_motion.position);
 }
 
 bool WorldSystem::canDash()
@@ -2062,6 +2074,7 @@ void WorldSystem::tileProceduralMap() {
 	}
 
 	initializedMap = true;
+	renderer->invalidateTileLayer();
 }
 
 void WorldSystem::handleRippleEffect(float elapsed_ms)
@@ -2073,8 +2086,8 @@ void WorldSystem::handleRippleEffect(float elapsed_ms)
     static float ripple_timer = 0.0f;
     ripple_timer += elapsed_ms;
     
-    if (ripple_timer >= 5.0f) {
-        particle_system.createPlayerRipples(player_entity);
+    if (ripple_timer >= particle_system->emitter(PARTICLE_TYPE::RIPPLE_PARTICLE).spawn_interval_ms) {
+        particle_system->createPlayerRipples(player_entity);
         ripple_timer = 0.0f;
     }
 }
@@ -2121,6 +2134,9 @@ void WorldSystem::saveGame() {
 	json motionsArray = json::array();
 	// make json array to contain motions for projectiles
 	for (auto e : projectileEntities) {
+		// parked ones aren't in the game
+		if (!registry.projectiles.get(e).active)
+			continue;
 		Motion& projectileMotion = registry.motions.get(e);
 		
 		json motionJson = json(projectileMotion);
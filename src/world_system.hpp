@@ -16,6 +16,7 @@
 #include "render_system.hpp"
 #include "particle_system.hpp"
 #include "physics_system.hpp"
+#include "bullet_patterns.hpp"
 
 class ParticleSystem;
 
@@ -50,7 +51,7 @@ public:
 	void close_window();
 
 	// starts the game
-	void init(RenderSystem *renderer);
+	void init(RenderSystem *renderer, ParticleSystem *particle_system);
 
 	// releases all associated resources
 	~WorldSystem();
@@ -153,8 +154,8 @@ private:
 	RenderSystem* renderer;
 	float current_speed;
 
-	// particle
-	ParticleSystem particle_system;
+	// particle, owned by main which also steps it
+	ParticleSystem* particle_system;
 
     // physics 
     PhysicsSystem physics_system;
@@ -162,6 +163,9 @@ private:
 	// grid
 	std::vector<Entity> grid_lines;
 
+	// enemy bullets that reached the player this step, kept to reuse its storage
+	std::vector<BulletHit> bullet_hits;
+
 	// music references
 	Mix_Music *background_music;
 	Mix_Music *boss_background_music;
@@ -0,0 +1,160 @@
+// Pins down the clip table, and checks AnimationSystem shows the same frames at any frame rate:
+// a second played as 60 steps of 16.6 ms and as 4 steps of 249 ms.
+
+#include "animation_system.hpp"
+#include "tinyECS/registry.hpp"
+
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+static int failures = 0;
+
+static void check(bool ok, const std::string& what)
+{
+	if (!ok)
+	{
+		std::cerr << "FAIL: " << what << std::endl;
+		failures++;
+	}
+}
+
+struct ClipCase
+{
+	const char* name;
+	AnimationClip clip;
+	int frame_count;
+	int period;
+	float wrap_ms;
+	// the frame at 249, 498, 747 and 996 ms
+	int frames[4];
+};
+
+// what the clips of the game look like, the spike enemy's ping pong among them
+static const ClipCase CLIPS[] = {
+	{"loop 0-5 at 100 ms", {0, 5, 100.f, ANIM_LOOP_TYPES::LOOP}, 6, 6, 600.f, {2, 4, 1, 3}},
+	{"ping pong 0-6 at 100 ms", {0, 6, 100.f, ANIM_LOOP_TYPES::PING_PONG}, 7, 12, 1200.f, {2, 4, 5, 3}},
+	{"ping pong 3-4 at 120 ms", {3, 4, 120.f, ANIM_LOOP_TYPES::PING_PONG}, 2, 2, 240.f, {3, 3, 3, 3}},
+	{"no loop 2-4 at 50 ms", {2, 4, 50.f, ANIM_LOOP_TYPES::NO_LOOP}, 3, INT_MAX, INFINITY, {4, 4, 4, 4}},
+	{"single frame loop", {7, 7, 100.f, ANIM_LOOP_TYPES::LOOP}, 1, 1, 100.f, {7, 7, 7, 7}},
+	{"single frame ping pong", {7, 7, 100.f, ANIM_LOOP_TYPES::PING_PONG}, 1, 1, 100.f, {7, 7, 7, 7}},
+};
+static const int CLIP_COUNT = sizeof(CLIPS) / sizeof(CLIPS[0]);
+
+static void checkClipTable(std::vector<int>& ids)
+{
+	for (const ClipCase& c : CLIPS)
+	{
+		const int id = animation_clips.clipId(c.clip);
+		ids.push_back(id);
+		check(animation_clips.clipId(c.clip) == id, std::string(c.name) + ": an equal clip gets the same id");
+		check(animation_clips.start_frame[id] == c.clip.start_frame, std::string(c.name) + ": start frame");
+		check(animation_clips.frame_count[id] == c.frame_count, std::string(c.name) + ": frame count");
+		check(animation_clips.frame_ms[id] == c.clip.frame_ms, std::string(c.name) + ": frame time");
+		check(animation_clips.period[id] == c.period, std::string(c.name) + ": period " + std::to_string(animation_clips.period[id]));
+		check(animation_clips.wrap_ms[id] == c.wrap_ms, std::string(c.name) + ": wrap " + std::to_string(animation_clips.wrap_ms[id]));
+	}
+	check(animation_clips.size() == CLIP_COUNT, "one table entry per distinct clip");
+}
+
+// plays every clip for 996 ms in steps of step_ms, the frames at each quarter go to frames
+static void playClips(const std::vector<int>& ids, int steps_per_quarter, float step_ms, std::vector<std::vector<int>>& frames)
+{
+	std::vector<Entity> entities;
+	for (int id : ids)
+	{
+		Entity entity;
+		registry.spriteSheetImages.emplace(entity).total_frames = 8;
+		// the NO_LOOP clip would remove its entity when it ends
+		playAnimation(entity, id, [](Entity) {});
+		entities.push_back(entity);
+	}
+
+	AnimationSystem animations;
+	frames.assign(ids.size(), std::vector<int>());
+	for (int quarter = 0; quarter < 4; quarter++)
+	{
+		for (int s = 0; s < steps_per_quarter; s++)
+			animations.step(step_ms);
+		for (size_t c = 0; c < entities.size(); c++)
+		{
+			const int frame = registry.animations.get(entities[c]).frame;
+			frames[c].push_back(frame);
+			check(registry.spriteSheetImages.get(entities[c]).current_frame == frame,
+				std::string(CLIPS[c].name) + ": the sprite sheet shows the animation's frame");
+		}
+	}
+
+	for (Entity entity : entities)
+		registry.remove_all_components_of(entity);
+}
+
+int main()
+{
+	std::vector<int> ids;
+	checkClipTable(ids);
+
+	std::vector<std::vector<int>> at_60fps, at_4fps;
+	playClips(ids, 15, 16.6f, at_60fps);
+	playClips(ids, 1, 249.f, at_4fps);
+	for (int c = 0; c < CLIP_COUNT; c++)
+	{
+		for (int quarter = 0; quarter < 4; quarter++)
+		{
+			const std::string when = std::string(CLIPS[c].name) + " at " + std::to_string(249 * (quarter + 1)) + " ms: ";
+			check(at_60fps[c][quarter] == CLIPS[c].frames[quarter],
+				when + "frame " + std::to_string(at_60fps[c][quarter]) + " at 60 fps, expected " + std::to_string(CLIPS[c].frames[quarter]));
+			check(at_4fps[c][quarter] == at_60fps[c][quarter],
+				when + "frame " + std::to_string(at_4fps[c][quarter]) + " at 4 fps, " + std::to_string(at_60fps[c][quarter]) + " at 60 fps");
+		}
+	}
+
+	// a NO_LOOP clip ends after its frames have played, at any frame rate
+	const int no_loop = ids[3];
+	for (float step_ms : {16.6f, 249.f})
+	{
+		Entity entity;
+		registry.spriteSheetImages.emplace(entity);
+		int finished = 0;
+		playAnimation(entity, no_loop, [&finished](Entity) { finished++; });
+		AnimationSystem animations;
+		float played_ms = 0.f;
+		while (played_ms < 300.f)
+		{
+			animations.step(step_ms);
+			played_ms += step_ms;
+			check(finished == (played_ms >= 150.f ? 1 : 0),
+				"no loop clip at " + std::to_string(step_ms) + " ms steps: finished " + std::to_string(finished) + " times after " + std::to_string(played_ms) + " ms");
+		}
+		registry.remove_all_components_of(entity);
+	}
+
+	// looping clips wrap their time, even when a step is longer than the whole clip,
+	// so it stays exact however long they play
+	for (float step_ms : {16.6f, 249.f})
+	{
+		for (int c = 0; c < CLIP_COUNT; c++)
+		{
+			if (CLIPS[c].clip.loop == ANIM_LOOP_TYPES::NO_LOOP)
+				continue;
+			Entity looping;
+			registry.spriteSheetImages.emplace(looping);
+			playAnimation(looping, ids[c]);
+			AnimationSystem animations;
+			for (int s = 0; s < 10000; s++)
+				animations.step(step_ms);
+			check(registry.animations.get(looping).time_ms < animation_clips.wrap_ms[ids[c]],
+				std::string(CLIPS[c].name) + ": time stays within the period at " + std::to_string(step_ms) + " ms steps");
+			registry.remove_all_components_of(looping);
+		}
+	}
+
+	if (failures > 0)
+	{
+		std::cerr << failures << " animation checks failed" << std::endl;
+		return 1;
+	}
+	std::cout << "animation: frames match at 60 and 4 fps" << std::endl;
+	return 0;
+}
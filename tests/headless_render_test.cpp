@@ -0,0 +1,120 @@
+// Renders a scripted level through NullRenderBackend, without a window or GL context,
+// and checks the recorded frames batch, cull and cache the way the draw loop promises.
+
+#include "render_backend.hpp"
+#include "render_system.hpp"
+#include "tinyECS/registry.hpp"
+#include "ui_system.hpp"
+#include "world_init.hpp"
+
+#include <iostream>
+#include <string>
+#include <utility>
+
+static const int ONSCREEN_ENEMIES = 200;
+static const int OFFSCREEN_ENEMIES = 500;
+
+static int failures = 0;
+
+static void check(bool ok, const std::string& what)
+{
+	if (!ok)
+	{
+		std::cerr << "FAIL: " << what << std::endl;
+		failures++;
+	}
+}
+
+// the same tiles WorldSystem::tileProceduralMap lays down for a level
+static void tileMap()
+{
+	const ProceduralMap& map = registry.proceduralMaps.components[0];
+	for (int x = -3; x < 23; x++)
+	{
+		for (int y = -3; y < 23; y++)
+		{
+			vec2 grid_coord = {x, y};
+			if (x < map.left || x >= map.right || y < map.top || y >= map.bottom || map.map[x][y] == tileType::WALL)
+				addWallTile(grid_coord);
+			else
+				addParalaxTile(grid_coord);
+		}
+	}
+}
+
+// a level as WorldSystem::restart_game builds it, the player in the middle of the view
+static vec2 createScene(RenderSystem& renderer)
+{
+	std::pair<int, int> player_cell;
+	createProceduralMap(&renderer, vec2(MAP_WIDTH, MAP_HEIGHT), false, player_cell);
+	const vec2 player_position = gridCellToPosition(vec2(player_cell.second, player_cell.first));
+	createPlayer(&renderer, player_position);
+
+	Entity camera = createCamera();
+	registry.cameras.get(camera).position = player_position;
+	registry.cameras.get(camera).initialized = true;
+
+	createUIElement(NUCLEUS_UI_POS, vec2(NUCLEUS_UI_WIDTH, NUCLEUS_UI_HEIGHT), TEXTURE_ASSET_ID::NUCLEUS_UI, EFFECT_ASSET_ID::UI);
+	createHealthBar();
+	createThermometer();
+	createDashRecharge();
+	createGunCooldown();
+	createMiniMap(&renderer, vec2(MAP_WIDTH, MAP_HEIGHT));
+
+	tileMap();
+	renderer.invalidateTileLayer();
+	return player_position;
+}
+
+int main()
+{
+	NullRenderBackend backend;
+	RenderSystem renderer;
+	check(renderer.initHeadless(&backend), "headless init");
+
+	const vec2 player_position = createScene(renderer);
+
+	// the first frame uploads the tile layer, later frames of the same level reuse it
+	renderer.draw();
+	const RenderStats first = backend.lastFrame();
+	renderer.draw();
+	const RenderStats second = backend.lastFrame();
+	check(backend.frames() == 2, "one backend frame per draw()");
+	check(first.draw_calls > 0, "the level draws something");
+	check(second.upload_bytes < first.upload_bytes, "the static tile layer is not uploaded again");
+	check(second.draw_calls == first.draw_calls, "a still scene draws the same every frame");
+
+	// a crowd of enemies sharing a texture goes in one batch, however large it is,
+	// only their health bars take a draw each for their own health uniforms
+	createSpikeEnemy(&renderer, player_position + vec2(40.f, 0.f));
+	renderer.draw();
+	const RenderStats one_enemy = backend.lastFrame();
+	check(one_enemy.draw_calls > second.draw_calls, "an enemy on screen is drawn");
+	for (int i = 1; i < ONSCREEN_ENEMIES; i++)
+		createSpikeEnemy(&renderer, player_position + vec2(40.f + (i % 20) * 8.f, -80.f + (i / 20) * 16.f));
+	renderer.draw();
+	const RenderStats crowd = backend.lastFrame();
+	check(crowd.draw_calls - one_enemy.draw_calls == ONSCREEN_ENEMIES - 1, std::to_string(ONSCREEN_ENEMIES) + " enemy sprites on screen are batched in one draw");
+
+	// enemies far outside the view are culled before they cost anything, health bars included
+	for (int i = 0; i < OFFSCREEN_ENEMIES; i++)
+		createSpikeEnemy(&renderer, player_position + vec2(50000.f + i * 64.f, 50000.f));
+	renderer.draw();
+	const RenderStats culled = backend.lastFrame();
+	check(culled.draw_calls == crowd.draw_calls, "enemies off screen add no draws");
+	check(culled.upload_bytes == crowd.upload_bytes, "enemies off screen add no uploads");
+
+	check(backend.frames() == 5, "every draw() reached the backend");
+	check(backend.opCount(RENDER_OP::BEGIN_PASS) >= 2 * backend.frames(), "every frame goes through the off-screen buffer to the screen");
+	check(backend.total().draw_calls == first.draw_calls + second.draw_calls + one_enemy.draw_calls + crowd.draw_calls + culled.draw_calls,
+		"the totals add up the frames");
+
+	if (failures > 0)
+	{
+		std::cerr << failures << " headless render checks failed" << std::endl;
+		return 1;
+	}
+	std::cout << "headless render: " << first.draw_calls << " draws in the first frame, "
+		<< crowd.draw_calls << " with " << ONSCREEN_ENEMIES << " enemies on screen" << std::endl;
+	return 0;
+}
@@ -0,0 +1,128 @@
+// Steps the same particles with stepDeathParticles/stepRippleParticles and with their scalar
+// versions and checks every field agrees, frame after frame. Only built with PARTICLES_AVX2,
+// without it both calls run the same scalar code.
+
+#include "particle_emitters.hpp"
+#include "particle_kernels.hpp"
+#include "particle_pool.hpp"
+
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+
+static const int FRAMES = 240;
+// an odd range, so the 8-wide loop and the scalar tail both run
+static const int FIRST = 3;
+static const int PARTICLES = 4000;
+// sqrt and division may differ in the last bits, and the steering feeds them back into the velocity
+static const float TOLERANCE = 1e-4f;
+
+static int failures = 0;
+
+static void fail(const std::string& what)
+{
+	// one bad field usually breaks every particle after it, the first few are enough
+	if (failures < 20)
+		std::cerr << "FAIL: " << what << std::endl;
+	failures++;
+}
+
+static bool close(float a, float b)
+{
+	return std::fabs(a - b) <= TOLERANCE * std::fmax(1.f, std::fmax(std::fabs(a), std::fabs(b)));
+}
+
+// every branch of the kernels: bursts about to switch, followers close enough to stop steering
+// and fast enough to be clamped, fading particles and ones that expire during the run
+static void fillBucket(ParticleBucket& bucket, vec2 player_position, std::default_random_engine& rng)
+{
+	std::uniform_real_distribution<float> unit(0.f, 1.f);
+	bucket.clear();
+	for (int i = 0; i < PARTICLES; i++)
+	{
+		vec2 position = player_position + vec2(unit(rng) - 0.5f, unit(rng) - 0.5f) * 800.f;
+		if (i % 17 == 0)
+			position = player_position + vec2(unit(rng), unit(rng)) * 0.05f;
+		const int p = bucket.spawn(position);
+		bucket.velocity_x[p] = (unit(rng) - 0.5f) * (i % 5 == 0 ? 2000.f : 300.f);
+		bucket.velocity_y[p] = (unit(rng) - 0.5f) * (i % 5 == 0 ? 2000.f : 300.f);
+		bucket.spawn_size[p] = 10.f + unit(rng) * 20.f;
+		bucket.max_lifetime_ms[p] = 1000.f + unit(rng) * 3000.f;
+		bucket.lifetime_ms[p] = bucket.max_lifetime_ms[p] * unit(rng);
+		bucket.state[p] = (PARTICLE_STATE)(i % 3);
+		bucket.state_timer_ms[p] = unit(rng) * 500.f;
+		bucket.speed_factor[p] = 50.f + unit(rng) * 50.f;
+	}
+}
+
+static void compareBuckets(const ParticleBucket& a, const ParticleBucket& b, const char* type, int frame)
+{
+	const std::string where = std::string(type) + " frame " + std::to_string(frame);
+	const std::vector<float> ParticleBucket::*fields[] = {
+		&ParticleBucket::position_x, &ParticleBucket::position_y, &ParticleBucket::velocity_x, &ParticleBucket::velocity_y,
+		&ParticleBucket::scale_x, &ParticleBucket::scale_y, &ParticleBucket::color_r, &ParticleBucket::color_g,
+		&ParticleBucket::color_b, &ParticleBucket::alpha, &ParticleBucket::lifetime_ms, &ParticleBucket::state_timer_ms};
+	const char* names[] = {"position_x", "position_y", "velocity_x", "velocity_y", "scale_x", "scale_y",
+		"color_r", "color_g", "color_b", "alpha", "lifetime_ms", "state_timer_ms"};
+
+	for (int i = 0; i < a.size(); i++)
+	{
+		for (int f = 0; f < (int)(sizeof(fields) / sizeof(fields[0])); f++)
+		{
+			const float x = (a.*fields[f])[i];
+			const float y = (b.*fields[f])[i];
+			if (!close(x, y))
+				fail(where + " particle " + std::to_string(i) + " " + names[f] + ": " + std::to_string(x) + " vs " + std::to_string(y));
+		}
+		if (a.state[i] != b.state[i])
+			fail(where + " particle " + std::to_string(i) + " state");
+	}
+}
+
+int main()
+{
+	ParticleEmitters emitters;
+	if (!loadParticleEmitters(data_path() + "/particles/emitters.json", emitters))
+	{
+		fail("loading the particle emitters");
+		return 1;
+	}
+
+	std::default_random_engine rng(42);
+	vec2 player_position = {400.f, 300.f};
+
+	// death particles, with and without a player to follow, at frame times the game sees
+	ParticleBucket death_kernel, death_scalar;
+	fillBucket(death_kernel, player_position, rng);
+	death_scalar = death_kernel;
+	const float frame_ms[] = {16.6f, 8.3f, 33.3f, 250.f};
+	for (int frame = 0; frame < FRAMES; frame++)
+	{
+		const float elapsed_ms = frame_ms[frame % 4];
+		const bool has_player = frame % 10 != 9;
+		player_position += vec2(3.f, -2.f);
+		stepDeathParticles(death_kernel, emitters[(int)PARTICLE_TYPE::DEATH_PARTICLE], FIRST, PARTICLES, elapsed_ms, has_player, player_position);
+		stepDeathParticlesScalar(death_scalar, emitters[(int)PARTICLE_TYPE::DEATH_PARTICLE], FIRST, PARTICLES, elapsed_ms, has_player, player_position);
+		compareBuckets(death_kernel, death_scalar, "death", frame);
+	}
+
+	ParticleBucket ripple_kernel, ripple_scalar;
+	fillBucket(ripple_kernel, player_position, rng);
+	ripple_scalar = ripple_kernel;
+	for (int frame = 0; frame < FRAMES; frame++)
+	{
+		const float elapsed_ms = frame_ms[frame % 4];
+		stepRippleParticles(ripple_kernel, emitters[(int)PARTICLE_TYPE::RIPPLE_PARTICLE], FIRST, PARTICLES, elapsed_ms);
+		stepRippleParticlesScalar(ripple_scalar, emitters[(int)PARTICLE_TYPE::RIPPLE_PARTICLE], FIRST, PARTICLES, elapsed_ms);
+		compareBuckets(ripple_kernel, ripple_scalar, "ripple", frame);
+	}
+
+	if (failures > 0)
+	{
+		std::cerr << failures << " particle kernel checks failed" << std::endl;
+		return 1;
+	}
+	std::cout << "particle kernels: " << particleKernelPath() << " path matches the scalar one" << std::endl;
+	return 0;
+}
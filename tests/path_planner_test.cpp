@@ -0,0 +1,122 @@
+// Plans the same requests on the PathPlanner workers and with findPathNow on the calling thread,
+// over the tutorial, procedural and boss maps, and checks both give the same valid paths.
+
+#include "path_planner.hpp"
+#include "tinyECS/registry.hpp"
+#include "world_init.hpp"
+
+#include <iostream>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+static const int PROCEDURAL_MAPS = 20;
+static const int REQUESTS_PER_MAP = 200;
+
+static int failures = 0;
+
+static void check(bool ok, const std::string& what)
+{
+	if (!ok)
+	{
+		std::cerr << "FAIL: " << what << std::endl;
+		failures++;
+	}
+}
+
+// a path found by either planner has to start and end on the requested cells
+// and only take single steps over open cells
+static bool isValidPath(const MapSnapshot& map, const std::vector<ivec2>& path, ivec2 start, ivec2 end)
+{
+	if (path.empty() || path.front() != start || path.back() != end)
+		return false;
+	for (size_t i = 1; i < path.size(); i++)
+	{
+		ivec2 step = path[i] - path[i - 1];
+		if (abs(step.x) + abs(step.y) != 1 || !isTraversableOnMap(map, path[i]))
+			return false;
+	}
+	return true;
+}
+
+static void comparePlanners(const std::string& map_name, std::default_random_engine& rng)
+{
+	const MapSnapshot& map = registry.proceduralMaps.components[0].map;
+
+	std::vector<ivec2> open_cells;
+	for (int x = 0; x < (int)map.size(); x++)
+		for (int y = 0; y < (int)map[x].size(); y++)
+			if (isTraversableOnMap(map, {x, y}))
+				open_cells.push_back({x, y});
+	check(open_cells.size() > 1, map_name + " has open cells");
+	if (open_cells.size() < 2)
+		return;
+
+	PathPlanner planner;
+	planner.syncMap(map);
+
+	// every request is in flight before the first result is read
+	std::uniform_int_distribution<size_t> pick(0, open_cells.size() - 1);
+	std::vector<std::pair<ivec2, ivec2>> requests;
+	std::vector<std::shared_future<std::vector<ivec2>>> results;
+	for (int i = 0; i < REQUESTS_PER_MAP; i++)
+	{
+		ivec2 start = open_cells[pick(rng)];
+		ivec2 end = open_cells[pick(rng)];
+		requests.push_back({start, end});
+		results.push_back(planner.requestPath(gridCellToPosition(start), gridCellToPosition(end)));
+	}
+
+	for (int i = 0; i < REQUESTS_PER_MAP; i++)
+	{
+		const ivec2 start = requests[i].first;
+		const ivec2 end = requests[i].second;
+		const std::string request = map_name + " (" + std::to_string(start.x) + "," + std::to_string(start.y) + ") -> ("
+			+ std::to_string(end.x) + "," + std::to_string(end.y) + ")";
+
+		std::vector<ivec2> sync_path;
+		const bool found = planner.findPathNow(sync_path, gridCellToPosition(start), gridCellToPosition(end));
+		const std::vector<ivec2>& async_path = results[i].get();
+
+		check(async_path == sync_path, request + ": async and sync paths differ");
+		check(found == !async_path.empty(), request + ": async and sync disagree on whether there is a path");
+		if (found)
+			check(isValidPath(map, sync_path, start, end), request + ": path is not a walk over open cells");
+	}
+}
+
+int main()
+{
+	// the map factories throw their info buffs away from the player
+	Entity player;
+	registry.players.emplace(player);
+	registry.motions.emplace(player);
+
+	std::default_random_engine rng(2024);
+	std::pair<int, int> player_position;
+
+	createProceduralMap(nullptr, vec2(MAP_WIDTH, MAP_HEIGHT), true, player_position);
+	comparePlanners("tutorial map", rng);
+
+	for (int i = 0; i < PROCEDURAL_MAPS; i++)
+	{
+		createProceduralMap(nullptr, vec2(MAP_WIDTH, MAP_HEIGHT), false, player_position);
+		comparePlanners("procedural map " + std::to_string(i), rng);
+	}
+
+	// the boss cells in the middle are blocked for the search but are open tiles
+	createBossMap(nullptr, vec2(MAP_WIDTH, MAP_HEIGHT), player_position);
+	comparePlanners("boss map", rng);
+
+	createFinalBossMap(nullptr, vec2(MAP_WIDTH, MAP_HEIGHT), player_position);
+	comparePlanners("final boss map", rng);
+
+	if (failures > 0)
+	{
+		std::cerr << failures << " path planner checks failed" << std::endl;
+		return 1;
+	}
+	std::cout << "path planner: async and sync paths match" << std::endl;
+	return 0;
+}
@@ -0,0 +1,119 @@
+// Packs every png under data/textures the same way the renderer does at startup and
+// prints where each one lands. With an output folder the pages are written out as
+// RGBA .pam files so the packing can be looked at.
+//
+//   atlas_packer [page_size] [output_folder]
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+#include "../ext/project_path.hpp"
+#include "texture_atlas.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+struct AtlasImage
+{
+	std::string name;
+	unsigned char *pixels = NULL;
+};
+
+static bool writePage(const std::string &path, const std::vector<unsigned char> &page, int page_size)
+{
+	std::ofstream file(path, std::ios::binary);
+	if (!file)
+		return false;
+	file << "P7\nWIDTH " << page_size << "\nHEIGHT " << page_size << "\nDEPTH 4\nMAXVAL 255\nTUPLTYPE RGB_ALPHA\nENDHDR\n";
+	file.write((const char *)page.data(), page.size());
+	return (bool)file;
+}
+
+int main(int argc, char *argv[])
+{
+	int page_size = TEXTURE_ATLAS_PAGE_SIZE;
+	if (argc > 1)
+		page_size = atoi(argv[1]);
+	if (page_size <= 0)
+	{
+		std::cerr << "usage: atlas_packer [page_size] [output_folder]" << std::endl;
+		return 1;
+	}
+
+	const fs::path textures_folder = fs::path(PROJECT_SOURCE_DIR) / "data" / "textures";
+	std::vector<AtlasImage> images;
+	std::vector<AtlasRect> rects;
+	for (const fs::directory_entry &entry : fs::recursive_directory_iterator(textures_folder))
+	{
+		if (!entry.is_regular_file() || entry.path().extension() != ".png")
+			continue;
+
+		AtlasImage image;
+		AtlasRect rect;
+		image.name = fs::relative(entry.path(), textures_folder).generic_string();
+		image.pixels = stbi_load(entry.path().string().c_str(), &rect.size.x, &rect.size.y, NULL, 4);
+		if (image.pixels == NULL)
+		{
+			std::cerr << "Could not load the file " << entry.path() << ", skipping it" << std::endl;
+			continue;
+		}
+		images.push_back(image);
+		rects.push_back(rect);
+	}
+
+	AtlasReport report = packAtlas(rects, page_size);
+
+	// sorted by name so runs are easy to diff
+	std::vector<size_t> order(images.size());
+	for (size_t i = 0; i < order.size(); i++)
+		order[i] = i;
+	std::sort(order.begin(), order.end(), [&images](size_t a, size_t b) { return images[a].name < images[b].name; });
+
+	for (size_t i : order)
+	{
+		const AtlasRect &rect = rects[i];
+		std::cout << std::left << std::setw(48) << images[i].name << std::right
+				  << std::setw(5) << rect.size.x << "x" << std::left << std::setw(5) << rect.size.y << std::right;
+		if (rect.page < 0)
+			std::cout << "  doesn't fit a page" << std::endl;
+		else
+			std::cout << "  page " << rect.page << " at " << rect.position.x << ", " << rect.position.y << std::endl;
+	}
+
+	std::cout << std::endl
+			  << report.images << "/" << images.size() << " images on " << report.pages << " page(s) of "
+			  << page_size << "x" << page_size << std::endl
+			  << std::fixed << std::setprecision(1) << report.efficiency() * 100.f << "% of the page texels are used" << std::endl;
+
+	if (argc > 2)
+	{
+		std::vector<std::vector<unsigned char>> pages(report.pages, std::vector<unsigned char>(4 * (size_t)page_size * page_size, 0));
+		for (size_t i = 0; i < images.size(); i++)
+		{
+			if (rects[i].page >= 0)
+				blitToAtlasPage(pages[rects[i].page], page_size, rects[i], images[i].pixels);
+		}
+		for (int page = 0; page < report.pages; page++)
+		{
+			const std::string path = (fs::path(argv[2]) / ("atlas_" + std::to_string(page) + ".pam")).string();
+			if (!writePage(path, pages[page], page_size))
+			{
+				std::cerr << "Could not write " << path << std::endl;
+				return 1;
+			}
+			std::cout << "wrote " << path << std::endl;
+		}
+	}
+
+	for (AtlasImage &image : images)
+		stbi_image_free(image.pixels);
+	return 0;
+}